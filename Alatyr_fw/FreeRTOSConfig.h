@@ -48,8 +48,8 @@
 //extern uint32_t currentSystemClock;
 
 #define configUSE_PREEMPTION			0 // Co-operative sheduler
-#define configUSE_IDLE_HOOK				0
-#define configUSE_TICK_HOOK				0
+#define configUSE_IDLE_HOOK				1 // CPU load measurement
+#define configUSE_TICK_HOOK				1
 #define configCPU_CLOCK_HZ				(32000000)
 #define configTICK_RATE_HZ				((TickType_t)1000)
 #define configMINIMAL_STACK_SIZE		((unsigned short)64)
@@ -65,7 +65,7 @@
 #define configUSE_MALLOC_FAILED_HOOK	1
 #define configSUPPORT_DINAMIC_ALLOCATION 1
 #define configUSE_APPLICATION_TASK_TAG	0
-#define configUSE_COUNTING_SEMAPHORES	0
+#define configUSE_COUNTING_SEMAPHORES	1
 #define configGENERATE_RUN_TIME_STATS	0
 
 /* Cortex-M specific definitions. */
@@ -96,9 +96,10 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelete				0
 #define INCLUDE_vTaskCleanUpResources	0
 #define INCLUDE_vTaskSuspend			0
-#define INCLUDE_vTaskDelayUntil			0
+#define INCLUDE_vTaskDelayUntil			1
 #define INCLUDE_vTaskDelay				1
 #define INCLUDE_uxTaskGetStackHighWaterMark 0
+#define INCLUDE_xTaskGetSchedulerState	1
 
 /* Normal assert() semantics without relying on the provision of an assert.h
 header file. */
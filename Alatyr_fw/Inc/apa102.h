@@ -0,0 +1,90 @@
+/*
+ * apa102.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#ifndef APA102_H_
+#define APA102_H_
+
+#include <stdint.h>
+#include <lib_F103.h>
+#include <interface_F103.h>
+#include <neopixel.h>
+
+// Start frame, 4 bytes per LED, end frame (4 bytes for SK9822 + 1 clock per 2 LEDs for APA102)
+#define APA102_BUFFER_SIZE(length) (4UL + 4UL*(length) + 4UL + ((length) + 15UL)/16)
+#define APA102_LED_HEADER 	0xE0 		// 3 high bits of LED frame
+#define APA102_MAX_LEVEL 	31 			// 5-bit LED brightness
+
+//Apa102_t - driver for clocked APA102/SK9822 LEDs on SPI with DMA
+/////////////////////////////////////////////////////////////////////
+/*
+* Need IRQ Handler wrapper and external buffer for correct operation
+* Every LED uses own 5-bit brightness, so dim colors keep full 8-bit resolution
+* Wrapper example
+*
+#define APA102_LENGTH 30
+// DMA on SPI2 TX request
+DmaChannel_t DmaCh5 = {.Channel = DMA1_Channel5, .Number = 5, .Irq = DMA1_Channel5_IRQn};
+// External buffer
+uint8_t Apa102Buffer[APA102_BUFFER_SIZE(APA102_LENGTH)];
+// Driver class declaration
+Apa102_t LedStrip(SPI2, &DmaCh5, Apa102Buffer, APA102_LENGTH);
+// External interrupt handler wrapper compatible with CMSIS
+extern "C" {
+	void DMA1_Channel5_IRQHandler(){
+		LedStrip.IrqHandler();
+	}
+}
+*/
+
+class Apa102_t:public iLedStrip_t{
+protected:
+	SPI_TypeDef* Spi;
+	DmaChannel_t* Dma;
+	uint8_t* Buffer;
+	uint16_t StripLength;
+	uint16_t Brightness; // [0,256]
+	uint32_t ChannelSum;
+	uint32_t FrameStartCycles;
+	uint32_t FrameCycles;
+public:
+	Apa102_t(SPI_TypeDef* spi, DmaChannel_t* channel, uint8_t* buffer, uint16_t stripLength){
+		Spi = spi;
+		Dma = channel;
+		Buffer = buffer;
+		StripLength = stripLength;
+		Brightness = 256;
+		ChannelSum = 0;
+		FrameStartCycles = 0;
+		FrameCycles = 0;
+	}
+	// SPI clock is highest currentSpiClock/2^n not higher than spiFrequency
+	void Init(uint32_t currentSpiClock, uint32_t spiFrequency, uint8_t dmaIrqPrio);
+	// Global brightness is applied with 13-bit precision using LED 5-bit brightness
+	inline void SetBrightness(uint16_t brightness) {Brightness = brightness;}
+
+	// Led strip interface
+	void WriteLedColor(uint8_t ledNumber, uint32_t grbColor);
+	void Update();
+	uint8_t UpdateFromBuffer(const uint8_t*) {return retvFail;} // No raw frame format
+	void Clear();
+	inline uint16_t GetLength() {return StripLength;}
+	inline uint8_t IsBusy() {return (Dma->Channel->CCR & DMA_CCR_EN) != 0;}
+	inline uint8_t IsBlack() {return ChannelSum == 0;}
+	inline uint32_t GetFrameCycles() {return FrameCycles;}
+
+	inline uint8_t IrqHandler(){
+		if(DMA1->ISR & DMA_ISR_TCIF1 << 4*(Dma->Number - 1)){
+			DMA1->IFCR = DMA_IFCR_CTCIF1 << 4*(Dma->Number - 1);
+			Dma->Channel->CCR &= ~DMA_CCR_EN;
+			FrameCycles = dwt::GetCycles() - FrameStartCycles;
+			return retvOk;
+		} else
+			return retvFail;
+	}
+};
+
+#endif /* APA102_H_ */
@@ -0,0 +1,105 @@
+/*
+ * binlog.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#ifndef BINLOG_H_
+#define BINLOG_H_
+
+#include <stdint.h>
+#include <cstring>
+//
+#include <lib_F103.h>
+#include <format.h>
+
+//Deferred binary logging
+/////////////////////////////////////////////////////////////////////
+/*
+* Log site sends only ID of its format string, timestamp and raw arguments,
+* text is restored on host by Alatyr_tools/log_decoder.py from ELF file.
+* Format strings are placed in ".logstr" section, which is not loaded to
+* flash (INFO section at address 0 in linker script), so string address
+* is its ID. Format and arguments are checked as for CLI_PRINT.
+*
+* Record: [BINLOG_SYNC][length][ID, 2 bytes][time ms, 4 bytes][arguments]
+* length counts bytes after itself, numbers are little-endian.
+* Integer, char and float arguments take 4 bytes, %d is decoded as signed,
+* float for %.Nf is sent as integer x10^N, scaled on target,
+* %s and %h send length byte followed by up to 255 bytes of data.
+* Sync byte is not ASCII, so binary records and text can share one UART.
+*
+* Example
+*
+binlog::SetTimeSource(GetTimeMs);
+LOG_BIN(&CmdTxDma, "[NPX] frame %d us\r\n", frameUs);
+*/
+
+#define BINLOG_SYNC 		0xFE
+#define BINLOG_HEADER_SIZE 	8
+#define BINLOG_RECORD_SIZE 	64 // Longer records are cut
+#define BINLOG_SECTION 		__attribute__((section(".logstr"), used))
+
+#define LOG_BIN(writer, text, ...) binlog::Log(writer, []{ \
+	struct Format_t{ \
+		static constexpr const char* Get() {return text;} \
+		static uint32_t Id() {static const char str[] BINLOG_SECTION = text; return (uint32_t)str;} \
+	}; return Format_t{}; }(), ##__VA_ARGS__)
+
+namespace binlog {
+	typedef uint32_t (*TimeSource_t)();
+
+	typedef struct{
+		uint8_t Data[BINLOG_RECORD_SIZE];
+		uint32_t Length;
+	} Record_t;
+
+	void SetTimeSource(TimeSource_t source);
+	void StartRecord(Record_t& record, uint32_t id);
+	void PutWord(Record_t& record, uint32_t word);
+	void PutBytes(Record_t& record, const void* data, uint32_t length);
+
+	template<uint8_t Precision, class T>
+	void PutArg(Record_t& record, const T& value){
+		typedef typename std::decay<T>::type U;
+		if constexpr(std::is_same<U, format::HexDump_t>::value)
+			PutBytes(record, value.Data, value.Length);
+		else if constexpr(std::is_pointer<U>::value)
+			PutBytes(record, value, strlen((const char*)value));
+		else if constexpr(std::is_floating_point<U>::value){
+			// Decoder always gets fixed point integer
+			float scaled = value;
+			for(uint32_t i = 0; i < Precision; i++)
+				scaled = scaled*10;
+			PutWord(record, (uint32_t)(int32_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f));
+		} else if constexpr(std::is_enum<U>::value)
+			PutArg<Precision>(record, (typename std::underlying_type<U>::type)value);
+		else if constexpr(std::is_signed<U>::value)
+			PutWord(record, (uint32_t)(int32_t)value); // Sign extended
+		else
+			PutWord(record, (uint32_t)value);
+	}
+
+	template<class F, class... Args, size_t... I>
+	void PutArgs(Record_t& record, std::index_sequence<I...>, const Args&... args){
+		(PutArg<format::ArgSpec(F::Get(), I).Precision>(record, args), ...);
+	}
+
+	template<class W, class F, class... Args>
+	uint32_t Log(W* writer, F, const Args&... args){
+		typedef format::Parsed_t<F> Parsed;
+		static_assert(Parsed::ArgCount == sizeof...(Args), "Number of arguments doesn't match format string");
+		static_assert(format::CheckArgs<F, Args...>(std::index_sequence_for<Args...>{}),
+				"Argument type doesn't match format specifier");
+		Record_t record;
+		StartRecord(record, F::Id());
+		PutArgs<F>(record, std::index_sequence_for<Args...>{}, args...);
+		record.Data[1] = record.Length - 2;
+		uint32_t written = writer->Write(record.Data, record.Length);
+		writer->StartTransmission();
+		return written;
+	}
+} // namespace binlog
+
+#endif /* BINLOG_H_ */
@@ -0,0 +1,451 @@
+/*
+ * cli.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#ifndef CLI_H_
+#define CLI_H_
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <cstring>
+//
+#include <lib_F103.h>
+#include <interface_F103.h>
+#include <format.h>
+#include <tokenizer.h>
+
+//Cli - Simple command line interface
+/////////////////////////////////////////////////////////////////////
+/*
+* Tx and Rx are channel types. With concrete final classes (DmaTx_t, Uart_t...)
+* Write and Read are direct calls, Cli_t calls them through interfaces for
+* transports selected at runtime and is instantiated once in cli.cpp.
+* Channel is called once per record, so both cost the same per byte. Every
+* other Tx/Rx pair adds its own copy of formatting code.
+*
+* Each Print/Printf call is formatted into CLI_LINE_SIZE bytes on caller
+* stack and written as one record, so output of several tasks and
+* interrupts never interleaves. Longer output is cut, ends with line end
+* and is counted by GetTruncated().
+*
+* Input is collected by LineTokenizer_t, only complete lines are returned,
+* partial line stays in CommandBuffer until rest of it is received.
+*
+* Example
+*
+Cli<DmaTx_t, Uart_t> CmdCli(&CmdTxDma, &CmdUart);
+Cli_t BleCli(&BleTxDma, &BleRxDma);
+*/
+
+int32_t strToInt(char* text, retv_t* retv);
+
+#define COMMAND_BUFFER_SIZE (128UL)
+#define CLI_LINE_SIZE (128UL) // Print/Printf output limit, longer is truncated
+
+template<class Tx, class Rx>
+class Cli {
+protected:
+	Tx* TxChannel;
+	Rx* RxChannel;
+	// Output formatted on caller stack and written at once, so Printf can be
+	// called from several tasks and interrupts without mixing lines
+	struct Line_t{
+		char Data[CLI_LINE_SIZE];
+		uint32_t Length;
+		uint8_t Truncated;
+	};
+	volatile uint32_t Truncated; // Lines cut to CLI_LINE_SIZE
+	uint8_t Flush(Line_t& line);
+	void PutBlock(Line_t& line, const char* data, uint32_t length);
+	inline void PutChar(Line_t& line, char c){
+		if(line.Length < CLI_LINE_SIZE)
+			line.Data[line.Length++] = c;
+		else
+			line.Truncated = 1;
+	}
+	void PutBinary(Line_t& line, uint32_t binary);
+	void PutString(Line_t& line, const char* text);
+	void PutInt(Line_t& line, int32_t number);
+	void PutUnsignedInt(Line_t& line, uint32_t number);
+	void PutUnsignedHex(Line_t& line, uint32_t number);
+	// Compile time parsed format
+	uint32_t PutLiterals(Line_t& line, const char* text, const format::Spec_t* spec, uint32_t n);
+	void PutNumber(Line_t& line, const format::Spec_t& spec, uint32_t magnitude, uint8_t negative);
+	void PutText(Line_t& line, const format::Spec_t& spec, const char* text);
+	void PutHexDump(Line_t& line, const format::HexDump_t& dump);
+	// One walker for all formats, Print call site only converts arguments
+	uint8_t PrintParsed(const char* text, const format::Spec_t* spec, const format::Arg_t* args);
+	template<class F, class... Args, size_t... I>
+	uint8_t PrintArgs(std::index_sequence<I...>, const Args&... args);
+	// Input
+	LineTokenizer_t Tokenizer;
+	uint8_t NextArg;
+	uint32_t Receive();
+	uint8_t NextLine();
+public:
+	Cli(Tx* _TxChannel, Rx* _RxChannel) : Tokenizer(CommandBuffer, COMMAND_BUFFER_SIZE) {
+		TxChannel = _TxChannel;
+		RxChannel = _RxChannel;
+		NextArg = 0;
+		Truncated = 0;
+	}
+	char CommandBuffer[COMMAND_BUFFER_SIZE];
+	//Methods
+	void Clear() {Tokenizer.Clear(); NextArg = 0;}
+	// Format parsed at runtime, for strings not known at compile time.
+	// retvOutOfMemory - output dropped, TX buffer full,
+	// retvOverflow - output longer than CLI_LINE_SIZE truncated
+	uint8_t Printf(const char* text, ...);
+	// Use through CLI_PRINT macro, see format.h
+	template<class F, class... Args>
+	uint8_t Print(F, const Args&... args);
+	// Next token of current line, if line is finished - first token of next
+	// complete line. NULL - no complete line received yet
+	char* Read();
+	// Next complete line without splitting, NULL - no complete line
+	char* ReadLine();
+	// First token of next complete line, rest of current line is skipped
+	char* ReadCommand();
+	// Next token of current line, NULL at line end
+	char* ReadArg();
+	inline const TokenizerStats_t* GetInputStats() {return Tokenizer.GetStats();}
+	inline uint32_t GetTruncated() {return Truncated;}
+};
+
+// Dynamic dispatch version
+typedef Cli<iWriter_t, iReader_t> Cli_t;
+extern template class Cli<iWriter_t, iReader_t>;
+
+// Whole output is one record, cut line still ends with line end
+template<class Tx, class Rx>
+uint8_t Cli<Tx, Rx>::Flush(Line_t& line){
+	uint8_t retv = retvOk;
+	if(line.Truncated){
+		memcpy(&line.Data[CLI_LINE_SIZE - 2], "\r\n", 2);
+		Truncated++;
+		retv = retvOverflow;
+	}
+	if((line.Length != 0) and (TxChannel->Write((const uint8_t*)line.Data, line.Length) != line.Length))
+		retv = retvOutOfMemory;
+	TxChannel->StartTransmission();
+	return retv;
+}
+
+template<class Tx, class Rx>
+void Cli<Tx, Rx>::PutBlock(Line_t& line, const char* data, uint32_t length){
+	uint32_t part = CLI_LINE_SIZE - line.Length;
+	if(part < length)
+		line.Truncated = 1;
+	else
+		part = length;
+	memcpy(&line.Data[line.Length], data, part);
+	line.Length += part;
+}
+
+template<class Tx, class Rx>
+void Cli<Tx, Rx>::PutString(Line_t& line, const char* text){
+	PutBlock(line, text, strlen(text));
+}
+
+template<class Tx, class Rx>
+void Cli<Tx, Rx>::PutBinary(Line_t& line, uint32_t number){
+	if(number == 0){
+		PutBlock(line, "0b0", 3);
+		return;
+	}
+
+	char IntBuf[34] = "0b";
+	uint32_t i = 2;
+	uint32_t mask = 1UL << 31;
+	while((number & mask) == 0)
+		mask = mask >> 1;
+	while(mask > 0){
+		IntBuf[i++] = (number & mask) ? '1' : '0';
+		mask = mask >> 1;
+	}
+	PutBlock(line, IntBuf, i);
+}
+
+// Digits are placed from the end of buffer, then whole number copied at once
+template<class Tx, class Rx>
+void Cli<Tx, Rx>::PutUnsignedInt(Line_t& line, uint32_t number){
+	char IntBuf[10];
+	uint32_t i = sizeof(IntBuf);
+	do{
+		i--;
+		IntBuf[i] = '0' + number % 10;
+		number = number/10;
+	} while(number > 0);
+	PutBlock(line, &IntBuf[i], sizeof(IntBuf) - i);
+}
+
+template<class Tx, class Rx>
+void Cli<Tx, Rx>::PutUnsignedHex(Line_t& line, uint32_t number){
+	char IntBuf[10];
+	uint32_t i = sizeof(IntBuf);
+	do{
+		uint32_t temp = number & 0xF;
+		i--;
+		if(temp < 10)
+			IntBuf[i] = '0' + temp;
+		else
+			IntBuf[i] = 'A' + temp - 10;
+		number = number >> 4;
+	} while(number > 0);
+	IntBuf[--i] = 'x';
+	IntBuf[--i] = '0';
+	PutBlock(line, &IntBuf[i], sizeof(IntBuf) - i);
+}
+
+template<class Tx, class Rx>
+void Cli<Tx, Rx>::PutInt(Line_t& line, int32_t number) {
+	if(number >= 0)
+		PutUnsignedInt(line, number);
+	else{
+		PutChar(line, '-');
+		PutUnsignedInt(line, -(uint32_t)number);
+	}
+}
+
+template<class Tx, class Rx>
+uint8_t Cli<Tx, Rx>::Printf(const char* text, ...){
+	Line_t line;
+	line.Length = 0;
+	line.Truncated = 0;
+	// String format processing
+	va_list args;
+	va_start(args, text); // Start string processing
+	uint32_t i = 0;
+	while(text[i] != '\0'){
+		// Plain text up to next argument is copied as one block
+		uint32_t runStart = i;
+		while((text[i] != '\0') and (text[i] != '%'))
+			i++;
+		if(i != runStart)
+			PutBlock(line, &text[runStart], i - runStart);
+		if(text[i] == '\0')
+			break;
+		i++; // Skip '%'
+		switch(text[i]){
+			case 'd': // integer
+				PutInt(line, va_arg(args,int));
+				break;
+			case 'u': // unsigned integer
+				PutUnsignedInt(line, va_arg(args,uint32_t));
+				break;
+			case 's': // string
+				PutString(line, va_arg(args,char*));
+				break;
+			case 'c': // char
+				PutChar(line, va_arg(args,int));
+				break;
+			case 'b': // print uint32 as binary
+				PutBinary(line, va_arg(args,uint32_t));
+				break;
+			case 'x': // print uint32 as hex
+				PutUnsignedHex(line, va_arg(args,uint32_t));
+				break;
+			case '\0':
+				PutChar(line, '%');
+				continue;
+			default:
+				PutChar(line, '%');
+				PutChar(line, text[i]);
+		}
+		i++;
+	}
+	va_end(args); // End format processing
+	//
+	return Flush(line);
+}
+
+// Writes literal runs and percent signs until next specifier with argument
+template<class Tx, class Rx>
+uint32_t Cli<Tx, Rx>::PutLiterals(Line_t& line, const char* text, const format::Spec_t* spec, uint32_t n){
+	while(1){
+		if(spec[n].LiteralLength != 0)
+			PutBlock(line, &text[spec[n].LiteralStart], spec[n].LiteralLength);
+		if(spec[n].Type != '%')
+			return n;
+		PutChar(line, '%');
+		n++;
+	}
+}
+
+template<class Tx, class Rx>
+void Cli<Tx, Rx>::PutNumber(Line_t& line, const format::Spec_t& spec, uint32_t magnitude, uint8_t negative){
+	char digits[34];
+	char* end = digits + sizeof(digits);
+	uint32_t count;
+	const char* prefix = "";
+	switch(spec.Type){
+		case 'c':
+			PutChar(line, (char)magnitude);
+			return;
+		case 'x':
+			count = format::UnsignedToHex(end, magnitude);
+			prefix = "0x";
+			break;
+		case 'b':
+			count = 0;
+			do{
+				*(end - ++count) = '0' + (magnitude & 1);
+				magnitude = magnitude >> 1;
+			} while(magnitude > 0);
+			prefix = "0b";
+			break;
+		case 'f':
+			count = format::UnsignedToDecimal(end, magnitude);
+			if(spec.Precision != 0){
+				uint32_t precision = spec.Precision < 9 ? spec.Precision : 9;
+				while(count < precision + 1)
+					*(end - ++count) = '0';
+				// Integer part moved left to make room for point
+				memmove(end - count - 1, end - count, count - precision);
+				*(end - precision - 1) = '.';
+				count++;
+			}
+			break;
+		default:
+			count = format::UnsignedToDecimal(end, magnitude);
+	}
+	uint32_t prefixLength = strlen(prefix);
+	uint32_t length = count + prefixLength + (negative ? 1 : 0);
+	uint32_t padding = spec.Width > length ? spec.Width - length : 0;
+	if((spec.LeftAlign == 0) and (spec.Pad == ' '))
+		for(uint32_t i = 0; i < padding; i++)
+			PutChar(line, ' ');
+	if(negative)
+		PutChar(line, '-');
+	PutBlock(line, prefix, prefixLength);
+	if((spec.LeftAlign == 0) and (spec.Pad == '0'))
+		for(uint32_t i = 0; i < padding; i++)
+			PutChar(line, '0');
+	PutBlock(line, end - count, count);
+	if(spec.LeftAlign)
+		for(uint32_t i = 0; i < padding; i++)
+			PutChar(line, ' ');
+}
+
+template<class Tx, class Rx>
+void Cli<Tx, Rx>::PutText(Line_t& line, const format::Spec_t& spec, const char* text){
+	uint32_t length = strlen(text);
+	uint32_t padding = spec.Width > length ? spec.Width - length : 0;
+	if(spec.LeftAlign == 0)
+		for(uint32_t i = 0; i < padding; i++)
+			PutChar(line, ' ');
+	PutBlock(line, text, length);
+	if(spec.LeftAlign)
+		for(uint32_t i = 0; i < padding; i++)
+			PutChar(line, ' ');
+}
+
+template<class Tx, class Rx>
+void Cli<Tx, Rx>::PutHexDump(Line_t& line, const format::HexDump_t& dump){
+	static const char HexDigits[] = "0123456789ABCDEF";
+	for(uint32_t i = 0; i < dump.Length; i++){
+		if(i != 0)
+			PutChar(line, ' ');
+		PutChar(line, HexDigits[dump.Data[i] >> 4]);
+		PutChar(line, HexDigits[dump.Data[i] & 0xF]);
+	}
+}
+
+template<class Tx, class Rx>
+uint8_t Cli<Tx, Rx>::PrintParsed(const char* text, const format::Spec_t* spec, const format::Arg_t* args){
+	Line_t line;
+	line.Length = 0;
+	line.Truncated = 0;
+	// Literals before each argument, then argument itself
+	for(uint32_t n = PutLiterals(line, text, spec, 0); spec[n].Type != 0; n = PutLiterals(line, text, spec, n + 1)){
+		switch(spec[n].Type){
+			case 's':
+				PutText(line, spec[n], args->Text);
+				break;
+			case 'h':
+				PutHexDump(line, args->Dump);
+				break;
+			default:
+				PutNumber(line, spec[n], args->Number.Magnitude, args->Number.Negative);
+				break;
+		}
+		args++;
+	}
+	return Flush(line);
+}
+
+template<class Tx, class Rx>
+template<class F, class... Args, size_t... I>
+uint8_t Cli<Tx, Rx>::PrintArgs(std::index_sequence<I...>, const Args&... args){
+	typedef format::Parsed_t<F> Parsed;
+	// Extra entry, so format without arguments has array too
+	const format::Arg_t list[sizeof...(Args) + 1] = {
+			format::MakeArg<format::ArgSpec(F::Get(), I).Type, format::ArgSpec(F::Get(), I).Precision>(args)...};
+	return PrintParsed(Parsed::Text, Parsed::List.Spec, list);
+}
+
+template<class Tx, class Rx>
+template<class F, class... Args>
+uint8_t Cli<Tx, Rx>::Print(F, const Args&... args){
+	typedef format::Parsed_t<F> Parsed;
+	static_assert(Parsed::ArgCount == sizeof...(Args), "Number of arguments doesn't match format string");
+	static_assert(format::CheckArgs<F, Args...>(std::index_sequence_for<Args...>{}),
+			"Argument type doesn't match format specifier");
+	return PrintArgs<F>(std::index_sequence_for<Args...>{}, args...);
+}
+
+template<class Tx, class Rx>
+uint32_t Cli<Tx, Rx>::Receive(){
+	uint32_t free;
+	char* space = Tokenizer.GetFreeSpace(&free);
+	uint32_t length = RxChannel->Read((uint8_t*)space, free);
+	Tokenizer.Append(length);
+	return length;
+}
+
+// Skips too long lines, returns retvEmpty if no complete line in channel
+template<class Tx, class Rx>
+uint8_t Cli<Tx, Rx>::NextLine(){
+	uint8_t retv;
+	NextArg = 0;
+	while((retv = Tokenizer.NextLine()) != retvOk){
+		if((retv == retvEmpty) and (Receive() == 0))
+			return retvEmpty;
+	}
+	return retvOk;
+}
+
+template<class Tx, class Rx>
+char* Cli<Tx, Rx>::Read(){
+	while(NextArg >= Tokenizer.GetArgc()){
+		if(NextLine() != retvOk)
+			return NULL;
+		Tokenizer.Tokenize(); // Line with too many tokens is skipped
+	}
+	return Tokenizer.GetArgv()[NextArg++];
+}
+
+template<class Tx, class Rx>
+char* Cli<Tx, Rx>::ReadCommand(){
+	NextArg = Tokenizer.GetArgc();
+	return Read();
+}
+
+template<class Tx, class Rx>
+char* Cli<Tx, Rx>::ReadArg(){
+	if(NextArg >= Tokenizer.GetArgc())
+		return NULL;
+	return Tokenizer.GetArgv()[NextArg++];
+}
+
+template<class Tx, class Rx>
+char* Cli<Tx, Rx>::ReadLine(){
+	if(NextLine() != retvOk)
+		return NULL;
+	return Tokenizer.GetLine();
+}
+
+#endif /* CLI_H_ */
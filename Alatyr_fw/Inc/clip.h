@@ -0,0 +1,93 @@
+/*
+ * clip.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#ifndef CLIP_H_
+#define CLIP_H_
+
+#include <stdint.h>
+#include <lib_F103.h>
+#include <neopixel.h>
+
+// Precomputed animation clips
+/////////////////////////////////////////////////////////////////////
+/*
+* Clips are generated on host by Alatyr_tools/clip_compiler.py and placed
+* in the ".clips" section (CLIPS region in linker script). Player reads
+* them directly from flash, nothing is copied to RAM.
+*
+* Layout: ClipHeader_t followed by DataSize bytes of frames
+* clipRle 		- per frame [count][G][R][B] runs until StripLength LEDs covered
+* clipDelta 	- per frame [skip][count][count*GRB] until StripLength LEDs covered,
+* 				  skipped LEDs keep previous color, first frame covers all LEDs
+* clipRawTimer 	- per frame NPX_FRAME_SIZE(StripLength) bytes of timer values (NPX_HIGH/NPX_LOW
+* 				  and NPX_STOP), DMA sends frame straight from flash, StripLength must match strip,
+* 				  only for Neopixel_t
+*
+* Example
+*
+#include <clip_demo.h>
+ClipPlayer_t Player(&LedStrip);
+Player.Start(ClipDemo);
+while(1){
+	Player.PlayNextFrame();
+	vTaskDelay(pdMS_TO_TICKS(Player.GetFramePeriodMs()));
+}
+*/
+
+#define CLIP_MAGIC 			0x50494C43 // "CLIP"
+#define CLIP_SECTION 		__attribute__((section(".clips"), aligned(4)))
+
+typedef enum{
+	clipRle 		= 0,
+	clipDelta 		= 1,
+	clipRawTimer 	= 2
+} ClipEncoding_t;
+
+typedef struct{
+	uint32_t Magic;
+	uint16_t FrameCount;
+	uint16_t StripLength;
+	uint16_t FramePeriodMs;
+	uint8_t Encoding;
+	uint8_t Reserved;
+	uint32_t DataSize; // Bytes of frame data after header
+} ClipHeader_t;
+
+class ClipPlayer_t{
+protected:
+	iLedStrip_t* Strip;
+	const ClipHeader_t* Header;
+	const uint8_t* Data;
+	uint32_t ReadPtr;
+	uint16_t Frame;
+	uint32_t LastDecodeCycles;
+	uint32_t MaxDecodeCycles;
+	uint8_t DecodeRle();
+	uint8_t DecodeDelta();
+public:
+	ClipPlayer_t(iLedStrip_t* strip){
+		Strip = strip;
+		Header = NULL;
+		Data = NULL;
+		ReadPtr = 0;
+		Frame = 0;
+		LastDecodeCycles = 0;
+		MaxDecodeCycles = 0;
+	}
+	uint8_t Start(const uint8_t* clip);
+	inline void Stop() {Header = NULL;}
+	inline uint8_t IsPlaying() {return Header != NULL;}
+	// retvOk - frame sent, retvLast - last frame sent and clip restarted
+	uint8_t PlayNextFrame();
+	inline uint16_t GetFramePeriodMs() {return Header->FramePeriodMs;}
+	// Raw GRB size divided by stored size, x100
+	uint32_t GetCompressionRatio();
+	inline uint32_t GetLastDecodeCycles() {return LastDecodeCycles;}
+	inline uint32_t GetMaxDecodeCycles() {return MaxDecodeCycles;}
+};
+
+#endif /* CLIP_H_ */
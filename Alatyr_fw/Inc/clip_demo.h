@@ -0,0 +1,22 @@
+/*
+ * Generated by Alatyr_tools/clip_compiler.py, do not edit
+ */
+
+#ifndef CLIPDEMO_H_
+#define CLIPDEMO_H_
+
+#include <clip.h>
+
+const uint8_t ClipDemo[135] CLIP_SECTION = {
+	0x43, 0x4C, 0x49, 0x50, 0x0C, 0x00, 0x06, 0x00, 0x50, 0x00, 0x01, 0x00, 0x77, 0x00, 0x00, 0x00,
+	0x00, 0x06, 0x28, 0x00, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x0C, 0x00, 0x14, 0x28, 0x00, 0x3C, 0x04, 0x00, 0x00, 0x03,
+	0x03, 0x00, 0x05, 0x0C, 0x00, 0x14, 0x28, 0x00, 0x3C, 0x03, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+	0x03, 0x00, 0x05, 0x0C, 0x00, 0x14, 0x28, 0x00, 0x3C, 0x02, 0x00, 0x01, 0x04, 0x00, 0x00, 0x00,
+	0x03, 0x00, 0x05, 0x0C, 0x00, 0x14, 0x28, 0x00, 0x3C, 0x01, 0x00, 0x02, 0x04, 0x00, 0x00, 0x00,
+	0x03, 0x00, 0x05, 0x0C, 0x00, 0x14, 0x28, 0x00, 0x3C, 0x03, 0x03, 0x00, 0x00, 0x00, 0x03, 0x00,
+	0x05, 0x0C, 0x00, 0x14, 0x04, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x05, 0x05, 0x01, 0x00, 0x00,
+	0x00, 0x06, 0x00, 0x06, 0x00, 0x06, 0x00,
+};
+
+#endif /* CLIPDEMO_H_ */
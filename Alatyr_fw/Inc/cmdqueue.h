@@ -0,0 +1,121 @@
+/*
+ * cmdqueue.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#ifndef CMDQUEUE_H_
+#define CMDQUEUE_H_
+
+#include <stdint.h>
+#include <cstring>
+//
+#include <lib_F103.h>
+#include <rcc_F103.h>
+#include <cli.h>
+#include <command.h>
+
+//CommandQueue_t - command work against render frame deadlines
+/////////////////////////////////////////////////////////////////////
+/*
+* Scheduler is cooperative, so frame that falls due while command runs waits
+* for its end. Shell posts received command of each session here and takes
+* back the one to execute, urgent before normal before background.
+*
+* Each render frame opens a slice of CMDQ_BUDGET_PERCENT of frame period.
+* Command runs if cost estimate of its priority (peak of recent runs) fits
+* both rest of slice and time left to next frame, otherwise it is deferred
+* to next frame. Urgent commands are never deferred, deferred command runs
+* in next frame even if estimate is larger than whole slice, so nothing
+* starves. Session line buffer holds posted command, so session is not read
+* until command is taken back.
+*
+* Render task reports how late it woke up. Miss is charged to commands when
+* command was still running at the moment frame was due.
+*
+* Example
+*
+CommandQueue_t Queue(cyclesPerUs);
+// Shell task
+if(!Queue.IsPosted(&BleCli) and ((text = BleCli.ReadCommand()) != NULL))
+	Queue.Post(&BleCli, text, priority);
+CommandJob_t job;
+if(Queue.Take(&job) == retvOk){
+	CommandTable.Execute(*job.Cli, job.Name);
+	Queue.Done(&job);
+}
+// Render task after wake up
+Queue.StartFrame(periodMs, lateMs);
+*/
+
+#define CMDQ_SESSIONS 2
+#define CMDQ_BUDGET_PERCENT 25 // Of frame period
+#define CMDQ_MISS_MS 2 // Frame later than this is deadline miss
+
+typedef struct{
+	Cli_t* Cli;
+	const char* Name;
+	uint8_t Priority; // CommandPriority_t
+	uint8_t Deferred;
+	uint32_t Frame; // Frame number when deferred
+	uint32_t Sequence; // Same priority in order of arrival
+	uint32_t StartCycles;
+} CommandJob_t;
+
+typedef struct{
+	uint32_t Frames;
+	uint32_t Misses;
+	uint32_t CommandMisses; // Command was running when frame was due
+	uint32_t Skipped; // Frames dropped to get back to frame rate
+	uint32_t MaxLateMs;
+	uint32_t Deferred;
+	uint32_t Executed[cmdPriorityCount];
+	uint32_t MaxUs[cmdPriorityCount];
+} CommandQueueStats_t;
+
+class CommandQueue_t{
+protected:
+	uint32_t CyclesPerUs;
+	CommandJob_t Jobs[CMDQ_SESSIONS];
+	uint32_t Sequence;
+	uint32_t EstimateUs[cmdPriorityCount];
+	// Current frame
+	uint32_t Frame;
+	uint32_t FrameStartCycles;
+	uint32_t PeriodUs;
+	uint32_t UsedUs;
+	uint32_t LastDoneCycles;
+	CommandQueueStats_t Stats;
+	uint8_t IsAllowed(const CommandJob_t* job);
+public:
+	CommandQueue_t(uint32_t cyclesPerUs){
+		CyclesPerUs = cyclesPerUs;
+		memset(Jobs, 0, sizeof(Jobs));
+		Sequence = 0;
+		memset(EstimateUs, 0, sizeof(EstimateUs));
+		Frame = 0;
+		FrameStartCycles = 0;
+		PeriodUs = 0; // No frame yet, nothing is deferred
+		UsedUs = 0;
+		LastDoneCycles = 0;
+		memset(&Stats, 0, sizeof(Stats));
+	}
+	// retvBusy - session already has command posted, retvOverflow - no free slot
+	uint8_t Post(Cli_t* cli, const char* name, uint8_t priority);
+	uint8_t IsPosted(Cli_t* cli);
+	// Posted command dropped, e.g. session input cleared
+	void Remove(Cli_t* cli);
+	// retvEmpty - nothing posted, retvBusy - all posted commands deferred
+	uint8_t Take(CommandJob_t* job);
+	void Done(const CommandJob_t* job);
+	uint8_t IsDeferred();
+	// Called by render task after wake up, lateness of whole period or more
+	// is counted as skipped frames, render task starts counting again
+	void StartFrame(uint32_t periodMs, uint32_t lateMs);
+	inline uint32_t GetEstimateUs(uint8_t priority) {return EstimateUs[priority];}
+	inline const CommandQueueStats_t* GetStats() {return &Stats;}
+	inline void ClearStats() {memset(&Stats, 0, sizeof(Stats));}
+};
+
+#endif /* CMDQUEUE_H_ */
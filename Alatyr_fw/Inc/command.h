@@ -0,0 +1,166 @@
+/*
+ * command.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#ifndef COMMAND_H_
+#define COMMAND_H_
+
+#include <stdint.h>
+//
+#include <lib_F103.h>
+#include <cli.h>
+
+//Command registry
+/////////////////////////////////////////////////////////////////////
+/*
+* Commands are listed in constexpr table, names are hashed (FNV-1a) by
+* compiler into open addressing index. Lookup costs one hash of received
+* name and usually one string compare, regardless of number of commands.
+* Arguments are parsed by type string before callback, callback gets
+* only valid values. Callback answers to Cli it was called from, so one
+* table serves all transports.
+*
+* Argument types
+* d - decimal integer, optional minus
+* x - hex number, optional 0x prefix
+* c - colour 0xRRGGBB, written as #RRGGBB, 0xRRGGBB or RRGGBB
+* s - string token
+* [ - rest of arguments are optional, Count has number of received
+*
+* Priority orders commands waiting in CommandQueue_t (cmdqueue.h), commands
+* that change rendered picture go ahead of diagnostics.
+*
+* Example
+*
+void BrightnessCommand(Cli_t& cli, const CommandArgs_t& args);
+constexpr Command_t Commands[] = {
+	Command_t("brightness", BrightnessCommand, "d"),
+	Command_t("reset", ResetCommand),
+	Command_t("ledbench", LedBenchCommand, "", cmdBackground)
+};
+constexpr CommandTable_t<COMMAND_COUNT(Commands)> CommandTable(Commands);
+static_assert(CommandTable.IsUnique(), "Duplicate command name");
+CommandTable.Execute(BleCli, BleCli.ReadCommand());
+*/
+
+#define COMMAND_MAX_ARGS 4
+#define COMMAND_COUNT(table) (sizeof(table)/sizeof(table[0]))
+
+typedef union{
+	int32_t Int;
+	uint32_t Unsigned;
+	const char* String;
+} CommandArg_t;
+
+typedef struct{
+	uint8_t Count;
+	CommandArg_t Arg[COMMAND_MAX_ARGS];
+} CommandArgs_t;
+
+typedef enum{
+	cmdUrgent, // Changes rendered picture, never deferred
+	cmdNormal,
+	cmdBackground, // Diagnostics, benchmarks and dumps
+	cmdPriorityCount
+} CommandPriority_t;
+
+typedef void (*CommandCallback_t)(Cli_t& cli, const CommandArgs_t& args);
+
+namespace command {
+	constexpr uint32_t Hash(const char* text){
+		uint32_t hash = 2166136261UL;
+		while(*text != '\0'){
+			hash ^= (uint8_t)*text++;
+			hash *= 16777619UL;
+		}
+		return hash;
+	}
+
+	constexpr uint8_t IsEqual(const char* str1, const char* str2){
+		while((*str1 != '\0') and (*str1 == *str2)){
+			str1++;
+			str2++;
+		}
+		return *str1 == *str2;
+	}
+
+	// Power of two, at least twice number of commands
+	constexpr uint32_t IndexSize(uint32_t count){
+		uint32_t size = 4;
+		while(size < 2*count)
+			size *= 2;
+		return size;
+	}
+} // namespace command
+
+struct Command_t {
+	const char* Name;
+	uint32_t Hash;
+	const char* Args; // Argument types, see above
+	CommandCallback_t Callback;
+	uint8_t Priority; // CommandPriority_t
+
+	constexpr Command_t(const char* _Name, CommandCallback_t _Callback, const char* _Args = "",
+			uint8_t _Priority = cmdNormal) :
+		Name(_Name), Hash(command::Hash(_Name)), Args(_Args), Callback(_Callback), Priority(_Priority) {}
+};
+
+namespace command {
+	// Parses arguments of found command and calls it, unknown command and bad
+	// arguments are reported to cli
+	uint8_t Execute(Cli_t& cli, const Command_t* command, const char* name);
+	uint8_t ParseHex(const char* text, uint32_t* number);
+} // namespace command
+
+template<uint32_t N>
+class CommandTable_t{
+	static_assert((N > 0) and (N < 255), "Command table size");
+	static constexpr uint32_t Size = command::IndexSize(N);
+	const Command_t* Commands;
+	uint8_t Index[Size]; // Command number + 1, 0 - empty slot
+public:
+	constexpr CommandTable_t(const Command_t (&commands)[N]) : Commands(commands), Index{} {
+		for(uint32_t i = 0; i < N; i++){
+			uint32_t slot = commands[i].Hash & (Size - 1);
+			while(Index[slot] != 0)
+				slot = (slot + 1) & (Size - 1);
+			Index[slot] = i + 1;
+		}
+	}
+	constexpr bool IsUnique() const{
+		for(uint32_t i = 0; i < N; i++)
+			for(uint32_t j = i + 1; j < N; j++)
+				if(command::IsEqual(Commands[i].Name, Commands[j].Name))
+					return false;
+		return true;
+	}
+	const Command_t* Find(const char* name) const{
+		uint32_t hash = command::Hash(name);
+		uint32_t slot = hash & (Size - 1);
+		while(Index[slot] != 0){
+			const Command_t* command = &Commands[Index[slot] - 1];
+			if((command->Hash == hash) and command::IsEqual(command->Name, name))
+				return command;
+			slot = (slot + 1) & (Size - 1);
+		}
+		return NULL;
+	}
+	// retvEmpty - no command received
+	uint8_t Execute(Cli_t& cli, const char* name) const{
+		if(name == NULL)
+			return retvEmpty;
+		return command::Execute(cli, Find(name), name);
+	}
+	// Unknown command is cheap to refuse
+	uint8_t GetPriority(const char* name) const{
+		const Command_t* command = Find(name);
+		return (command == NULL) ? cmdNormal : command->Priority;
+	}
+	inline uint32_t GetCount() const {return N;}
+	inline const Command_t& Get(uint32_t i) const {return Commands[i];}
+};
+
+#endif /* COMMAND_H_ */
@@ -0,0 +1,251 @@
+/*
+ * format.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#ifndef FORMAT_H_
+#define FORMAT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <type_traits>
+#include <utility>
+
+//Compile time parsed format strings
+/////////////////////////////////////////////////////////////////////
+/*
+* Format string is parsed by compiler into table of literal runs and
+* specifiers, number and types of arguments are checked by static_assert.
+* Call site only converts arguments to Arg_t, table is walked by one
+* shared runtime function, see Cli::Print. Format string is limited to
+* 255 characters, table offsets are bytes.
+*
+* %[-][0][width][.precision]type
+* d - integer, unsigned types printed as unsigned
+* u - unsigned integer
+* x - hex with 0x prefix, width and padding apply to digits
+* b - binary with 0b prefix
+* c - char
+* s - string
+* f - fixed point, integer argument is value x10^precision (%.2f of 1234 is 12.34),
+* 	  float argument is scaled and rounded
+* h - hex dump of format::HexDump(data, length)
+* %% - percent sign
+*
+* Example
+*
+CLI_PRINT(CmdCli, "[NPX] %4d us, %.1f V\r\n", frameUs, batteryMv/100);
+*/
+
+// Wraps string literal into type, so it can be parsed at compile time
+#define FORMAT(text) ([]{ struct Format_t{ static constexpr const char* Get() {return text;} }; return Format_t{}; }())
+#define CLI_PRINT(cli, text, ...) (cli).Print(FORMAT(text), ##__VA_ARGS__)
+
+namespace format {
+	typedef struct{
+		const uint8_t* Data;
+		uint32_t Length;
+	} HexDump_t;
+
+	inline HexDump_t HexDump(const void* data, uint32_t length) {return {(const uint8_t*)data, length};}
+
+	// Literal run followed by specifier, last entry has Type 0
+	typedef struct{
+		uint8_t LiteralStart;
+		uint8_t LiteralLength;
+		char Type;
+		char Pad;
+		uint8_t LeftAlign;
+		uint8_t Width;
+		uint8_t Precision;
+	} Spec_t;
+
+	template<uint32_t N>
+	struct SpecList_t{
+		Spec_t Spec[N];
+	};
+
+	// Argument converted at call site, number keeps sign separately
+	typedef union{
+		struct{
+			uint32_t Magnitude;
+			uint32_t Negative;
+		} Number;
+		const char* Text;
+		HexDump_t Dump;
+	} Arg_t;
+
+	constexpr uint8_t IsDigit(char c) {return (c >= '0') and (c <= '9');}
+
+	constexpr uint32_t Length(const char* text){
+		uint32_t i = 0;
+		while(text[i] != '\0')
+			i++;
+		return i;
+	}
+
+	// Parses one specifier starting after '%', returns index after it
+	constexpr uint32_t ParseSpec(const char* text, uint32_t i, Spec_t& spec){
+		spec.Pad = ' ';
+		spec.LeftAlign = 0;
+		spec.Width = 0;
+		spec.Precision = 0;
+		if(text[i] == '\0'){
+			spec.Type = '%'; // Percent sign at the end of string
+			return i;
+		}
+		if(text[i] == '-'){
+			spec.LeftAlign = 1;
+			i++;
+		}
+		if(text[i] == '0'){
+			spec.Pad = '0';
+			i++;
+		}
+		while(IsDigit(text[i]))
+			spec.Width = spec.Width*10 + (text[i++] - '0');
+		if(text[i] == '.'){
+			i++;
+			while(IsDigit(text[i]))
+				spec.Precision = spec.Precision*10 + (text[i++] - '0');
+		}
+		spec.Type = text[i];
+		return i + 1;
+	}
+
+	constexpr uint32_t CountSpecs(const char* text){
+		uint32_t count = 0;
+		uint32_t i = 0;
+		while(text[i] != '\0'){
+			if(text[i] == '%'){
+				Spec_t spec = {};
+				i = ParseSpec(text, i + 1, spec);
+				count++;
+			} else
+				i++;
+		}
+		return count;
+	}
+
+	// Specifiers consuming argument
+	constexpr uint32_t CountArgs(const char* text){
+		uint32_t count = 0;
+		uint32_t i = 0;
+		while(text[i] != '\0'){
+			if(text[i] == '%'){
+				Spec_t spec = {};
+				i = ParseSpec(text, i + 1, spec);
+				if(spec.Type != '%')
+					count++;
+			} else
+				i++;
+		}
+		return count;
+	}
+
+	template<uint32_t N>
+	constexpr SpecList_t<N> Parse(const char* text){
+		SpecList_t<N> list = {};
+		uint32_t i = 0;
+		for(uint32_t n = 0; n < N; n++){
+			Spec_t& spec = list.Spec[n];
+			spec.LiteralStart = i;
+			while((text[i] != '\0') and (text[i] != '%'))
+				i++;
+			spec.LiteralLength = i - spec.LiteralStart;
+			if(text[i] == '%')
+				i = ParseSpec(text, i + 1, spec);
+			else
+				spec.Type = 0;
+		}
+		return list;
+	}
+
+	// Specifier for argument number index
+	constexpr Spec_t ArgSpec(const char* text, uint32_t index){
+		uint32_t i = 0;
+		while(text[i] != '\0'){
+			if(text[i] == '%'){
+				Spec_t spec = {};
+				i = ParseSpec(text, i + 1, spec);
+				if(spec.Type == '%')
+					continue;
+				if(index == 0)
+					return spec;
+				index--;
+			} else
+				i++;
+		}
+		return Spec_t{};
+	}
+
+	constexpr char ArgType(const char* text, uint32_t index) {return ArgSpec(text, index).Type;}
+
+	template<class T>
+	constexpr bool ArgFits(char type){
+		typedef typename std::decay<T>::type U;
+		constexpr bool isInteger = (std::is_integral<U>::value or std::is_enum<U>::value) and (sizeof(U) <= 4);
+		switch(type){
+			case 'd': case 'u': case 'x': case 'b': case 'c':
+				return isInteger;
+			case 's':
+				return std::is_same<U, const char*>::value or std::is_same<U, char*>::value;
+			case 'f':
+				return isInteger or std::is_floating_point<U>::value;
+			case 'h':
+				return std::is_same<U, HexDump_t>::value;
+			default:
+				return false; // Unknown specifier
+		}
+	}
+
+	template<class F, class... Args, size_t... I>
+	constexpr bool CheckArgs(std::index_sequence<I...>){
+		return (true and ... and ArgFits<Args>(ArgType(F::Get(), I)));
+	}
+
+	// Sign is kept only by 'd' and 'f', other types show two's complement
+	template<char Type, uint8_t Precision, class T>
+	inline Arg_t MakeArg(const T& value){
+		typedef typename std::decay<T>::type U; // String literals come as arrays
+		Arg_t arg;
+		if constexpr(std::is_same<U, HexDump_t>::value)
+			arg.Dump = value;
+		else if constexpr(std::is_pointer<U>::value)
+			arg.Text = (const char*)value;
+		else if constexpr(std::is_floating_point<U>::value){
+			float scaled = value;
+			for(uint32_t i = 0; i < Precision; i++)
+				scaled = scaled*10;
+			arg.Number.Negative = scaled < 0;
+			arg.Number.Magnitude = (uint32_t)(arg.Number.Negative ? 0.5f - scaled : scaled + 0.5f);
+		} else if constexpr(std::is_enum<U>::value)
+			return MakeArg<Type, Precision>((typename std::underlying_type<U>::type)value);
+		else if constexpr(std::is_signed<U>::value){
+			int32_t number = value;
+			arg.Number.Negative = (number < 0) and ((Type == 'd') or (Type == 'f'));
+			arg.Number.Magnitude = arg.Number.Negative ? -(uint32_t)number : (uint32_t)number;
+		} else{
+			arg.Number.Magnitude = (uint32_t)value;
+			arg.Number.Negative = 0;
+		}
+		return arg;
+	}
+
+	template<class F>
+	struct Parsed_t{
+		static_assert(Length(F::Get()) < 256, "Format string too long");
+		static constexpr const char* Text = F::Get();
+		static constexpr uint32_t ArgCount = CountArgs(F::Get());
+		static constexpr uint32_t SpecCount = CountSpecs(F::Get()) + 1;
+		static constexpr SpecList_t<SpecCount> List = Parse<SpecCount>(F::Get());
+	};
+
+	// Digits written backwards from end, two per division, returns number of digits
+	uint32_t UnsignedToDecimal(char* end, uint32_t number);
+	uint32_t UnsignedToHex(char* end, uint32_t number);
+} // namespace format
+
+#endif /* FORMAT_H_ */
@@ -43,6 +43,12 @@ typedef enum{
 	PullDown 	= 0
 } PinPupd_t;
 
+typedef enum{
+	ExtiRising 		= 0b01,
+	ExtiFalling 	= 0b10,
+	ExtiBothEdges 	= 0b11
+} ExtiTrigger_t;
+
 namespace gpio{
 	void SetupPin(GPIO_TypeDef* gpio, uint8_t pin,
 			PinMode_t pinMode, PinPupd_t pinPupd = PullDown);
@@ -61,6 +67,15 @@ namespace gpio{
 	inline void Afio2Remap(uint32_t afio2Remap){
 		AFIO->MAPR2 |= afio2Remap;
 	}
+	// EXTI line of pin number connected to pin, AFIO clock must be enabled
+	void EnableExti(GPIO_TypeDef* gpio, uint8_t pin, ExtiTrigger_t trigger, uint8_t irqPrio);
+	// Clears pending flag, retvFail - line was not pending (shared EXTI9_5 and EXTI15_10 IRQs)
+	inline uint8_t ClearExti(uint8_t pin){
+		if((EXTI->PR & (0b1UL << pin)) == 0)
+			return retvFail;
+		EXTI->PR = 0b1UL << pin;
+		return retvOk;
+	}
 }//GPIO end
 
 //Simple buttons
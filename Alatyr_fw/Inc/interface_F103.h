@@ -30,42 +30,200 @@ typedef struct{
 	IRQn_Type Irq;
 } DmaChannel_t;
 
+// Reception events, callback is called from interrupt
+typedef enum {
+	rxEventIdle 		= 0b001, // USART IDLE line
+	rxEventHalf 		= 0b010, // DMA half transfer
+	rxEventComplete 	= 0b100  // DMA transfer complete
+} RxEvent_t;
+
+typedef void (*RxCallback_t)(uint32_t events);
+
+// Called from DMA interrupt when buffer of queued descriptor may be reused
+typedef void (*TxCallback_t)(const uint8_t* data, void* context);
+
+// What DmaTx_t does when record doesn't fit into ring buffer
+typedef enum{
+	txDropNewest, // New record is dropped
+	txDropOldest, // Not yet sent data is discarded, record being sent is cut
+	txBlock 	  // Writer task waits for DMA to free space, drops record after timeout
+} TxOverflowPolicy_t;
+
+// Blocking hooks keep driver independent of RTOS. Wait returns retvOk when
+// woken by space hook, space hook is called from DMA interrupt.
+typedef uint8_t (*TxWaitHook_t)(uint32_t timeoutMs);
+typedef void (*TxSpaceHook_t)();
+
+// Buffer sent by DMA directly, without copying to ring buffer
+typedef struct{
+	const uint8_t* Data;
+	uint16_t Length;
+	uint16_t RingMark; // Ring buffer bytes before this position are sent first
+	TxCallback_t Callback;
+	void* Context;
+} TxDescriptor_t;
+
+// Reception error counters
+typedef struct{
+	uint32_t Overrun;
+	uint32_t Framing;
+	uint32_t Noise;
+	uint32_t Parity;
+} UartStats_t;
+
+typedef struct{
+	uint32_t Bytes; // Total received
+	uint32_t Laps; // DMA write pointer wraps
+	uint32_t Overruns; // Reader was lapped by DMA
+	uint32_t LostBytes;
+	uint16_t HighWater; // Maximum bytes waiting in buffer
+} DmaRxStats_t;
+
+typedef struct{
+	uint32_t Bytes; // Sent by DMA
+	uint32_t Transfers; // DMA starts, one transfer complete interrupt each
+} DmaTxStats_t;
+
 // Writer and reader interfaces
 /////////////////////////////////////////////////////////////////////
+// Block functions return number of bytes actually copied
 class iWriter_t{
 public:
 	virtual uint8_t WriteChar(uint8_t data)=0;
+	virtual uint32_t Write(const uint8_t* data, uint32_t length);
 	virtual uint8_t StartTransmission()=0;
 };
 
 class iReader_t{
 public:
 	virtual uint8_t ReadChar(retv_t* retv)=0;
+	virtual uint32_t Read(uint8_t* data, uint32_t length);
 	virtual uint32_t GetNumberOfBytesReady()=0;
 };
 
 //UartBase_t - implementation of base UART functions
 /////////////////////////////////////////////////////////////////////
+/*
+* BRR holds USARTDIV = clock/(16*baud) as 12.4 fixed point number, so its value
+* is clock/baud, rounded to nearest. Highest rate is clock/16 (2 Mbaud at 32 MHz
+* APB2, 4.5 Mbaud at 72 MHz). Rate is refused if BRR is out of range or actual
+* rate differs from wanted more than UART_MAX_ERROR_PPM, receiver tolerates
+* about 3.75% of both sides together.
+*/
+
+#define UART_MAX_ERROR_PPM 20000
 
-class Uart_t:public iWriter_t, public iReader_t {
+namespace uart {
+	uint32_t GetBrr(uint32_t clockHz, uint32_t baud);
+	// Actual rate relative to wanted, ppm
+	int32_t GetErrorPpm(uint32_t clockHz, uint32_t baud);
+	// retvBadValue - rate can't be set with this clock
+	uint8_t CheckBaud(uint32_t clockHz, uint32_t baud);
+	inline uint32_t GetMaxBaud(uint32_t clockHz) {return clockHz/16;}
+} // namespace uart
+
+class Uart_t final:public iWriter_t, public iReader_t {
 protected:
 	USART_TypeDef* Usart;
+	RxCallback_t Callback;
+	UartStats_t Stats;
+	uint32_t Baud;
+	int32_t ErrorPpm;
 public:
-	void Init(USART_TypeDef* _Usart, uint32_t CurrentClockHz, uint32_t Bod);
-	void UpdateBaudrate( uint32_t CurrentClockHz, uint32_t Bod);
+	// retvBadValue - rate refused, previous one is kept
+	uint8_t Init(USART_TypeDef* _Usart, uint32_t CurrentClockHz, uint32_t Bod);
+	// IDLE line interrupt marks end of received burst when RX is done by DMA,
+	// error interrupt counts overrun, framing, noise and parity errors
+	void EnableRxIrq(uint8_t IrqPrio, RxCallback_t callback);
+	uint8_t IrqHandler();
+	inline const UartStats_t* GetStats() {return &Stats;}
+	inline void ClearStats() {memset(&Stats, 0, sizeof(Stats));}
+	uint8_t UpdateBaudrate( uint32_t CurrentClockHz, uint32_t Bod);
+	inline uint32_t GetBaud() {return Baud;}
+	inline int32_t GetErrorPpm() {return ErrorPpm;}
 	inline void Enable() { Usart->CR1 |= USART_CR1_UE; }
 	inline void Disable() { Usart->CR1 &= ~USART_CR1_UE; }
 	inline void EnableDmaRequest(uint32_t request) {Usart->CR3 |= request;}
 
 	// Writer interface
 	uint8_t WriteChar(uint8_t data);
+	uint32_t Write(const uint8_t* data, uint32_t length);
 	uint8_t StartTransmission(){ return retvOk;} // Empty function for compatibility
 
 	// Reader interface
 	uint8_t ReadChar(retv_t* retv = NULL);
-	uint32_t GetNumberOfBytesReady(); // Empty function for compatibility
+	uint32_t Read(uint8_t* data, uint32_t length); // Only already received bytes
+	uint32_t GetNumberOfBytesReady();
 }; //Uart_t end
 
+//AutoBaud_t - rate of incoming sync character
+/////////////////////////////////////////////////////////////////////
+/*
+* Timer channel captures falling edges of RX pin. Sync character 0x55 ('U')
+* has five falling edges two bits apart, first and last are 8 bits apart.
+* First edge raises interrupt, handler polls other four captures and checks
+* spacing, so other characters are refused. Polling limits rate to about
+* 1 Mbaud at 32 MHz timer clock, 8 bits must fit 16-bit counter at lowest
+* rate. Result is snapped to standard rate within AUTOBAUD_SNAP_PPM.
+* Needs IRQ handler wrapper.
+*
+* Example (PB7 - TIM4_CH2 is RX of remapped USART1)
+*
+AutoBaud_t CmdAutoBaud(TIM4, 2);
+CmdAutoBaud.Init(timersClock, TIM_IRQ_PRIORITY, AutoBaudCallback);
+CmdAutoBaud.Start();
+extern "C" {
+void TIM4_IRQHandler(){
+	CmdAutoBaud.IrqHandler();
+} }
+*/
+
+#define AUTOBAUD_SNAP_PPM 30000
+#define AUTOBAUD_SYNC_BITS 8 // Between first and last falling edge of 0x55
+
+typedef enum{
+	autoBaudIdle,
+	autoBaudArmed,
+	autoBaudDone,
+	autoBaudFailed // Not sync character or missed edge
+} AutoBaudState_t;
+
+// Called from interrupt, baud 0 - failed
+typedef void (*AutoBaudCallback_t)(uint32_t baud);
+
+class AutoBaud_t{
+protected:
+	TIM_TypeDef* Timer;
+	uint8_t Channel; // 1..4
+	uint32_t TimerClockHz;
+	AutoBaudCallback_t Callback;
+	volatile uint8_t State;
+	uint32_t MeasuredBaud;
+	uint32_t Baud; // Snapped to standard rate
+	void Stop();
+	uint8_t Measure();
+public:
+	AutoBaud_t(TIM_TypeDef* timer, uint8_t channel){
+		Timer = timer;
+		Channel = channel;
+		TimerClockHz = 0;
+		Callback = NULL;
+		State = autoBaudIdle;
+		MeasuredBaud = 0;
+		Baud = 0;
+	}
+	// Timer clock must be enabled
+	void Init(uint32_t timerClockHz, uint8_t irqPrio, AutoBaudCallback_t callback);
+	void Start();
+	inline void Cancel() {Stop(); State = autoBaudIdle;}
+	uint8_t IrqHandler();
+	inline uint8_t GetState() {return State;}
+	inline void ClearState() {State = autoBaudIdle;}
+	inline uint32_t GetMeasuredBaud() {return MeasuredBaud;}
+	inline uint32_t GetBaud() {return Baud;}
+	static uint32_t SnapBaud(uint32_t baud);
+};
+
 //UartDma_t - enables capability to transmit and receive data through DMA
 /////////////////////////////////////////////////////////////////////
 /*
@@ -83,80 +241,158 @@ void DMAx_Channelx_IRQHandler(){
 */
 
 // Memory to peripheral DMA TX channel
-class DmaTx_t:public iWriter_t {
+/*
+* Besides ring buffer, optional descriptor queue lets DMA send existing
+* buffers without copying. Order of data is kept: descriptor is sent after
+* ring buffer bytes written before it. Write() queues flash data of
+* DMATX_ZERO_COPY_MIN bytes or more automatically, RAM buffers are queued
+* by Send() and must not change until callback is called.
+*
+TxDescriptor_t CmdTxQueue[8];
+DmaTx_t CmdTxDma(&DmaCh4, CmdTxBuffer, 128, CmdTxQueue, 8);
+CmdTxDma.Send(frame, sizeof(frame), FrameSentCallback, NULL);
+*/
+
+#define DMATX_ZERO_COPY_MIN 32 // Shorter flash data copied, cheaper than extra DMA interrupt
+
+/*
+* Several tasks and interrupts may write at the same time. Writer reserves
+* space for whole record with LDREX/STREX, fills it and commits. Reserve
+* pointer, commit pointer and number of writers filling their space are
+* packed in one word. When the last writer commits, commit pointer moves to
+* reserve pointer, DMA sends only committed data. Ring size is limited
+* to DMATX_PTR_MASK bytes.
+*/
+#define DMATX_PTR_MASK 		0xFFFUL
+#define DMATX_COMMIT_POS 	12
+#define DMATX_WRITERS_POS 	24
+
+/*
+* Coalescing - StartTransmission() starts DMA only when Threshold bytes
+* are committed, smaller amount is sent by TickHandler() after deadline
+* or by Flush(). Data written while DMA is busy is sent right after
+* transfer complete. TickHandler() should be called every 1 ms, from RTOS
+* tick hook for example.
+*/
+class DmaTx_t final:public iWriter_t {
 protected:
 	uint8_t* Buffer;
 	uint16_t BufferSize;
-	uint16_t BufferStartPtr;
-	uint16_t BufferEndPtr;
+	volatile uint16_t BufferStartPtr; // Advanced when DMA transfer completed
+	volatile uint32_t State; // [31:24] writers, [23:12] commit pointer, [11:0] reserve pointer
+	uint16_t InFlight; // Ring buffer bytes being sent
 	DmaChannel_t* Dma;
+	TxDescriptor_t* Queue;
+	uint8_t QueueSize;
+	volatile uint8_t QueueHead;
+	volatile uint8_t QueueTail;
+	volatile uint8_t SendingDescriptor;
+	TxOverflowPolicy_t Policy;
+	uint32_t TimeoutMs;
+	TxWaitHook_t WaitHook;
+	TxSpaceHook_t SpaceHook;
+	volatile uint32_t DroppedBytes;
+	uint16_t Threshold; // 0 - coalescing disabled
+	uint16_t DeadlineMs;
+	volatile uint16_t FlushCountdown;
+	volatile uint8_t Held; // Data is kept until released
+	DmaTxStats_t Stats;
+	uint8_t Transmit();
+	uint8_t Reserve(uint32_t length, uint32_t* position);
+	void Commit();
+	uint8_t MakeSpace(uint32_t length);
+	uint8_t DiscardOldest();
 public:
-	DmaTx_t(DmaChannel_t* dma, uint8_t* buffer, uint16_t bufferSize){
+	DmaTx_t(DmaChannel_t* dma, uint8_t* buffer, uint16_t bufferSize,
+			TxDescriptor_t* queue = NULL, uint8_t queueSize = 0){
+		ASSERT_SIMPLE(bufferSize <= DMATX_PTR_MASK);
 		Dma = dma;
 		Buffer = buffer;
 		BufferSize = bufferSize;
+		Queue = queue;
+		QueueSize = queueSize;
+		QueueHead = 0;
+		QueueTail = 0;
+		InFlight = 0;
+		SendingDescriptor = 0;
+		BufferStartPtr = 0;
+		State = 0;
+		Policy = txDropNewest;
+		TimeoutMs = 0;
+		WaitHook = NULL;
+		SpaceHook = NULL;
+		DroppedBytes = 0;
+		Threshold = 0;
+		DeadlineMs = 0;
+		FlushCountdown = 0;
+		Held = 0;
+		memset(&Stats, 0, sizeof(Stats));
 	}
 	void Init(uint32_t PeriphRegAdr, uint8_t DmaIrqPrio = 0, DmaChPrio_t ChPrio = dmaLowChPrio);
 	uint32_t GetNumberOfBytesInBuffer();
 	uint32_t CheckStatus(); //0 - disable
 	uint8_t IrqHandler();
+	// Queue buffer for zero copy transmission, callback may be NULL
+	uint8_t Send(const uint8_t* data, uint16_t length, TxCallback_t callback, void* context);
+	uint32_t GetQueueFree();
+	// Interrupts never block, txBlock drops newest record for them
+	void SetOverflowPolicy(TxOverflowPolicy_t policy, uint32_t timeoutMs = 0,
+			TxWaitHook_t waitHook = NULL, TxSpaceHook_t spaceHook = NULL);
+	inline uint32_t GetDroppedBytes() {return DroppedBytes;}
+	void SetCoalescing(uint16_t thresholdBytes, uint16_t deadlineMs);
+	inline uint8_t Flush() {return Transmit();}
+	void TickHandler();
+	// Nobody listens, output waits in buffer (overflow policy applies) and is sent on release
+	void Hold(uint8_t held);
+	inline uint8_t IsHeld() {return Held;}
+	inline const DmaTxStats_t* GetStats() {return &Stats;}
+	inline void ClearStats() {memset(&Stats, 0, sizeof(Stats));}
 
 	// Writer interface
 	uint8_t WriteChar(uint8_t data);
+	uint32_t Write(const uint8_t* data, uint32_t length);
 	uint8_t StartTransmission();
 }; //DmaTx_t end
 
 // Peripheral to memory DMA RX channel
-class DmaRx_t:public iReader_t {
+class DmaRx_t final:public iReader_t {
 protected:
 	uint8_t* Buffer;
 	uint16_t BufferSize;
 	uint16_t BufferStartPtr;
 	uint16_t GetBufferEndPtr();
 	DmaChannel_t* Dma;
+	RxCallback_t Callback;
+	// Lap tracking, valid when interrupts enabled
+	volatile uint32_t WriteLaps;
+	uint32_t ReadTotal;
+	DmaRxStats_t Stats;
+	uint32_t GetWriteTotal();
+	uint32_t CheckOverrun();
 public:
 	DmaRx_t(DmaChannel_t* dma, uint8_t* buffer, uint16_t bufferSize){
 		Dma = dma;
 		Buffer = buffer;
 		BufferSize = bufferSize;
+		Callback = NULL;
+		WriteLaps = 0;
+		ReadTotal = 0;
+		memset(&Stats, 0, sizeof(Stats));
 	}
 	void Init(uint32_t PeriphRegAdr, DmaChPrio_t ChPrio = dmaLowChPrio);
+	// Half transfer and transfer complete interrupts, needed for overrun detection
+	void EnableIrq(uint8_t DmaIrqPrio, RxCallback_t callback);
+	const DmaRxStats_t* GetStats();
+	inline void ClearStats() {memset(&Stats, 0, sizeof(Stats));}
+	uint8_t IrqHandler();
 	void Start();
 	inline void Stop();
 	uint32_t CheckStatus(); //0 - disable
 
 	// Reader interface
 	uint8_t ReadChar(retv_t* retv = NULL);
+	uint32_t Read(uint8_t* data, uint32_t length);
 	uint32_t GetNumberOfBytesReady();
 }; //DmaRx_t end
 
-//Cli_t - Simple command line interface
-/////////////////////////////////////////////////////////////////////
-
-int32_t strToInt(char* text);
-
-#define COMMAND_BUFFER_SIZE (128UL)
-
-class Cli_t {
-protected:
-	iWriter_t* TxChannel;
-	iReader_t* RxChannel;
-	void PutBinary(uint32_t binary);
-	void PutString(const char* text);
-	void PutInt(int32_t number);
-	void PutUnsignedInt(uint32_t number);
-	void PutUnsignedHex(uint32_t number);
-public:
-	Cli_t(iWriter_t* _TxChannel, iReader_t* _RxChannel) {
-		TxChannel = _TxChannel;
-		RxChannel = _RxChannel;
-	}
-	char CommandBuffer[COMMAND_BUFFER_SIZE];
-	//Methods
-	void Clear() {CommandBuffer[0] = '\0';}
-	void Printf(const char* text, ...);
-	char* Read();
-	char* ReadLine();
-};
-
 #endif /* INC_INTERFACE_H_ */
@@ -0,0 +1,233 @@
+/*
+ * jdy23.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#ifndef JDY23_H_
+#define JDY23_H_
+
+#include <stdint.h>
+#include <cstring>
+//
+#include <lib_F103.h>
+#include <gpio_F103.h>
+#include <interface_F103.h>
+
+//Jdy23_t - JDY-23 BLE module configuration
+/////////////////////////////////////////////////////////////////////
+/*
+* AT commands are sent one by one, answers are passed by owner of RX channel
+* to ProcessLine() as they arrive, Poll() retries command after timeout.
+* Nothing blocks, owner task keeps serving other sessions meanwhile.
+*
+* Version is asked at cached baud rate, then at other rates until module
+* answers. If version matches cached one, MAC and name are taken from cache
+* (Settings_t), otherwise they are queried again, name is set if differs and
+* cache is marked changed.
+*
+* Then link is raised to maximum rate: AT+BAUD, AT+RESET, local UART switched
+* by setBaud callback and JDY23_VERIFY_COUNT version requests must come back
+* intact. Failed rate is recorded and module is told to go one rate lower
+* without waiting for answer, if that fails too it is found again by probing
+* and next lower rate is tried. Throughput of verified exchanges is kept per rate.
+*
+* Example
+*
+Jdy23_t Ble(&BleTxDma, BleSetBaud, PA4, &Settings.Ble, "GenshinVision", 115200);
+Ble.Start(GetTimeMs());
+while(Ble.IsBusy()){
+	char* line = BleCli.ReadLine();
+	if(line != NULL)
+		Ble.ProcessLine(line, GetTimeMs());
+	if(Ble.Poll(GetTimeMs()) == retvOk)
+		break; // Finished, check GetState()
+	vTaskDelay(pdMS_TO_TICKS(Ble.GetWaitMs(GetTimeMs())));
+}
+*/
+
+#define JDY23_TIMEOUT_MS 300 // Answer wait per attempt
+#define JDY23_RESET_MS 500 // Module restart after baud rate change
+#define JDY23_RETRIES 3
+#define JDY23_VERIFY_COUNT 4 // Intact answers to accept new baud rate
+#define JDY23_VERSION_SIZE 24
+#define JDY23_MAC_SIZE 16
+#define JDY23_NAME_SIZE 20
+#define JDY23_RATE_COUNT 5
+#define JDY23_DEFAULT_BAUD 9600
+
+// Local UART switch, called when TX of previous command may still run
+typedef void (*Jdy23SetBaud_t)(uint32_t baud);
+
+// Cached module information, part of Settings_t
+typedef struct{
+	char Version[JDY23_VERSION_SIZE];
+	char Mac[JDY23_MAC_SIZE];
+	char Name[JDY23_NAME_SIZE];
+	uint32_t Baud; // Last verified, 0 - default
+} Jdy23Info_t;
+
+typedef struct{
+	uint32_t BytesPerSecond; // Last measured, 0 - not measured
+	uint16_t Verified;
+	uint16_t Failed;
+} Jdy23RateStats_t;
+
+typedef enum{
+	jdyIdle,
+	jdyBusy,
+	jdyReady,
+	jdyFailed // No answer after retries
+} Jdy23State_t;
+
+typedef enum{
+	jdyStepProbe,
+	jdyStepMac,
+	jdyStepName,
+	jdyStepSetName,
+	jdyStepBaud,
+	jdyStepReset,
+	jdyStepVerify,
+	jdyStepDone
+} Jdy23Step_t;
+
+namespace jdy23 {
+	// Rates of AT+BAUD4..AT+BAUD8
+	const uint32_t Rates[JDY23_RATE_COUNT] = {9600, 19200, 38400, 57600, 115200};
+	uint8_t GetRateIndex(uint32_t baud); // Nearest lower or equal rate
+} // namespace jdy23
+
+class Jdy23_t{
+protected:
+	iWriter_t* Tx;
+	Jdy23SetBaud_t SetBaud;
+	GPIO_TypeDef* PwrcGpio; // Low - AT commands
+	uint8_t PwrcPin;
+	Jdy23Info_t* Info;
+	const char* Name; // Wanted name
+	uint8_t State;
+	uint8_t Step;
+	uint8_t Retries;
+	uint8_t Finished; // Reported by Poll()
+	uint8_t InfoChanged;
+	uint8_t InfoChecked; // Version compared with cache
+	uint8_t NameSet;
+	uint8_t Rate; // Index of local UART rate
+	uint8_t TargetRate;
+	uint8_t MaxRate;
+	uint8_t ProbeCount;
+	uint8_t Blind; // Rate lowered without answers
+	uint8_t VerifyCount;
+	uint32_t VerifyBytes;
+	uint32_t VerifyStartMs;
+	uint32_t SentBytes; // Of last command with line end
+	uint32_t StartMs;
+	uint32_t SentMs;
+	uint32_t ReadyMs; // First answer after start, 0 - no answer
+	Jdy23RateStats_t RateStats[JDY23_RATE_COUNT];
+	void Send(uint32_t nowMs);
+	void NextStep(uint8_t step, uint32_t nowMs);
+	void Finish(uint8_t state);
+	void SwitchRate(uint8_t rate);
+	void InfoDone(uint32_t nowMs);
+	void Fallback(uint32_t nowMs);
+	void AddThroughput(uint32_t bytes, uint32_t ms);
+	uint32_t GetTimeoutMs() {return Step == jdyStepReset ? JDY23_RESET_MS : JDY23_TIMEOUT_MS;}
+	static uint8_t CopyValue(const char* line, const char* key, char* value, uint32_t size);
+public:
+	Jdy23_t(iWriter_t* tx, Jdy23SetBaud_t setBaud, GPIO_TypeDef* pwrcGpio, uint8_t pwrcPin,
+			Jdy23Info_t* info, const char* name, uint32_t maxBaud){
+		Tx = tx;
+		SetBaud = setBaud;
+		PwrcGpio = pwrcGpio;
+		PwrcPin = pwrcPin;
+		Info = info;
+		Name = name;
+		State = jdyIdle;
+		Step = jdyStepDone;
+		Retries = 0;
+		Finished = 0;
+		InfoChanged = 0;
+		InfoChecked = 0;
+		NameSet = 0;
+		Rate = 0;
+		TargetRate = 0;
+		MaxRate = jdy23::GetRateIndex(maxBaud);
+		ProbeCount = 0;
+		Blind = 0;
+		VerifyCount = 0;
+		VerifyBytes = 0;
+		VerifyStartMs = 0;
+		SentBytes = 0;
+		StartMs = 0;
+		SentMs = 0;
+		ReadyMs = 0;
+		memset(RateStats, 0, sizeof(RateStats));
+	}
+	void Start(uint32_t nowMs);
+	// retvOk - line was module answer
+	uint8_t ProcessLine(const char* line, uint32_t nowMs);
+	// retvOk once after configuration finished, retvBusy while running
+	uint8_t Poll(uint32_t nowMs);
+	uint32_t GetWaitMs(uint32_t nowMs); // Until next timeout
+	inline uint8_t IsBusy() {return State == jdyBusy;}
+	inline uint8_t GetState() {return State;}
+	inline uint8_t IsInfoChanged() {return InfoChanged;}
+	inline const Jdy23Info_t* GetInfo() {return Info;}
+	inline uint32_t GetReadyMs() {return ReadyMs;}
+	inline uint32_t GetBaud() {return jdy23::Rates[Rate];}
+	inline const Jdy23RateStats_t* GetRateStats(uint8_t rate) {return &RateStats[rate];}
+};
+
+//Jdy23Link_t - connection state from STATUS pin
+/////////////////////////////////////////////////////////////////////
+/*
+* STATUS is high while central is connected. Both edges raise EXTI interrupt,
+* pin level is read again there, so short glitch gives no event. Subscribers
+* are called from interrupt with new state and must only set flags or notify
+* tasks. Needs EXTI IRQ handler wrapper.
+*
+* Example
+*
+Jdy23Link_t BleLink(PA6);
+BleLink.Subscribe(BleLinkChanged);
+BleLink.Init(EXTI_IRQ_PRIORITY);
+extern "C" {
+void EXTI9_5_IRQHandler(){
+	BleLink.IrqHandler();
+} }
+*/
+
+#define JDY23_LINK_SUBSCRIBERS 4
+
+typedef void (*Jdy23LinkCallback_t)(uint8_t connected);
+
+class Jdy23Link_t{
+protected:
+	GPIO_TypeDef* Gpio;
+	uint8_t Pin;
+	volatile uint8_t Connected;
+	Jdy23LinkCallback_t Subscribers[JDY23_LINK_SUBSCRIBERS];
+	uint8_t SubscriberCount;
+	volatile uint32_t Connects;
+	volatile uint32_t Disconnects;
+public:
+	Jdy23Link_t(GPIO_TypeDef* gpio, uint8_t pin){
+		Gpio = gpio;
+		Pin = pin;
+		Connected = 0;
+		SubscriberCount = 0;
+		Connects = 0;
+		Disconnects = 0;
+	}
+	void Init(uint8_t irqPrio);
+	// Before Init(), retvOutOfMemory - no free slot
+	uint8_t Subscribe(Jdy23LinkCallback_t callback);
+	uint8_t IrqHandler();
+	inline uint8_t IsConnected() {return Connected;}
+	inline uint32_t GetConnects() {return Connects;}
+	inline uint32_t GetDisconnects() {return Disconnects;}
+};
+
+#endif /* JDY23_H_ */
@@ -145,36 +145,38 @@ public:
 	}
 };
 
-//Commands templates
+//Log2 histogram - bin 0 counts zeros, bin i counts values in [2^(i-1), 2^i)
 /////////////////////////////////////////////////////////////////////
-
-/*Callback without arguments
- * Example:
- * void HelpCallback();
- * Command_t Help((char*)"help", HelpCallback);
-*/
-struct Command_t {
-	const char* Name;
-	void (*Callback)();
-
-	Command_t(const char* _Name, void (*_Callback)()) {
-		Name = _Name;
-		Callback = _Callback;
+template <uint32_t Bins>
+class Histogram_t{
+private:
+	uint32_t Counts[Bins];
+public:
+	Histogram_t(){
+		Clear();
 	}
-};
-
-/*Callback with argument
- * Example:
- * void EchoCallback(uint32_t);
- * CommandWithArgs_t Echo((char*)"echo", EchoCallback);
- */
-struct CommandWithArgs_t {
-	const char* Name;
-	void (*Callback)(uint32_t);
-
-	CommandWithArgs_t(const char* _Name, void (*_Callback)(uint32_t)) {
-		Name = _Name;
-		Callback = _Callback;
+	void Add(uint32_t value){
+		uint32_t bin = (value == 0) ? 0 : 32 - __builtin_clz(value);
+		if(bin >= Bins)
+			bin = Bins - 1; // Last bin counts everything above
+		Counts[bin]++;
+	}
+	uint32_t Get(uint32_t bin){
+		return Counts[bin];
+	}
+	// Upper bound of bin
+	static uint32_t GetBinLimit(uint32_t bin){
+		return 1UL << bin;
+	}
+	uint32_t GetTotal(){
+		uint32_t total = 0;
+		for(uint32_t i = 0; i < Bins; i++)
+			total += Counts[i];
+		return total;
+	}
+	void Clear(){
+		for(uint32_t i = 0; i < Bins; i++)
+			Counts[i] = 0;
 	}
 };
 
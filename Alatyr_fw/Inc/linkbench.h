@@ -0,0 +1,103 @@
+/*
+ * linkbench.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#ifndef LINKBENCH_H_
+#define LINKBENCH_H_
+
+#include <stdint.h>
+#include <cstring>
+//
+#include <lib_F103.h>
+#include <rcc_F103.h>
+#include <interface_F103.h>
+
+//LinkBench_t - serial link throughput and latency
+/////////////////////////////////////////////////////////////////////
+/*
+* Runs on writer and reader of one link for given time, host counterpart is
+* Alatyr_tools/serial_bench.py. Data is counter stream, byte n is n & 0xFF,
+* written and checked in chunks of Size bytes.
+*
+* linkTx 	- chunks written as fast as writer takes them, host checks stream
+* linkRx 	- host streams, received bytes are checked
+* linkEcho 	- chunk sent and same bytes awaited back (host echo or TX-RX
+* 			  jumper), round trip time sampled
+*
+* Every round trip goes to log-linear histogram, 8 bins per power of two, so
+* p50 and p99 are upper bounds of their bin, at most 1/8 above. Times under
+* 16 us and maximum are exact.
+*
+* Wait hook is called when there is nothing to do, so other tasks run and
+* idle time can be measured. Caller owns both channels during run.
+*
+* Example
+*
+LinkBench_t Bench(cyclesPerUs, BenchWait);
+Bench.Run(&BleTxDma, &BleRxDma, linkEcho, 32, 2000);
+const LinkBenchResult_t* result = Bench.GetResult();
+*/
+
+#define LINKBENCH_MAX_SIZE 128 // Chunk
+#define LINKBENCH_ECHO_TIMEOUT_MS 200
+#define LINKBENCH_BINS 128 // Round trip histogram up to 262 ms
+#define LINKBENCH_SETTLE_MS 100 // Quiet line before and after run
+#define LINKBENCH_MAX_TIME_MS 60000 // Cycle counter wraps after 134 s at 32 MHz
+
+typedef enum{
+	linkTx,
+	linkRx,
+	linkEcho
+} LinkBenchMode_t;
+
+typedef struct{
+	uint32_t Bytes; // Sent for linkTx, received intact otherwise
+	uint32_t Errors; // Damaged, lost or unexpected bytes
+	uint32_t Timeouts; // Echo not complete in time
+	uint32_t ElapsedUs;
+	uint32_t RoundTrips;
+	uint32_t LatencyP50Us;
+	uint32_t LatencyP99Us;
+	uint32_t LatencyMaxUs;
+} LinkBenchResult_t;
+
+typedef void (*LinkBenchWait_t)();
+
+class LinkBench_t{
+protected:
+	uint32_t CyclesPerUs;
+	LinkBenchWait_t Wait;
+	uint8_t Buffer[LINKBENCH_MAX_SIZE];
+	uint16_t Histogram[LINKBENCH_BINS];
+	uint8_t TxCounter;
+	uint8_t RxCounter;
+	LinkBenchResult_t Result;
+	void RunTx(iWriter_t* tx, uint32_t size, uint32_t durationUs);
+	void RunRx(iReader_t* rx, uint32_t durationUs);
+	void RunEcho(iWriter_t* tx, iReader_t* rx, uint32_t size, uint32_t durationUs);
+	uint32_t Check(const uint8_t* data, uint32_t length);
+	void AddRoundTrip(uint32_t us);
+	uint32_t GetPercentile(uint32_t percent);
+	void ComputeLatency();
+	inline uint32_t GetUs(uint32_t startCycles) {return (dwt::GetCycles() - startCycles)/CyclesPerUs;}
+public:
+	LinkBench_t(uint32_t cyclesPerUs, LinkBenchWait_t wait){
+		CyclesPerUs = cyclesPerUs;
+		Wait = wait;
+		TxCounter = 0;
+		RxCounter = 0;
+		memset(&Result, 0, sizeof(Result));
+		memset(Histogram, 0, sizeof(Histogram));
+	}
+	// retvBadValue - wrong mode or size
+	uint8_t Run(iWriter_t* tx, iReader_t* rx, uint8_t mode, uint32_t size, uint32_t durationMs);
+	// Reads and drops input until line is quiet for LINKBENCH_SETTLE_MS, returns dropped bytes
+	uint32_t Drain(iReader_t* rx);
+	inline const LinkBenchResult_t* GetResult() {return &Result;}
+	inline uint32_t GetBytesPerSecond() {return Result.ElapsedUs ? (uint64_t)Result.Bytes*1000000/Result.ElapsedUs : 0;}
+};
+
+#endif /* LINKBENCH_H_ */
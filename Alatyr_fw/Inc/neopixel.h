@@ -12,11 +12,40 @@
 #include <lib_F103.h>
 #include <interface_F103.h>
 #include <tim_F103.h>
+#include <gpio_F103.h>
 
 #define NPX_TIM_FREQUECY 	8000000  	// 1 tick = 125ns
 #define NPX_ARR 			9  			// timer reload after 125ns*(9+1) = 1250ns
 #define NPX_LOW 			2  			// 125ns*(2+1) = 375ns
 #define NPX_HIGH 			5 			// 125ns*(5+1) = 750ns
+#define NPX_STOP 			0 			// Slot after last bit, keeps line low
+// Timer values of frame, DMA runs one value ahead of output and ends on stop slot
+#define NPX_FRAME_SIZE(length) (24*(length) + 1)
+
+// Color calibration - 3x3 matrix and white balance, fixed point 8.8 (NPX_CAL_ONE = 1.0)
+#define NPX_CAL_ONE 		256
+#define NPX_CAL_MIN 		(-32768) 	// Matrix element range, also of matrix merged with white balance
+#define NPX_CAL_MAX 		32767
+#define NPX_WB_MAX 			65535
+
+typedef struct{
+	int16_t Matrix[9]; // GRB order, row - output channel, column - input channel
+	uint16_t WhiteBalance[3]; // G, R, B gain
+} NpxCalibration_t;
+
+// Power model - WS2812B supply current per LSB of every channel and quiescent current per LED
+#define NPX_G_UA_PER_LSB 	47 			// ~12mA at 255
+#define NPX_R_UA_PER_LSB 	47
+#define NPX_B_UA_PER_LSB 	47
+#define NPX_IDLE_UA_PER_LED 600
+#define NPX_MAX_BUDGET_MA 	10000
+// Current limiter - scale 256 is full brightness, release step is 1/NPX_LIMIT_RELEASE of headroom per frame
+#define NPX_SCALE_MAX 		256
+#define NPX_LIMIT_RELEASE 	8
+// Boost converter gating
+#define NPX_BOOST_IDLE_UA 	150 		// MT3608 input current without load
+#define NPX_GATE_DATA_PINS 	2 			// SPI strip has clock and data
+#define NPX_GATE_FLUSH_US 	10000 		// Longest wait for last frame before clocks are gated
 
 // Simple colors
 /////////////////////////////////////////////////////////////////////
@@ -45,6 +74,23 @@ inline uint32_t ColorToGbr(Color_t color, uint8_t brightness);
 // colorIndex[0,255], brightness [3,127] - values lower then 3 have low color resolution
 uint32_t MakeHexGrbColor(uint8_t colorIndex, uint8_t brightness);
 uint32_t RgbToGrb(uint32_t rgbVal);
+// scale [0,256]
+uint32_t ScaleGrbColor(uint32_t grbColor, uint32_t scale);
+
+//iLedStrip_t - common interface of LED strip drivers used by effects
+/////////////////////////////////////////////////////////////////////
+class iLedStrip_t{
+public:
+	virtual void WriteLedColor(uint8_t ledNumber, uint32_t grbColor)=0;
+	virtual void Update()=0;
+	// Send frame prepared in strip native format, retvFail if not supported
+	virtual uint8_t UpdateFromBuffer(const uint8_t* buffer)=0;
+	virtual void Clear()=0;
+	virtual uint16_t GetLength()=0;
+	virtual uint8_t IsBusy()=0;
+	virtual uint8_t IsBlack()=0;
+	virtual uint32_t GetFrameCycles()=0; // Duration of last sent frame
+};
 
 //Neopixel_t - driver for neopixel WS2812
 /////////////////////////////////////////////////////////////////////
@@ -53,27 +99,44 @@ uint32_t RgbToGrb(uint32_t rgbVal);
 * Wrapper example
 *
 #define NEOPIXEL_LENGTH 3
-// DMA on neopixel TIM update request
-DmaChannel_t DmaCh5 = {.Channel = DMA1_Channel5, .Number = 5, .Irq = DMA1_Channel5_IRQn};
+// DMA on TIM1 channel 1 compare request
+DmaChannel_t DmaCh2 = {.Channel = DMA1_Channel2, .Number = 2, .Irq = DMA1_Channel2_IRQn};
 // External buffer
-uint8_t NeopixelBuffer[24*NEOPIXEL_LENGTH];
+uint8_t NeopixelBuffer[NPX_FRAME_SIZE(NEOPIXEL_LENGTH)];
 // Neopixel class declaration
-Neopixel_t LedStrip(TIM1, 1, &DmaCh5, NeopixelBuffer, NEOPIXEL_LENGTH);
+Neopixel_t LedStrip(TIM1, 1, &DmaCh2, NeopixelBuffer, NEOPIXEL_LENGTH);
 // External interrupt handler wrapper compatible with CMSIS
 extern "C" {
-	void DMA1_Channel5_IRQHandler(){
+	void DMA1_Channel2_IRQHandler(){
 		LedStrip.IrqHandler();
 	}
 }
+*
+* Compare value of next bit is written by DMA on compare event of current one
+* into CCR1 preload, so TIM1_UP request (DMA channel 5) stays free for USART1 RX.
+* Transfer completes on falling edge of last bit, when timer is stopped.
 */
 
-class Neopixel_t{
+class Neopixel_t:public iLedStrip_t{
 protected:
 	TIM_TypeDef* Timer;
 	uint8_t TimerChannelNumber;
 	DmaChannel_t* Dma;
 	uint8_t* Buffer;
 	uint16_t StripLength;
+	// Power limiter
+	uint32_t ChannelSum[3]; // G, R, B sums of encoded frame
+	uint16_t CurrentBudgetMa; // 0 - limiter disabled
+	uint16_t LimitScale;
+	uint32_t EstimatedCurrentUa;
+	// Color calibration, white balance is merged into matrix
+	int16_t CalMatrix[9];
+	uint8_t CalEnabled;
+	uint32_t FrameStartCycles;
+	uint32_t FrameCycles;
+	uint32_t CalibrateColor(uint32_t grbColor);
+	void EncodeLedColor(uint8_t ledNumber, uint32_t grbColor);
+	void LimitCurrent();
 public:
 	Neopixel_t(TIM_TypeDef* timer, uint8_t timNumber,
 			DmaChannel_t* channel, uint8_t* buffer, uint16_t stripLength){
@@ -82,21 +145,130 @@ public:
 		StripLength = stripLength;
 		Timer = timer;
 		TimerChannelNumber = timNumber;
+		ChannelSum[0] = 0; ChannelSum[1] = 0; ChannelSum[2] = 0;
+		CurrentBudgetMa = 0;
+		LimitScale = NPX_SCALE_MAX;
+		EstimatedCurrentUa = 0;
+		CalEnabled = 0;
+		FrameStartCycles = 0;
+		FrameCycles = 0;
+		Buffer[24*StripLength] = NPX_STOP;
 	}
 	void Init(uint32_t currentTimerClock, uint8_t dmaIrqPrio);
 	void Update();
+	// Send already encoded timer data (NPX_FRAME_SIZE bytes), buffer can be placed in flash
+	uint8_t UpdateFromBuffer(const uint8_t* buffer);
+	inline uint16_t GetLength() {return StripLength;}
+	inline uint8_t IsBusy() {return (Dma->Channel->CCR & DMA_CCR_EN) != 0;}
+	inline uint8_t IsBlack() {return (ChannelSum[0] | ChannelSum[1] | ChannelSum[2]) == 0;}
+	inline uint32_t GetFrameCycles() {return FrameCycles;}
 	void Clear(); // Clear buffer (every bit = NPX_LOW) without update
 	void WriteLedColor(uint8_t ledNumber, uint32_t gbrColor);
+	uint32_t ReadLedColor(uint8_t ledNumber); // Color as encoded, after limiter
+	// Calibration is applied by WriteLedColor, not to raw timer data
+	void SetCalibration(const NpxCalibration_t* calibration);
+	// Power limiter, raw timer data sent by UpdateFromBuffer is not limited
+	// 0 - disable limiter, retvBadValue - budget doesn't exceed idle current of strip
+	uint8_t SetCurrentBudget(uint16_t budgetMa);
+	inline uint32_t GetMinBudgetMa() {return StripLength*NPX_IDLE_UA_PER_LED/1000 + 1;}
+	uint32_t EstimateCurrent(); // uA, from channel sums of current buffer
+	inline uint32_t GetEstimatedCurrentUa() {return EstimatedCurrentUa;} // Last sent frame
+	inline uint16_t GetLimitScale() {return LimitScale;}
 	inline uint8_t IrqHandler(){
 		if(DMA1->ISR & DMA_ISR_TCIF1 << 4*(Dma->Number - 1)){
 			DMA1->IFCR = DMA_IFCR_CTCIF1 << 4*(Dma->Number - 1);
 			Dma->Channel->CCR &= ~DMA_CCR_EN;
 			Timer->CR1 &= ~TIM_CR1_CEN;
-			Timer->CNT = 9;
+			Timer->CNT = NPX_ARR; // First tick of next frame loads its first value
+			FrameCycles = dwt::GetCycles() - FrameStartCycles;
 			return retvOk;
 		} else
 			return retvFail;
 	}
 };
 
+//NpxPowerGate_t - switches off 5V boost converter while strip is black
+/////////////////////////////////////////////////////////////////////
+/*
+* Strip is powered off after it was black for holdMs, strip and DMA1 clocks are
+* released to power manager. DMA1 keeps running while UART channels hold it,
+* DmaTx_t and DmaRx_t request it in Init. Before next lit frame boost is enabled again and
+* caller must wait returned settle time before Update()
+*
+* Data pins are driven low while strip is unpowered, high input of unpowered
+* LED back-powers it through protection diode. They get their peripheral
+* mode back at power on. If last frame is not sent in NPX_GATE_FLUSH_US,
+* clocks are gated anyway and stuck transfer is counted.
+*
+* Example
+*
+NpxPowerGate_t NpxGate(&LedStrip, pwrClkTim1, PB1, 1000, 5);
+NpxGate.AddDataPin(PA8, AfOutput10MHzPushPull);
+NpxGate.Init(nowMs);
+// Write frame
+uint32_t settleMs = NpxGate.PrepareFrame(nowMs, LedStrip.IsBlack());
+if(settleMs)
+	vTaskDelay(pdMS_TO_TICKS(settleMs));
+if(NpxGate.IsPowered())
+	LedStrip.Update();
+*/
+
+class NpxPowerGate_t{
+protected:
+	iLedStrip_t* Strip;
+	PowerClock_t StripClock; // Timer or SPI clock of strip driver
+	GPIO_TypeDef* Gpio;
+	uint8_t Pin;
+	uint8_t Powered;
+	uint8_t ForcedOff;
+	uint16_t SettleMs;
+	uint32_t HoldMs;
+	uint32_t BlackSinceMs;
+	uint32_t OffSinceMs;
+	uint32_t OffTimeMs; // Total time with boost disabled
+	uint32_t PowerCycles;
+	uint32_t FlushTimeouts;
+	struct{
+		GPIO_TypeDef* Gpio;
+		uint8_t Pin;
+		PinMode_t Mode; // When powered
+	} DataPins[NPX_GATE_DATA_PINS];
+	uint8_t DataPinCount;
+	void PowerOff(uint32_t nowMs);
+	void PowerOn(uint32_t nowMs);
+public:
+	NpxPowerGate_t(iLedStrip_t* strip, PowerClock_t stripClock, GPIO_TypeDef* gpio, uint8_t pin,
+			uint32_t holdMs, uint16_t settleMs){
+		Strip = strip;
+		StripClock = stripClock;
+		Gpio = gpio;
+		Pin = pin;
+		HoldMs = holdMs;
+		SettleMs = settleMs;
+		Powered = 0;
+		ForcedOff = 0;
+		BlackSinceMs = 0;
+		OffSinceMs = 0;
+		OffTimeMs = 0;
+		PowerCycles = 0;
+		FlushTimeouts = 0;
+		DataPinCount = 0;
+	}
+	// Before Init(), retvOutOfMemory - no free slot
+	uint8_t AddDataPin(GPIO_TypeDef* gpio, uint8_t pin, PinMode_t mode);
+	void Init(uint32_t nowMs); // Boost enabled, clocks requested, data pins set up
+	// Returns time in ms to wait before Update() of lit frame
+	uint32_t PrepareFrame(uint32_t nowMs, uint8_t frameIsBlack);
+	void SetForcedOff(uint8_t forcedOff, uint32_t nowMs);
+	inline void SetHoldTime(uint32_t holdMs) {HoldMs = holdMs;}
+	inline uint8_t IsPowered() {return Powered;}
+	uint32_t GetOffTimeMs(uint32_t nowMs);
+	inline uint32_t GetPowerCycles() {return PowerCycles;}
+	inline uint32_t GetFlushTimeouts() {return FlushTimeouts;}
+	// Supply current saved while gated estimated from power model, uA
+	inline uint32_t GetIdleSavingUa() {
+		return Strip->GetLength()*NPX_IDLE_UA_PER_LED + NPX_BOOST_IDLE_UA;
+	}
+};
+
 #endif /* NEOPIXEL_H_ */
@@ -109,7 +109,19 @@ namespace rcc {
 //Sleep and low power modes
 /////////////////////////////////////////////////////////////////////
 
+// Peripheral clocks shared between drivers, clock is gated when last user releases it
+typedef enum {
+	pwrClkDma1,
+	pwrClkTim1,
+	pwrClkSpi2,
+	pwrClkNumber
+} PowerClock_t;
+
 namespace power {
+	void RequestClock(PowerClock_t clock);
+	void ReleaseClock(PowerClock_t clock);
+	uint8_t GetClockUsers(PowerClock_t clock);
+
 	// If wakeup enabled pin forced low, WKUP on rising edge
 	// PA0
 	// Pin forced pull-down, wakeup on rising edge
@@ -141,8 +153,28 @@ namespace power {
 //FLASH setup
 /////////////////////////////////////////////////////////////////////
 
+#define FLASH_PAGE_SIZE 1024UL // STM32F103xB
+
 namespace flash {
 	void SetFlashPrefetchAndLatency(uint8_t Latency);
+	// Programming, code is stalled while flash is busy
+	inline void Unlock() {FLASH->KEYR = FLASH_KEY1; FLASH->KEYR = FLASH_KEY2;}
+	inline void Lock() {FLASH->CR |= FLASH_CR_LOCK;}
+	uint8_t ErasePage(uint32_t pageAddress, uint32_t Timeout = 0xFFFFF);
+	uint8_t ProgramHalfWords(uint32_t address, const uint16_t* data,
+			uint32_t count, uint32_t Timeout = 0xFFFF);
+}
+
+//DWT cycle counter - used for profiling
+/////////////////////////////////////////////////////////////////////
+
+namespace dwt {
+	inline void EnableCycleCounter() {
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CYCCNT = 0;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	}
+	inline uint32_t GetCycles() {return DWT->CYCCNT;}
 }
 
 //NVIC setup
@@ -0,0 +1,108 @@
+/*
+ * rpc.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#ifndef RPC_H_
+#define RPC_H_
+
+#include <stdint.h>
+#include <cstring>
+//
+#include <lib_F103.h>
+#include <interface_F103.h>
+
+//Binary RPC
+/////////////////////////////////////////////////////////////////////
+/*
+* Packets are COBS encoded and enclosed in 0x00 delimiters, text never has
+* 0x00 so both protocols share one link. RpcLink_t sits between raw RX
+* channel and Cli, text bytes are passed to Cli, packets are executed and
+* answered at once. Host side is Alatyr_tools/rpc_client.py. After a lost
+* delimiter next packet resynchronizes link, see RpcLink_t::Receive.
+*
+* Request	[id][call]...[crc16]
+* Response	[id][result]...[crc16]
+* call 		[argc << 5 | opcode][argc varints]
+* result 	[count << 5 | opcode][status][count varints]
+*
+* id - any, copied to response so host can send next requests without waiting
+* varint - LEB128, 7 bits per byte, low first, signed values are zigzag coded
+* crc16 - CCITT (poly 0x1021, init 0xFFFF) of all previous bytes, low byte first
+* status - retv_t of handler, retvCmdUnknown for opcode out of table
+* Every call of packet is answered in one response packet
+*
+* Example
+*
+uint8_t PingRpc(const RpcArgs_t& args, RpcArgs_t& result);
+const RpcOp_t RpcOps[] = {PingRpc, ...}; // Opcode is index in table
+RpcLink_t BleRpc(&BleRxDma, &BleTxDma, RpcOps, sizeof(RpcOps)/sizeof(RpcOps[0]));
+Cli_t BleCli(&BleTxDma, &BleRpc);
+*/
+
+#define RPC_PACKET_SIZE 64 // Decoded packet with CRC
+#define RPC_MAX_ARGS 7
+#define RPC_MAX_OPS 32
+
+typedef struct{
+	uint8_t Count;
+	uint32_t Arg[RPC_MAX_ARGS];
+} RpcArgs_t;
+
+typedef uint8_t (*RpcOp_t)(const RpcArgs_t& args, RpcArgs_t& result);
+
+typedef struct{
+	uint32_t Packets;
+	uint32_t Calls;
+	uint32_t CrcErrors;
+	uint32_t FrameErrors; // Too long, bad COBS or call encoding
+	uint32_t TxDropped; // Response didn't fit TX buffer
+} RpcStats_t;
+
+namespace rpc {
+	uint16_t Crc16(const uint8_t* data, uint32_t length, uint16_t crc = 0xFFFF);
+	// Returns decoded length, 0 - bad encoding or too long
+	uint32_t CobsDecode(const uint8_t* data, uint32_t length, uint8_t* out, uint32_t outSize);
+	// Returns encoded length without delimiters, out needs length + length/254 + 1 bytes
+	uint32_t CobsEncode(const uint8_t* data, uint32_t length, uint8_t* out);
+	// Return number of bytes, 0 - no space or unterminated value
+	uint32_t PutVarint(uint8_t* out, uint32_t size, uint32_t value);
+	uint32_t GetVarint(const uint8_t* data, uint32_t length, uint32_t* value);
+	inline uint32_t ZigZag(int32_t value) {return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);}
+	inline int32_t UnZigZag(uint32_t value) {return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);}
+} // namespace rpc
+
+class RpcLink_t final:public iReader_t{
+protected:
+	iReader_t* Input;
+	iWriter_t* Output;
+	const RpcOp_t* Ops;
+	uint8_t OpCount;
+	uint8_t InPacket; // Between delimiters
+	uint8_t Length;
+	uint8_t Frame[RPC_PACKET_SIZE + RPC_PACKET_SIZE/254 + 1]; // Encoded
+	RpcStats_t Stats;
+	void Receive(uint8_t data);
+	// retvCRCError, retvBadValue - frame is not a packet
+	uint8_t Execute(const uint8_t* packet, uint32_t length);
+public:
+	RpcLink_t(iReader_t* input, iWriter_t* output, const RpcOp_t* ops, uint8_t opCount){
+		Input = input;
+		Output = output;
+		Ops = ops;
+		OpCount = opCount;
+		InPacket = 0;
+		Length = 0;
+		memset(&Stats, 0, sizeof(Stats));
+	}
+	inline const RpcStats_t* GetStats() {return &Stats;}
+	inline void ClearStats() {memset(&Stats, 0, sizeof(Stats));}
+	// Reader interface, only text bytes, packets are executed while reading
+	uint8_t ReadChar(retv_t* retv = NULL);
+	uint32_t Read(uint8_t* data, uint32_t length);
+	uint32_t GetNumberOfBytesReady(); // Raw bytes, may include packets
+};
+
+#endif /* RPC_H_ */
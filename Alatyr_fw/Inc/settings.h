@@ -0,0 +1,51 @@
+/*
+ * settings.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#ifndef SETTINGS_H_
+#define SETTINGS_H_
+
+#include <stdint.h>
+#include <lib_F103.h>
+#include <rcc_F103.h>
+#include <neopixel.h>
+#include <jdy23.h>
+
+//Device settings stored in last flash page (SETTINGS region in linker script)
+/////////////////////////////////////////////////////////////////////
+/*
+* Record with wrong magic, size or checksum is ignored and defaults are used,
+* so changing Settings_t layout resets settings of updated devices
+*
+* Example
+*
+Settings_t Settings;
+if(settings::Load(&Settings) != retvOk)
+	CmdCli.Printf("[SYS] Default settings\n\r");
+LedStrip.SetCalibration(&Settings.NpxCalibration);
+*/
+
+#define SETTINGS_MAGIC 0x54544553 // "SETT"
+
+typedef struct{
+	uint32_t Magic;
+	uint16_t Size;
+	uint16_t Reserved;
+	NpxCalibration_t NpxCalibration;
+	Jdy23Info_t Ble; // Cached module information
+	uint32_t Checksum; // Must be last
+} Settings_t;
+
+static_assert(sizeof(Settings_t) % 4 == 0, "Settings_t must be word aligned");
+static_assert(sizeof(Settings_t) <= FLASH_PAGE_SIZE, "Settings_t must fit flash page");
+
+namespace settings {
+	void SetDefaults(Settings_t* settings);
+	uint8_t Load(Settings_t* settings); // Defaults are set if no valid record found
+	uint8_t Save(Settings_t* settings);
+}
+
+#endif /* SETTINGS_H_ */
@@ -0,0 +1,80 @@
+/*
+ * shell.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#ifndef SHELL_H_
+#define SHELL_H_
+
+#include <stdint.h>
+#include <cstring>
+//
+#include <lib_F103.h>
+#include <interface_F103.h>
+
+//LineEditor_t - interactive terminal input
+/////////////////////////////////////////////////////////////////////
+/*
+* Sits between raw RX channel and Cli, echoes typed characters and passes
+* only finished lines (ending with '\n') to Cli reader. Prompt is printed
+* when finished line was read out and editor is polled for next one, so it
+* comes after command output.
+*
+* Keys: Backspace/Del - erase, Ctrl+U - clear line, Ctrl+C - drop line,
+* Up/Down - history
+*
+* Example
+*
+LineEditor_t CmdEditor(&CmdRxDma, &CmdTxDma);
+Cli_t CmdShell(&CmdTxDma, &CmdEditor);
+char* command = CmdShell.ReadCommand();
+*/
+
+#define SHELL_LINE_SIZE 64
+#define SHELL_HISTORY_SIZE 4
+#define SHELL_PROMPT "> "
+
+class LineEditor_t final:public iReader_t{
+protected:
+	iReader_t* Input;
+	iWriter_t* Echo;
+	char Line[SHELL_LINE_SIZE];
+	uint8_t Length;
+	uint8_t ReadPtr; // Finished line is read from here
+	uint8_t Ready; // Line finished, Length includes '\n'
+	uint8_t PromptPending;
+	uint8_t LastCr; // CR LF is one line end
+	uint8_t EscState; // ESC [ x sequence
+	char History[SHELL_HISTORY_SIZE][SHELL_LINE_SIZE];
+	uint8_t HistoryCount;
+	uint8_t HistoryHead; // Next entry to write
+	uint8_t HistoryPos; // Recalled entry, 0 - new line
+	void Print(const char* text);
+	void Process();
+	void ProcessChar(char c);
+	void Redraw();
+	void Recall(uint8_t pos);
+	void Finish();
+public:
+	LineEditor_t(iReader_t* input, iWriter_t* echo){
+		Input = input;
+		Echo = echo;
+		Length = 0;
+		ReadPtr = 0;
+		Ready = 0;
+		PromptPending = 1;
+		LastCr = 0;
+		EscState = 0;
+		HistoryCount = 0;
+		HistoryHead = 0;
+		HistoryPos = 0;
+	}
+	// Reader interface, only finished lines
+	uint8_t ReadChar(retv_t* retv = NULL);
+	uint32_t Read(uint8_t* data, uint32_t length);
+	uint32_t GetNumberOfBytesReady();
+};
+
+#endif /* SHELL_H_ */
@@ -0,0 +1,78 @@
+/*
+ * tokenizer.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#ifndef TOKENIZER_H_
+#define TOKENIZER_H_
+
+#include <stdint.h>
+#include <cstring>
+//
+#include <lib_F103.h>
+
+//LineTokenizer_t - incremental command line splitter
+/////////////////////////////////////////////////////////////////////
+/*
+* Received bytes are appended to buffer, line is returned only when its
+* end (CR or LF) is received, so command split between polls is not lost.
+* Bytes after line end stay in buffer for next line. Tokens are separated
+* by spaces in place, Argv points into buffer and is valid until next
+* NextLine() call. Line longer than buffer is dropped up to its end.
+*
+* Example
+*
+char buffer[128];
+LineTokenizer_t Tokenizer(buffer, sizeof(buffer));
+uint32_t free;
+char* space = Tokenizer.GetFreeSpace(&free);
+Tokenizer.Append(Uart.Read((uint8_t*)space, free));
+if((Tokenizer.NextLine() == retvOk) and (Tokenizer.Tokenize() == retvOk))
+	Execute(Tokenizer.GetArgc(), Tokenizer.GetArgv());
+*/
+
+#define TOKENIZER_MAX_ARGS 8
+
+typedef struct{
+	uint32_t Lines;
+	uint32_t Overflows; // Lines longer than buffer
+	uint32_t TooManyArgs;
+} TokenizerStats_t;
+
+class LineTokenizer_t{
+protected:
+	char* Buffer;
+	uint16_t Size;
+	uint16_t Length; // Bytes in buffer
+	uint16_t LineLength; // Current line with terminator, 0 - no line
+	uint16_t Scanned; // Bytes already checked for line end
+	uint8_t Discarding; // Rest of too long line is dropped
+	uint8_t Argc;
+	char* Argv[TOKENIZER_MAX_ARGS];
+	TokenizerStats_t Stats;
+public:
+	LineTokenizer_t(char* buffer, uint16_t size){
+		Buffer = buffer;
+		Size = size;
+		Clear();
+		memset(&Stats, 0, sizeof(Stats));
+	}
+	void Clear();
+	// Free space at buffer end, Append() with number of bytes copied there
+	char* GetFreeSpace(uint32_t* length);
+	void Append(uint32_t length);
+	uint32_t Append(const char* data, uint32_t length);
+	// retvOk - line ready, retvEmpty - no complete line,
+	// retvOutOfMemory - too long line dropped, call again
+	uint8_t NextLine();
+	inline char* GetLine() {return LineLength ? Buffer : NULL;}
+	// retvOutOfMemory - more than TOKENIZER_MAX_ARGS tokens, line rejected
+	uint8_t Tokenize();
+	inline uint8_t GetArgc() {return Argc;}
+	inline char** GetArgv() {return Argv;}
+	inline const TokenizerStats_t* GetStats() {return &Stats;}
+};
+
+#endif /* TOKENIZER_H_ */
@@ -0,0 +1,82 @@
+/*
+ * apa102.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <apa102.h>
+
+void Apa102_t::Init(uint32_t currentSpiClock, uint32_t spiFrequency, uint8_t dmaIrqPrio){
+	// Setup SPI - master, mode 0, 8 bit, MSB first, software NSS
+	uint32_t prescaler = 0; // fPCLK/2
+	while((prescaler < 7) and ((currentSpiClock >> (prescaler + 1)) > spiFrequency))
+		prescaler++;
+	Spi->CR1 = SPI_CR1_MSTR | SPI_CR1_SSM | SPI_CR1_SSI | (prescaler << SPI_CR1_BR_Pos);
+	Spi->CR2 = SPI_CR2_TXDMAEN; // SPI generates DMA request on empty TX buffer
+	Spi->CR1 |= SPI_CR1_SPE;
+
+	// Setup DMA parameters
+	Dma->Channel->CCR =  DMA_CCR_MINC; // Memory increment
+	Dma->Channel->CCR |= dmaLowChPrio << DMA_CCR_PL_Pos; // DMA low priority
+	Dma->Channel->CCR |= DMA_CCR_DIR_Msk; // 1 - Read from memory
+	// Memory and peripheral sizes 8 bit
+	Dma->Channel->CCR |= (0b00 << DMA_CCR_MSIZE_Pos) | (0b00 << DMA_CCR_PSIZE_Pos);
+	Dma->Channel->CPAR = (uint32_t)&Spi->DR;
+	nvic::SetupIrq(Dma->Irq, dmaIrqPrio);
+	Dma->Channel->CCR |= DMA_CCR_TCIE; // Interrupt after DMA transmission
+
+	Clear();
+}
+
+void Apa102_t::Update(){
+	if((Dma->Channel->CCR & DMA_CCR_EN) != 0)
+		return; //Nothing changes if DMA already running
+	FrameStartCycles = dwt::GetCycles();
+	Dma->Channel->CNDTR = APA102_BUFFER_SIZE(StripLength);
+	Dma->Channel->CMAR = (uint32_t)&Buffer[0];
+	Dma->Channel->CCR |= DMA_CCR_EN;
+}
+
+// Start and end frames are zeros, LEDs are black
+void Apa102_t::Clear(){
+	for(uint32_t i = 0; i < APA102_BUFFER_SIZE(StripLength); i++)
+		Buffer[i] = 0;
+	for(uint32_t i = 0; i < StripLength; i++)
+		Buffer[4 + 4*i] = APA102_LED_HEADER;
+	ChannelSum = 0;
+}
+
+static inline uint8_t ScaleChannel(uint32_t value, uint32_t divider){
+	uint32_t result = (value*APA102_MAX_LEVEL + divider/2)/divider;
+	if(result > 255)
+		return 255;
+	return result;
+}
+
+// Color is scaled by brightness to 16 bit, then smallest LED level that keeps
+// channels in 8 bit is chosen - dim colors are sent with low level and full 8-bit values
+void Apa102_t::WriteLedColor(uint8_t ledNumber, uint32_t grbColor){
+	uint32_t g = ((grbColor >> 16) & 0xFF)*Brightness;
+	uint32_t r = ((grbColor >> 8) & 0xFF)*Brightness;
+	uint32_t b = (grbColor & 0xFF)*Brightness;
+	uint32_t max = g;
+	if(r > max) max = r;
+	if(b > max) max = b;
+
+	uint8_t* led = &Buffer[4 + 4*ledNumber];
+	uint32_t oldSum = led[1] + led[2] + led[3];
+	if(max == 0){
+		led[0] = APA102_LED_HEADER;
+		led[1] = 0; led[2] = 0; led[3] = 0;
+	} else {
+		uint32_t fullScale = 255*256;
+		uint32_t level = (max*APA102_MAX_LEVEL + fullScale - 1)/fullScale;
+		uint32_t divider = level*256;
+		led[0] = APA102_LED_HEADER | level;
+		led[1] = ScaleChannel(b, divider); // LED frame order - B, G, R
+		led[2] = ScaleChannel(g, divider);
+		led[3] = ScaleChannel(r, divider);
+	}
+	ChannelSum += led[1] + led[2] + led[3] - oldSum;
+}
@@ -0,0 +1,45 @@
+/*
+ * binlog.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <binlog.h>
+
+static binlog::TimeSource_t TimeSource = NULL;
+
+void binlog::SetTimeSource(TimeSource_t source){
+	TimeSource = source;
+}
+
+void binlog::StartRecord(Record_t& record, uint32_t id){
+	uint32_t time = (TimeSource != NULL) ? TimeSource() : 0;
+	record.Data[0] = BINLOG_SYNC;
+	record.Data[1] = 0; // Length filled when record completed
+	record.Data[2] = id & 0xFF;
+	record.Data[3] = (id >> 8) & 0xFF;
+	memcpy(&record.Data[4], &time, sizeof(time));
+	record.Length = BINLOG_HEADER_SIZE;
+}
+
+void binlog::PutWord(Record_t& record, uint32_t word){
+	if(record.Length + sizeof(word) > BINLOG_RECORD_SIZE)
+		return;
+	memcpy(&record.Data[record.Length], &word, sizeof(word));
+	record.Length += sizeof(word);
+}
+
+// Length prefixed data, cut to fit record
+void binlog::PutBytes(Record_t& record, const void* data, uint32_t length){
+	if(record.Length + 1 > BINLOG_RECORD_SIZE)
+		return;
+	uint32_t space = BINLOG_RECORD_SIZE - record.Length - 1;
+	if(length > space)
+		length = space;
+	if(length > 255)
+		length = 255;
+	record.Data[record.Length] = length;
+	memcpy(&record.Data[record.Length + 1], data, length);
+	record.Length += length + 1;
+}
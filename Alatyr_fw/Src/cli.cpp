@@ -0,0 +1,42 @@
+/*
+ * cli.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <cli.h>
+
+template class Cli<iWriter_t, iReader_t>;
+
+int32_t strToInt(char* text, retv_t* retv){
+	uint8_t ptr = 0;
+	int32_t number = 0;
+	if(text == NULL){
+		*retv = retvNotANumber;
+		return 0;
+	}
+	if(text[0] == '-'){
+		ptr++;
+		while((text[ptr] >= '0') and (text[ptr] <= '9')){
+			number = number*10 - (text[ptr] - '0');
+			ptr++;
+		}
+	} else if((text[0] >= '0') and (text[0] <= '9')){
+		while((text[ptr] >= '0') and (text[ptr] <= '9')){
+			number = number*10 + (text[ptr] - '0');
+			ptr++;
+		}
+	} else{
+		*retv = retvNotANumber;
+		return 0;
+	}
+
+	if(text[ptr] == '\0'){
+		*retv = retvOk;
+		return number;
+	} else {
+		*retv = retvNotANumber;
+		return 0;
+	}
+}
@@ -0,0 +1,120 @@
+/*
+ * clip.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <clip.h>
+
+//ClipPlayer_t
+/////////////////////////////////////////////////////////////////////
+
+uint8_t ClipPlayer_t::Start(const uint8_t* clip){
+	const ClipHeader_t* header = (const ClipHeader_t*)clip;
+	if(header->Magic != CLIP_MAGIC)
+		return retvBadValue;
+	if((header->StripLength > Strip->GetLength()) or (header->FrameCount == 0))
+		return retvBadValue;
+	if(header->Encoding > clipRawTimer)
+		return retvBadValue;
+	// DMA sends whole strip straight from clip
+	if((header->Encoding == clipRawTimer) and (header->StripLength != Strip->GetLength()))
+		return retvBadValue;
+
+	Header = header;
+	Data = clip + sizeof(ClipHeader_t);
+	ReadPtr = 0;
+	Frame = 0;
+	MaxDecodeCycles = 0;
+	Strip->Clear(); // LEDs not covered by clip stay black
+	return retvOk;
+}
+
+uint8_t ClipPlayer_t::DecodeRle(){
+	uint32_t led = 0;
+	while(led < Header->StripLength){
+		if(ReadPtr + 4 > Header->DataSize)
+			return retvEndOfFile;
+		const uint8_t* run = &Data[ReadPtr];
+		uint32_t color = (run[1] << 16) | (run[2] << 8) | run[3];
+		for(uint32_t i = 0; (i < run[0]) and (led < Header->StripLength); i++){
+			Strip->WriteLedColor(led, color);
+			led++;
+		}
+		ReadPtr += 4;
+	}
+	return retvOk;
+}
+
+uint8_t ClipPlayer_t::DecodeDelta(){
+	uint32_t led = 0;
+	while(led < Header->StripLength){
+		if(ReadPtr + 2 > Header->DataSize)
+			return retvEndOfFile;
+		led += Data[ReadPtr]; // Skip unchanged LEDs
+		uint8_t count = Data[ReadPtr + 1];
+		ReadPtr += 2;
+		if(ReadPtr + 3*count > Header->DataSize)
+			return retvEndOfFile;
+		for(uint32_t i = 0; (i < count) and (led < Header->StripLength); i++){
+			const uint8_t* grb = &Data[ReadPtr + 3*i];
+			Strip->WriteLedColor(led, (grb[0] << 16) | (grb[1] << 8) | grb[2]);
+			led++;
+		}
+		ReadPtr += 3*count;
+	}
+	return retvOk;
+}
+
+uint8_t ClipPlayer_t::PlayNextFrame(){
+	if(Header == NULL)
+		return retvEmpty;
+
+	uint32_t startCycles = dwt::GetCycles();
+	uint8_t retv = retvOk;
+	switch(Header->Encoding){
+		case clipRle:
+			retv = DecodeRle();
+			break;
+		case clipDelta:
+			retv = DecodeDelta();
+			break;
+		case clipRawTimer:
+			if(ReadPtr + NPX_FRAME_SIZE(Header->StripLength) > Header->DataSize)
+				retv = retvEndOfFile;
+			break;
+	}
+	LastDecodeCycles = dwt::GetCycles() - startCycles;
+	if(LastDecodeCycles > MaxDecodeCycles)
+		MaxDecodeCycles = LastDecodeCycles;
+
+	if(retv != retvOk){
+		Stop(); // Broken clip
+		return retv;
+	}
+
+	if(Header->Encoding == clipRawTimer){
+		if(Strip->UpdateFromBuffer(&Data[ReadPtr]) == retvFail){
+			Stop(); // Strip has other native format
+			return retvFail;
+		}
+		ReadPtr += NPX_FRAME_SIZE(Header->StripLength);
+	} else
+		Strip->Update();
+
+	Frame++;
+	if(Frame < Header->FrameCount)
+		return retvOk;
+	// Loop clip
+	Frame = 0;
+	ReadPtr = 0;
+	return retvLast;
+}
+
+uint32_t ClipPlayer_t::GetCompressionRatio(){
+	if((Header == NULL) or (Header->DataSize == 0))
+		return 0;
+	uint32_t rawSize = Header->FrameCount*Header->StripLength*3;
+	return rawSize*100/Header->DataSize;
+}
@@ -0,0 +1,123 @@
+/*
+ * cmdqueue.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <cmdqueue.h>
+
+//CommandQueue_t
+/////////////////////////////////////////////////////////////////////
+
+uint8_t CommandQueue_t::Post(Cli_t* cli, const char* name, uint8_t priority){
+	if(IsPosted(cli))
+		return retvBusy;
+	for(uint32_t i = 0; i < CMDQ_SESSIONS; i++){
+		if(Jobs[i].Cli != NULL)
+			continue;
+		Jobs[i].Cli = cli;
+		Jobs[i].Name = name;
+		Jobs[i].Priority = (priority < cmdPriorityCount) ? priority : cmdBackground;
+		Jobs[i].Deferred = 0;
+		Jobs[i].Sequence = Sequence++;
+		return retvOk;
+	}
+	return retvOverflow;
+}
+
+uint8_t CommandQueue_t::IsPosted(Cli_t* cli){
+	for(uint32_t i = 0; i < CMDQ_SESSIONS; i++)
+		if(Jobs[i].Cli == cli)
+			return 1;
+	return 0;
+}
+
+void CommandQueue_t::Remove(Cli_t* cli){
+	for(uint32_t i = 0; i < CMDQ_SESSIONS; i++)
+		if(Jobs[i].Cli == cli)
+			Jobs[i].Cli = NULL;
+}
+
+uint8_t CommandQueue_t::IsAllowed(const CommandJob_t* job){
+	if((job->Priority == cmdUrgent) or (PeriodUs == 0))
+		return 1;
+	if(job->Deferred and (job->Frame != Frame))
+		return 1; // Waited for one frame already
+	uint32_t estimateUs = EstimateUs[job->Priority];
+	uint32_t elapsedUs = (dwt::GetCycles() - FrameStartCycles)/CyclesPerUs;
+	if(elapsedUs + estimateUs >= PeriodUs)
+		return 0; // Next frame would wait
+	return UsedUs + estimateUs <= PeriodUs*CMDQ_BUDGET_PERCENT/100;
+}
+
+uint8_t CommandQueue_t::Take(CommandJob_t* job){
+	CommandJob_t* best = NULL;
+	uint8_t posted = 0;
+	for(uint32_t i = 0; i < CMDQ_SESSIONS; i++){
+		CommandJob_t* candidate = &Jobs[i];
+		if(candidate->Cli == NULL)
+			continue;
+		posted = 1;
+		if(!IsAllowed(candidate)){
+			if(!candidate->Deferred){
+				candidate->Deferred = 1;
+				candidate->Frame = Frame;
+				Stats.Deferred++;
+			}
+			continue;
+		}
+		if((best == NULL) or (candidate->Priority < best->Priority) or ((candidate->Priority == best->Priority)
+				and ((int32_t)(candidate->Sequence - best->Sequence) < 0)))
+			best = candidate;
+	}
+	if(best == NULL)
+		return posted ? retvBusy : retvEmpty;
+	*job = *best;
+	best->Cli = NULL;
+	job->StartCycles = dwt::GetCycles();
+	return retvOk;
+}
+
+void CommandQueue_t::Done(const CommandJob_t* job){
+	LastDoneCycles = dwt::GetCycles();
+	uint32_t us = (LastDoneCycles - job->StartCycles)/CyclesPerUs;
+	UsedUs += us;
+	// Peak of recent runs, one long command doesn't defer class forever
+	uint32_t* estimateUs = &EstimateUs[job->Priority];
+	*estimateUs -= *estimateUs/8;
+	if(us > *estimateUs)
+		*estimateUs = us;
+	Stats.Executed[job->Priority]++;
+	if(us > Stats.MaxUs[job->Priority])
+		Stats.MaxUs[job->Priority] = us;
+}
+
+uint8_t CommandQueue_t::IsDeferred(){
+	for(uint32_t i = 0; i < CMDQ_SESSIONS; i++)
+		if((Jobs[i].Cli != NULL) and Jobs[i].Deferred)
+			return 1;
+	return 0;
+}
+
+void CommandQueue_t::StartFrame(uint32_t periodMs, uint32_t lateMs){
+	uint32_t nowCycles = dwt::GetCycles();
+	Frame++;
+	Stats.Frames++;
+	if(lateMs > CMDQ_MISS_MS){
+		Stats.Misses++;
+		// Frame was due lateMs ago, command finished after that held CPU.
+		// Cycle counter wraps, lateness is capped to its range (59 s at 72 MHz)
+		uint32_t maxLateMs = UINT32_MAX/(1000*CyclesPerUs);
+		uint32_t lateCycles = ((lateMs < maxLateMs) ? lateMs : maxLateMs)*1000*CyclesPerUs;
+		if(nowCycles - LastDoneCycles < lateCycles)
+			Stats.CommandMisses++;
+		if(lateMs > Stats.MaxLateMs)
+			Stats.MaxLateMs = lateMs;
+		if((periodMs != 0) and (lateMs >= periodMs))
+			Stats.Skipped += lateMs/periodMs;
+	}
+	FrameStartCycles = nowCycles;
+	PeriodUs = periodMs*1000;
+	UsedUs = 0;
+}
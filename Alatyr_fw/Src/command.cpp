@@ -0,0 +1,93 @@
+/*
+ * command.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <command.h>
+
+//Command registry
+/////////////////////////////////////////////////////////////////////
+
+uint8_t command::ParseHex(const char* text, uint32_t* number){
+	uint32_t ptr = 0;
+	uint32_t value = 0;
+	if((text[0] == '0') and ((text[1] == 'x') or (text[1] == 'X')))
+		ptr = 2;
+	if((text[ptr] == '\0') or (strlen(&text[ptr]) > 8))
+		return retvNotANumber;
+	while(text[ptr] != '\0'){
+		char c = text[ptr];
+		if((c >= '0') and (c <= '9'))
+			value = (value << 4) | (c - '0');
+		else if((c >= 'a') and (c <= 'f'))
+			value = (value << 4) | (c - 'a' + 10);
+		else if((c >= 'A') and (c <= 'F'))
+			value = (value << 4) | (c - 'A' + 10);
+		else
+			return retvNotANumber;
+		ptr++;
+	}
+	*number = value;
+	return retvOk;
+}
+
+static uint8_t ParseArg(char type, char* text, CommandArg_t* arg){
+	retv_t retv = retvOk;
+	switch(type){
+		case 'd':
+			arg->Int = strToInt(text, &retv);
+			return retv;
+		case 'x':
+			return command::ParseHex(text, &arg->Unsigned);
+		case 'c':
+			if(text[0] == '#')
+				text++;
+			if(command::ParseHex(text, &arg->Unsigned) != retvOk)
+				return retvNotANumber;
+			return arg->Unsigned <= 0xFFFFFF ? retvOk : retvBadValue;
+		case 's':
+			arg->String = text;
+			return retvOk;
+		default:
+			return retvBadValue;
+	}
+}
+
+uint8_t command::Execute(Cli_t& cli, const Command_t* command, const char* name){
+	if(command == NULL){
+		CLI_PRINT(cli, "Unknown command: %s\r\n", name);
+		return retvCmdUnknown;
+	}
+
+	CommandArgs_t args;
+	args.Count = 0;
+	uint8_t optional = 0;
+	for(const char* type = command->Args; *type != '\0'; type++){
+		if(*type == '['){
+			optional = 1;
+			continue;
+		}
+		char* text = cli.ReadArg();
+		if(text == NULL){
+			if(optional)
+				break;
+			CLI_PRINT(cli, "%s: missing argument %d\r\n", command->Name, args.Count + 1);
+			return retvCmdError;
+		}
+		ASSERT_SIMPLE(args.Count < COMMAND_MAX_ARGS);
+		if(ParseArg(*type, text, &args.Arg[args.Count]) != retvOk){
+			CLI_PRINT(cli, "%s: bad argument %d '%s'\r\n", command->Name, args.Count + 1, text);
+			return retvCmdError;
+		}
+		args.Count++;
+	}
+	if(cli.ReadArg() != NULL){
+		CLI_PRINT(cli, "%s: too many arguments\r\n", command->Name);
+		return retvCmdError;
+	}
+
+	command->Callback(cli, args);
+	return retvOk;
+}
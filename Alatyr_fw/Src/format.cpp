@@ -0,0 +1,43 @@
+/*
+ * format.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <format.h>
+
+// Two digits per division, quotient and remainder by 100 need one multiplication
+static const char DigitPairs[201] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+uint32_t format::UnsignedToDecimal(char* end, uint32_t number){
+	char* ptr = end;
+	while(number >= 100){
+		uint32_t pair = (number % 100)*2;
+		number = number/100;
+		*--ptr = DigitPairs[pair + 1];
+		*--ptr = DigitPairs[pair];
+	}
+	if(number >= 10){
+		uint32_t pair = number*2;
+		*--ptr = DigitPairs[pair + 1];
+		*--ptr = DigitPairs[pair];
+	} else
+		*--ptr = '0' + number;
+	return end - ptr;
+}
+
+uint32_t format::UnsignedToHex(char* end, uint32_t number){
+	static const char HexDigits[] = "0123456789ABCDEF";
+	char* ptr = end;
+	do{
+		*--ptr = HexDigits[number & 0xF];
+		number = number >> 4;
+	} while(number > 0);
+	return end - ptr;
+}
@@ -28,6 +28,29 @@ uint8_t gpio::GetPinInput(GPIO_TypeDef* gpio, uint32_t pin) {
 		return 1;
 }
 
+void gpio::EnableExti(GPIO_TypeDef* gpio, uint8_t pin, ExtiTrigger_t trigger, uint8_t irqPrio){
+	uint32_t port = ((uint32_t)gpio - GPIOA_BASE)/(GPIOB_BASE - GPIOA_BASE);
+	AFIO->EXTICR[pin/4] &= ~(0b1111UL << (4*(pin % 4)));
+	AFIO->EXTICR[pin/4] |= port << (4*(pin % 4));
+	if(trigger & ExtiRising)
+		EXTI->RTSR |= 0b1UL << pin;
+	else
+		EXTI->RTSR &= ~(0b1UL << pin);
+	if(trigger & ExtiFalling)
+		EXTI->FTSR |= 0b1UL << pin;
+	else
+		EXTI->FTSR &= ~(0b1UL << pin);
+	EXTI->PR = 0b1UL << pin; // Edge before setup
+	EXTI->IMR |= 0b1UL << pin;
+
+	IRQn_Type irq = EXTI15_10_IRQn;
+	if(pin < 5)
+		irq = (IRQn_Type)(EXTI0_IRQn + pin);
+	else if(pin < 10)
+		irq = EXTI9_5_IRQn;
+	nvic::SetupIrq(irq, irqPrio);
+}
+
 //Simple buttons
 /////////////////////////////////////////////////////////////////////
 
@@ -7,22 +7,105 @@
 
 #include <interface_F103.h>
 
+//iWriter_t, iReader_t
+/////////////////////////////////////////////////////////////////////
+
+// Default block functions for channels without own implementation
+uint32_t iWriter_t::Write(const uint8_t* data, uint32_t length){
+	for(uint32_t i = 0; i < length; i++)
+		if(WriteChar(data[i]) != retvOk)
+			return i;
+	return length;
+}
+
+uint32_t iReader_t::Read(uint8_t* data, uint32_t length){
+	uint32_t i = 0;
+	while((i < length) and (GetNumberOfBytesReady() != 0)){
+		data[i] = ReadChar(NULL);
+		i++;
+	}
+	return i;
+}
+
 //Uart_t
 /////////////////////////////////////////////////////////////////////
 
-void Uart_t::Init(USART_TypeDef* _Usart, uint32_t CurrentClockHz, uint32_t Bod){
+uint32_t uart::GetBrr(uint32_t clockHz, uint32_t baud){
+	return (clockHz + baud/2)/baud;
+}
+
+int32_t uart::GetErrorPpm(uint32_t clockHz, uint32_t baud){
+	int64_t divided = (int64_t)GetBrr(clockHz, baud)*baud;
+	return ((int64_t)clockHz - divided)*1000000/divided;
+}
+
+uint8_t uart::CheckBaud(uint32_t clockHz, uint32_t baud){
+	if((baud == 0) or (baud > GetMaxBaud(clockHz)) or (GetBrr(clockHz, baud) > 0xFFFF))
+		return retvBadValue;
+	int32_t errorPpm = GetErrorPpm(clockHz, baud);
+	if((errorPpm > UART_MAX_ERROR_PPM) or (errorPpm < -UART_MAX_ERROR_PPM))
+		return retvBadValue;
+	return retvOk;
+}
+
+uint8_t Uart_t::Init(USART_TypeDef* _Usart, uint32_t CurrentClockHz, uint32_t Bod){
 	Usart = _Usart; // Set class parameter
 
 	// USART must be disabled before configuring
 	Usart->CR1 &= ~USART_CR1_M_Msk; // 1 stop bit, 8 data bits
-	Usart->BRR = (uint32_t)CurrentClockHz/Bod; // Setup baud rate
+	uint8_t retv = uart::CheckBaud(CurrentClockHz, Bod);
+	if(retv == retvOk){
+		Usart->BRR = uart::GetBrr(CurrentClockHz, Bod); // Setup baud rate
+		Baud = Bod;
+		ErrorPpm = uart::GetErrorPpm(CurrentClockHz, Bod);
+	}
 	Usart->CR1 |= USART_CR1_TE | USART_CR1_RE ; //USART TX RX enable
+	return retv;
+}
+
+void Uart_t::EnableRxIrq(uint8_t IrqPrio, RxCallback_t callback){
+	Callback = callback;
+	IRQn_Type irq = USART1_IRQn;
+	if(Usart == USART2)
+		irq = USART2_IRQn;
+	else if(Usart == USART3)
+		irq = USART3_IRQn;
+	nvic::SetupIrq(irq, IrqPrio);
+	Usart->CR1 |= USART_CR1_IDLEIE;
+	Usart->CR3 |= USART_CR3_EIE; // Error interrupt in DMA mode
+}
+
+uint8_t Uart_t::IrqHandler(){
+	uint32_t status = Usart->SR;
+	uint32_t flags = USART_SR_IDLE | USART_SR_ORE | USART_SR_FE | USART_SR_NE | USART_SR_PE;
+	if((status & flags) == 0)
+		return retvFail;
+	// Flags cleared by SR read followed by DR read. With RXNE set, DR holds
+	// byte not yet taken by RX DMA, its own DR read ends the sequence
+	if((status & USART_SR_RXNE) == 0)
+		(void)Usart->DR;
+	if(status & USART_SR_ORE)
+		Stats.Overrun++;
+	if(status & USART_SR_FE)
+		Stats.Framing++;
+	if(status & USART_SR_NE)
+		Stats.Noise++;
+	if(status & USART_SR_PE)
+		Stats.Parity++;
+	if((status & USART_SR_IDLE) and (Callback != NULL))
+		Callback(rxEventIdle);
+	return retvOk;
 }
 
-void Uart_t::UpdateBaudrate(uint32_t CurrentClockHz, uint32_t Bod){
+uint8_t Uart_t::UpdateBaudrate(uint32_t CurrentClockHz, uint32_t Bod){
+	if(uart::CheckBaud(CurrentClockHz, Bod) != retvOk)
+		return retvBadValue;
 	Disable();
-	Usart->BRR = (uint32_t)CurrentClockHz/Bod; // Setup baud rate
+	Usart->BRR = uart::GetBrr(CurrentClockHz, Bod); // Setup baud rate
 	Enable();
+	Baud = Bod;
+	ErrorPpm = uart::GetErrorPpm(CurrentClockHz, Bod);
+	return retvOk;
 }
 
 //Simple UART byte transmit, wait until fully transmitted
@@ -38,21 +121,127 @@ uint8_t Uart_t::ReadChar(retv_t* retv){
 	while((Usart->SR & USART_SR_RXNE) == 0){
 		timeout--;
 		if(timeout == 0){
-			*retv = retvTimeout;
+			if(retv != NULL)
+				*retv = retvTimeout;
 			return 0; // Can't receive data
 		}
 	}
 	// Data received
 	uint8_t data = Usart->DR;
-	*retv = retvOk;
+	if(retv != NULL)
+		*retv = retvOk;
 	return data;
 }
 
+uint32_t Uart_t::Write(const uint8_t* data, uint32_t length){
+	for(uint32_t i = 0; i < length; i++){
+		while ((Usart->SR & USART_SR_TXE) == 0) {}
+		Usart->DR = data[i];
+	}
+	return length;
+}
+
+uint32_t Uart_t::Read(uint8_t* data, uint32_t length){
+	uint32_t i = 0;
+	while((i < length) and (Usart->SR & USART_SR_RXNE)){
+		data[i] = Usart->DR;
+		i++;
+	}
+	return i;
+}
+
 uint32_t Uart_t::GetNumberOfBytesReady(){
 	if(Usart->SR & USART_SR_RXNE)
+		return 1;
+	else
 		return 0;
+}
+
+//AutoBaud_t
+/////////////////////////////////////////////////////////////////////
+
+void AutoBaud_t::Init(uint32_t timerClockHz, uint8_t irqPrio, AutoBaudCallback_t callback){
+	TimerClockHz = timerClockHz;
+	Callback = callback;
+	uint32_t shift = 8*((Channel - 1) % 2);
+	volatile uint32_t* ccmr = (Channel <= 2) ? &Timer->CCMR1 : &Timer->CCMR2;
+	*ccmr &= ~(0xFFUL << shift);
+	*ccmr |= (0b01UL << shift) | (0b0010UL << (shift + 4)); // Input from own pin, filter of 4 samples
+	Timer->CCER |= TIM_CCER_CC1P << 4*(Channel - 1); // Falling edge
+	Timer->PSC = 0;
+	Timer->ARR = 0xFFFF;
+	Timer->EGR = TIM_EGR_UG;
+	Timer->CR1 |= TIM_CR1_CEN;
+
+	IRQn_Type irq = TIM4_IRQn;
+	if(Timer == TIM2)
+		irq = TIM2_IRQn;
+	else if(Timer == TIM3)
+		irq = TIM3_IRQn;
+	nvic::SetupIrq(irq, irqPrio);
+}
+
+void AutoBaud_t::Start(){
+	State = autoBaudArmed;
+	Timer->SR = ~((TIM_SR_CC1IF | TIM_SR_CC1OF) << (Channel - 1));
+	Timer->CCER |= TIM_CCER_CC1E << 4*(Channel - 1);
+	Timer->DIER |= TIM_DIER_CC1IE << (Channel - 1);
+}
+
+void AutoBaud_t::Stop(){
+	Timer->DIER &= ~(TIM_DIER_CC1IE << (Channel - 1));
+	Timer->CCER &= ~(TIM_CCER_CC1E << 4*(Channel - 1));
+}
+
+// Polls remaining edges of sync character, interrupts of same or lower priority wait
+uint8_t AutoBaud_t::Measure(){
+	volatile uint32_t* ccr = &Timer->CCR1 + (Channel - 1);
+	uint32_t captureFlag = TIM_SR_CC1IF << (Channel - 1);
+	uint16_t edges[5];
+	edges[0] = *ccr; // Reading clears flag
+	for(uint32_t i = 1; i < 5; i++){
+		while((Timer->SR & captureFlag) == 0)
+			if((uint16_t)(Timer->CNT - edges[0]) > 0xF000)
+				return retvTimeout; // Not 0x55 or too slow
+		edges[i] = *ccr;
+	}
+	if(Timer->SR & (TIM_SR_CC1OF << (Channel - 1)))
+		return retvOverflow; // Edge missed, too fast
+	uint16_t ticks = edges[4] - edges[0];
+	// Each step is two bits
+	for(uint32_t i = 1; i < 5; i++){
+		uint16_t step = edges[i] - edges[i - 1];
+		if((4*step < ticks*3/4) or (4*step > ticks*5/4))
+			return retvBadValue;
+	}
+	MeasuredBaud = (uint64_t)TimerClockHz*AUTOBAUD_SYNC_BITS/ticks;
+	Baud = SnapBaud(MeasuredBaud);
+	return retvOk;
+}
+
+uint8_t AutoBaud_t::IrqHandler(){
+	if((Timer->SR & (TIM_SR_CC1IF << (Channel - 1))) == 0)
+		return retvFail;
+	Timer->DIER &= ~(TIM_DIER_CC1IE << (Channel - 1)); // Other edges are polled
+	if(Measure() == retvOk)
+		State = autoBaudDone;
 	else
-		return 1;
+		State = autoBaudFailed;
+	Stop();
+	if(Callback != NULL)
+		Callback(State == autoBaudDone ? Baud : 0);
+	return retvOk;
+}
+
+uint32_t AutoBaud_t::SnapBaud(uint32_t baud){
+	static const uint32_t rates[] = {4800, 9600, 14400, 19200, 38400, 57600, 115200, 230400,
+			460800, 921600, 1000000, 1500000, 2000000};
+	for(uint32_t i = 0; i < sizeof(rates)/sizeof(rates[0]); i++){
+		uint32_t difference = (baud > rates[i]) ? baud - rates[i] : rates[i] - baud;
+		if((uint64_t)difference*1000000 <= (uint64_t)rates[i]*AUTOBAUD_SNAP_PPM)
+			return rates[i];
+	}
+	return baud;
 }
 
 //DmaTx_t
@@ -60,9 +249,14 @@ uint32_t Uart_t::GetNumberOfBytesReady(){
 
 // Initialize memory to peripheral DMA TX channel
 void DmaTx_t::Init(uint32_t PeriphRegAdr, uint8_t DmaIrqPrio, DmaChPrio_t ChPrio){
+	power::RequestClock(pwrClkDma1); // Held for good, channel is always ready
 	// Setup class parameters
 	BufferStartPtr = 0;
-	BufferEndPtr = 0;
+	State = 0;
+	InFlight = 0;
+	QueueHead = 0;
+	QueueTail = 0;
+	SendingDescriptor = 0;
 
 	Dma->Channel -> CCR =  DMA_CCR_MINC; // Memory increment
 	Dma->Channel -> CCR |= ChPrio << DMA_CCR_PL_Pos; // DMA channel priority
@@ -75,53 +269,266 @@ void DmaTx_t::Init(uint32_t PeriphRegAdr, uint8_t DmaIrqPrio, DmaChPrio_t ChPrio
 
 }
 
+// Reserve space for whole record, returns ring position of first byte
+uint8_t DmaTx_t::Reserve(uint32_t length, uint32_t* position){
+	uint32_t state, newState;
+	do{
+		state = __LDREXW(&State);
+		uint32_t reserve = state & DMATX_PTR_MASK;
+		uint32_t used = (reserve + BufferSize - BufferStartPtr) % BufferSize;
+		if((used + length > BufferSize - 1UL) or ((state >> DMATX_WRITERS_POS) == 0xFF)){
+			__CLREX();
+			return retvOutOfMemory;
+		}
+		*position = reserve;
+		newState = (state & ~DMATX_PTR_MASK) | ((reserve + length) % BufferSize);
+		newState += 1UL << DMATX_WRITERS_POS;
+	} while(__STREXW(newState, &State) != 0);
+	return retvOk;
+}
+
+// Last writer leaving publishes everything reserved so far
+void DmaTx_t::Commit(){
+	uint32_t state, newState;
+	do{
+		state = __LDREXW(&State);
+		newState = state - (1UL << DMATX_WRITERS_POS);
+		if((newState >> DMATX_WRITERS_POS) == 0){
+			newState &= ~(DMATX_PTR_MASK << DMATX_COMMIT_POS);
+			newState |= (state & DMATX_PTR_MASK) << DMATX_COMMIT_POS;
+		}
+	} while(__STREXW(newState, &State) != 0);
+}
+
+void DmaTx_t::SetCoalescing(uint16_t thresholdBytes, uint16_t deadlineMs){
+	Threshold = thresholdBytes;
+	DeadlineMs = deadlineMs;
+	FlushCountdown = 0;
+	if(Threshold == 0)
+		Transmit();
+}
+
 uint8_t DmaTx_t::StartTransmission(){
+	if(Threshold == 0)
+		return Transmit();
 	if(CheckStatus() != 0)
+		return retvBusy; // Committed data sent after transfer complete
+	uint32_t commit = (State >> DMATX_COMMIT_POS) & DMATX_PTR_MASK;
+	uint32_t pending = (commit + BufferSize - BufferStartPtr) % BufferSize;
+	if((pending >= Threshold) or (QueueHead != QueueTail) or (DeadlineMs == 0))
+		return Transmit();
+	if(pending == 0)
+		return retvEmpty;
+	if(FlushCountdown == 0)
+		FlushCountdown = DeadlineMs; // Deadline counted from oldest pending data
+	return retvOk;
+}
+
+void DmaTx_t::TickHandler(){
+	if(FlushCountdown == 0)
+		return;
+	FlushCountdown--;
+	if(FlushCountdown == 0)
+		Transmit();
+}
+
+void DmaTx_t::Hold(uint8_t held){
+	Held = held;
+	if(held == 0)
+		Transmit();
+}
+
+uint8_t DmaTx_t::Transmit(){
+	// Called by several tasks and from interrupts
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if((CheckStatus() != 0) or Held){
+		__set_PRIMASK(primask);
 		return retvBusy; //Nothing changes if DMA already running
+	}
+
+	uint32_t ringEnd = (State >> DMATX_COMMIT_POS) & DMATX_PTR_MASK;
+	if(QueueHead != QueueTail){
+		const TxDescriptor_t* descriptor = &Queue[QueueHead];
+		if(descriptor->RingMark == BufferStartPtr){
+			// Ring buffer data before descriptor already sent
+			SendingDescriptor = 1;
+			Stats.Transfers++;
+			Stats.Bytes += descriptor->Length;
+			Dma->Channel -> CNDTR = descriptor->Length;
+			Dma->Channel -> CMAR = (uint32_t)descriptor->Data;
+			Dma->Channel -> CCR |= DMA_CCR_EN;
+			__set_PRIMASK(primask);
+			return retvOk;
+		}
+		// Mark may be in reserved, but not yet committed data
+		uint32_t toMark = (descriptor->RingMark + BufferSize - BufferStartPtr) % BufferSize;
+		uint32_t toCommit = (ringEnd + BufferSize - BufferStartPtr) % BufferSize;
+		if(toMark < toCommit)
+			ringEnd = descriptor->RingMark;
+	}
 
-	if(BufferStartPtr == BufferEndPtr)
+	if(BufferStartPtr == ringEnd){
+		__set_PRIMASK(primask);
 		return retvEmpty; //Nothing changes if Buffer Empty
+	}
 
-	uint32_t NumberOfBytesReady;
-	if (BufferEndPtr > BufferStartPtr)
-		NumberOfBytesReady = GetNumberOfBytesInBuffer();
+	if (ringEnd > BufferStartPtr)
+		InFlight = ringEnd - BufferStartPtr;
 	else
-		NumberOfBytesReady = BufferSize - BufferStartPtr;
-	Dma->Channel -> CNDTR = NumberOfBytesReady;
+		InFlight = BufferSize - BufferStartPtr;
+	SendingDescriptor = 0;
+	FlushCountdown = 0;
+	Stats.Transfers++;
+	Stats.Bytes += InFlight;
+	Dma->Channel -> CNDTR = InFlight;
 	Dma->Channel -> CMAR = (uint32_t)&Buffer[BufferStartPtr];
-	BufferStartPtr = (BufferStartPtr + NumberOfBytesReady) % BufferSize;
 	Dma->Channel -> CCR |= DMA_CCR_EN;
+	__set_PRIMASK(primask);
 
 	return retvOk;
 }
 
+uint8_t DmaTx_t::Send(const uint8_t* data, uint16_t length, TxCallback_t callback, void* context){
+	if(length == 0)
+		return retvBadValue;
+	if(QueueSize == 0)
+		return retvOutOfMemory;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint8_t nextTail = (QueueTail + 1) % QueueSize;
+	if(nextTail == QueueHead){
+		__set_PRIMASK(primask);
+		return retvOutOfMemory;
+	}
+	TxDescriptor_t* descriptor = &Queue[QueueTail];
+	descriptor->Data = data;
+	descriptor->Length = length;
+	descriptor->RingMark = State & DMATX_PTR_MASK; // After records reserved before
+	descriptor->Callback = callback;
+	descriptor->Context = context;
+	QueueTail = nextTail;
+	__set_PRIMASK(primask);
+	return retvOk;
+}
+
+uint32_t DmaTx_t::GetQueueFree(){
+	if(QueueSize == 0)
+		return 0;
+	return (QueueHead + QueueSize - QueueTail - 1) % QueueSize;
+}
+
 uint32_t DmaTx_t::CheckStatus(){
 	uint32_t temp = Dma->Channel -> CCR;
 	return temp & DMA_CCR_EN;
 }
 
+// Reserved bytes, including not yet committed
 uint32_t DmaTx_t::GetNumberOfBytesInBuffer(){
-	if (BufferEndPtr >= BufferStartPtr)
-		return BufferEndPtr - BufferStartPtr;
-	else
-		return BufferSize - BufferStartPtr + BufferEndPtr;
+	return ((State & DMATX_PTR_MASK) + BufferSize - BufferStartPtr) % BufferSize;
+}
+
+void DmaTx_t::SetOverflowPolicy(TxOverflowPolicy_t policy, uint32_t timeoutMs,
+		TxWaitHook_t waitHook, TxSpaceHook_t spaceHook){
+	Policy = policy;
+	TimeoutMs = timeoutMs;
+	WaitHook = waitHook;
+	SpaceHook = spaceHook;
+}
+
+// Drop committed data not sent yet, stops ring transfer in progress
+uint8_t DmaTx_t::DiscardOldest(){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	// Ring data before queued descriptor keeps its order
+	if((QueueHead != QueueTail) or SendingDescriptor){
+		__set_PRIMASK(primask);
+		return retvFail;
+	}
+	uint32_t sent = 0;
+	if(CheckStatus() != 0){
+		Dma->Channel -> CCR &= ~DMA_CCR_EN;
+		DMA1->IFCR = DMA_IFCR_CTCIF1 << 4*(Dma->Number - 1);
+		sent = InFlight - Dma->Channel -> CNDTR;
+		InFlight = 0;
+	}
+	uint32_t commit = (State >> DMATX_COMMIT_POS) & DMATX_PTR_MASK;
+	uint32_t discarded = (commit + BufferSize - BufferStartPtr) % BufferSize - sent;
+	BufferStartPtr = commit;
+	DroppedBytes += discarded;
+	__set_PRIMASK(primask);
+	return (discarded + sent) ? retvOk : retvFail;
+}
+
+// retvOk - worth to try reservation again
+uint8_t DmaTx_t::MakeSpace(uint32_t length){
+	if(length > BufferSize - 1UL)
+		return retvOutOfMemory; // Never fits
+	switch(Policy){
+		case txDropOldest:
+			return DiscardOldest();
+		case txBlock:
+			if((__get_IPSR() != 0) or (WaitHook == NULL))
+				return retvFail;
+			Transmit();
+			return WaitHook(TimeoutMs);
+		default:
+			return retvFail;
+	}
 }
 
 uint8_t DmaTx_t::WriteChar(uint8_t data){
-	uint32_t EndPtrTemp = (BufferEndPtr + 1) % BufferSize;
-	if (EndPtrTemp == BufferStartPtr)
+	if(Write(&data, 1) != 1)
 		return retvOutOfMemory;
-
-	Buffer[BufferEndPtr] = data;
-	BufferEndPtr = EndPtrTemp;
 	return retvOk;
 }
 
+// Whole block is reserved at once, so it is never interleaved with other writers.
+// Block not fitting into free space is handled by overflow policy, returns 0 if dropped.
+uint32_t DmaTx_t::Write(const uint8_t* data, uint32_t length){
+	// Flash content never changes, send it in place
+	if((length >= DMATX_ZERO_COPY_MIN) and (length <= UINT16_MAX) and
+			((uint32_t)data >= FLASH_BASE) and ((uint32_t)data + length <= FLASH_BANK1_END + 1))
+		if(Send(data, length, NULL, NULL) == retvOk)
+			return length;
+
+	uint32_t position;
+	if(length == 0)
+		return 0;
+	while(Reserve(length, &position) != retvOk){
+		if(MakeSpace(length) != retvOk){
+			DroppedBytes += length;
+			return 0;
+		}
+	}
+	// Copy up to two contiguous segments of ring buffer
+	uint32_t firstPart = BufferSize - position;
+	if(firstPart > length)
+		firstPart = length;
+	memcpy(&Buffer[position], data, firstPart);
+	memcpy(Buffer, data + firstPart, length - firstPart);
+	Commit();
+	return length;
+}
+
 uint8_t DmaTx_t::IrqHandler(){
 	if(DMA1->ISR & DMA_ISR_TCIF1 << 4*(Dma->Number - 1)){
 		DMA1->IFCR = DMA_IFCR_CTCIF1 << 4*(Dma->Number - 1);
 		Dma->Channel -> CCR &= ~DMA_CCR_EN;
-		StartTransmission();
+		if(SendingDescriptor){
+			TxDescriptor_t descriptor = Queue[QueueHead];
+			QueueHead = (QueueHead + 1) % QueueSize; // Slot free before callback queues next buffer
+			SendingDescriptor = 0;
+			if(descriptor.Callback != NULL)
+				descriptor.Callback(descriptor.Data, descriptor.Context);
+		} else {
+			// Sent bytes can be overwritten only now
+			BufferStartPtr = (BufferStartPtr + InFlight) % BufferSize;
+			InFlight = 0;
+		}
+		if(SpaceHook != NULL)
+			SpaceHook();
+		Transmit(); // No coalescing delay, data gathered during transfer
 		return retvOk;
 	} else
 		return retvFail;
@@ -132,6 +539,7 @@ uint8_t DmaTx_t::IrqHandler(){
 
 // Initialize peripheral to memory DMA RX channel
 void DmaRx_t::Init(uint32_t PeriphRegAdr, DmaChPrio_t ChPrio){
+	power::RequestClock(pwrClkDma1); // Circular reception never stops
 	// Setup class parameters
 	BufferStartPtr = 0;
 
@@ -143,6 +551,30 @@ void DmaRx_t::Init(uint32_t PeriphRegAdr, DmaChPrio_t ChPrio){
 	Dma->Channel -> CPAR = PeriphRegAdr; //Peripheral register
 }
 
+void DmaRx_t::EnableIrq(uint8_t DmaIrqPrio, RxCallback_t callback){
+	Callback = callback;
+	nvic::SetupIrq(Dma->Irq, DmaIrqPrio);
+	Dma->Channel -> CCR |= DMA_CCR_HTIE | DMA_CCR_TCIE;
+}
+
+uint8_t DmaRx_t::IrqHandler(){
+	uint32_t shift = 4*(Dma->Number - 1);
+	uint32_t flags = DMA1->ISR & ((DMA_ISR_HTIF1 | DMA_ISR_TCIF1) << shift);
+	if(flags == 0)
+		return retvFail;
+	DMA1->IFCR = flags; // IFCR bits have the same positions as ISR
+	uint32_t events = 0;
+	if(flags & (DMA_ISR_HTIF1 << shift))
+		events |= rxEventHalf;
+	if(flags & (DMA_ISR_TCIF1 << shift)){
+		events |= rxEventComplete;
+		WriteLaps++;
+	}
+	if(Callback != NULL)
+		Callback(events);
+	return retvOk;
+}
+
 uint16_t DmaRx_t::GetBufferEndPtr(){
 	return BufferSize - (Dma->Channel -> CNDTR);
 }
@@ -157,7 +589,38 @@ inline void DmaRx_t::Stop(){
 	Dma->Channel -> CCR &= ~DMA_CCR_EN;
 }
 
+// Bytes written by DMA since start
+uint32_t DmaRx_t::GetWriteTotal(){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint32_t laps = WriteLaps;
+	uint32_t BufferEndPtr = GetBufferEndPtr();
+	// Transfer complete not handled yet - CNDTR already reloaded
+	if((DMA1->ISR & (DMA_ISR_TCIF1 << 4*(Dma->Number - 1))) and (BufferEndPtr < BufferSize/2))
+		laps++;
+	__set_PRIMASK(primask);
+	return laps*BufferSize + BufferEndPtr;
+}
+
+// Returns number of bytes ready, if reader was lapped unread data is dropped
+uint32_t DmaRx_t::CheckOverrun(){
+	uint32_t writeTotal = GetWriteTotal();
+	uint32_t ready = writeTotal - ReadTotal;
+	if(ready > BufferSize){
+		Stats.Overruns++;
+		Stats.LostBytes += ready;
+		ReadTotal = writeTotal;
+		BufferStartPtr = writeTotal % BufferSize;
+		return 0;
+	}
+	if(ready > Stats.HighWater)
+		Stats.HighWater = ready;
+	return ready;
+}
+
 uint32_t DmaRx_t::GetNumberOfBytesReady(){
+	if(Callback != NULL)
+		return CheckOverrun();
 	uint32_t BufferEndPtr = GetBufferEndPtr();
 	if (BufferEndPtr >= BufferStartPtr)
 		return BufferEndPtr - BufferStartPtr;
@@ -165,218 +628,37 @@ uint32_t DmaRx_t::GetNumberOfBytesReady(){
 		return BufferSize - BufferStartPtr + BufferEndPtr;
 }
 
+const DmaRxStats_t* DmaRx_t::GetStats(){
+	if(Callback != NULL)
+		CheckOverrun();
+	Stats.Laps = WriteLaps;
+	Stats.Bytes = ReadTotal + GetNumberOfBytesReady();
+	return &Stats;
+}
+
 uint32_t DmaRx_t::CheckStatus(){
 	uint32_t temp = Dma->Channel -> CCR;
 	return temp & DMA_CCR_EN;
 }
 
 uint8_t DmaRx_t::ReadChar(retv_t* retv){
-	uint8_t temp = Buffer[BufferStartPtr];
-	BufferStartPtr = (BufferStartPtr + 1) % BufferSize;
-	return temp;
-}
-
-//Cli_t
-/////////////////////////////////////////////////////////////////////
-
-int32_t strToInt(char* text, retv_t* retv){
-	uint8_t ptr = 0;
-	int32_t number = 0;
-	if(text[0] == '-'){
-		ptr++;
-		while((text[ptr] >= '0') and (text[ptr] <= '9')){
-			number = number*10 - (text[ptr] - '0');
-			ptr++;
-		}
-	} else if((text[0] >= '0') and (text[0] <= '9')){
-		while((text[ptr] >= '0') and (text[ptr] <= '9')){
-			number = number*10 + (text[ptr] - '0');
-			ptr++;
-		}
-	} else{
-		*retv = retvNotANumber;
-		return 0;
-	}
-
-	if(text[ptr] == '\0'){
-		*retv = retvOk;
-		return number;
-	} else {
-		*retv = retvNotANumber;
-		return 0;
-	}
-}
-
-void Cli_t::PutString(const char* text){
-	uint8_t length = strlen(text);
-	for(uint32_t i = 0; i < length; i++)
-		TxChannel->WriteChar((uint8_t)text[i]);
-}
-
-void Cli_t::PutBinary(uint32_t number){
-	TxChannel->WriteChar((uint8_t)'0');
-	TxChannel->WriteChar((uint8_t)'b');
-	if(number == 0){
-		TxChannel->WriteChar((uint8_t)'0');
-		return;
-	}
-
-	uint32_t mask = 1UL << 31;
-	while((number & mask) == 0)
-		mask = mask >> 1;
-	while(mask > 0){
-		if((number & mask))
-			TxChannel->WriteChar((uint8_t)'1');
-		else
-			TxChannel->WriteChar((uint8_t)'0');
-		mask = mask >> 1;
-	}
-}
-
-void Cli_t::PutUnsignedInt(uint32_t number){
-	if(number == 0){
-		TxChannel->WriteChar((uint8_t)'0');
-		return;
-	}
-
-	char IntBuf[10] = "";
-	uint32_t i = 0;
-	while(number > 0){
-		uint32_t temp = number % 10;
-		number = (uint32_t)number/10;
-		IntBuf[i] = '0' + temp;
-		i++;
-	}
-	for(uint32_t k = 0; k < i; k++)
-		TxChannel->WriteChar((uint8_t)IntBuf[i - k - 1]);
-}
-
-void Cli_t::PutUnsignedHex(uint32_t number){
-	TxChannel->WriteChar((uint8_t)'0');
-	TxChannel->WriteChar((uint8_t)'x');
-	if(number == 0){
-		TxChannel->WriteChar((uint8_t)'0');
-		return;
-	}
-
-	char IntBuf[10] = "";
-	uint32_t i = 0;
-	while(number > 0){
-		uint32_t temp = number & 0xF;
-		number = number >> 4;
-		if(temp < 10)
-			IntBuf[i] = '0' + temp;
-		else
-			IntBuf[i] = 'A' + temp - 10;
-		i++;
-	}
-	for(uint32_t k = 0; k < i; k++)
-		TxChannel->WriteChar((uint8_t)IntBuf[i - k - 1]);
-}
-
-void Cli_t::PutInt(int32_t number) {
-	if(number >= 0)
-		PutUnsignedInt(number);
-	else{
-		TxChannel->WriteChar('-');
-		PutUnsignedInt(-number);
-	}
+	uint8_t data = 0;
+	uint32_t length = Read(&data, 1);
+	if(retv != NULL)
+		*retv = length ? retvOk : retvEmpty;
+	return data;
 }
 
-void Cli_t::Printf(const char* text, ...){
-	// String format processing
-	va_list args;
-	va_start(args, text); // Start string processing
-	uint8_t length = strlen(text);
-	for(uint32_t i = 0; i < length; i++){
-		if(text[i] == '%'){ // if argument found
-			i++;
-			switch(text[i]){
-				case 'd': // integer
-					PutInt(va_arg(args,int));
-					break;
-				case 'u': // unsigned integer
-					PutUnsignedInt(va_arg(args,uint32_t));
-					break;
-				case 's': // string
-					PutString(va_arg(args,char*));
-					break;
-				case 'c': // char
-					TxChannel->WriteChar(va_arg(args,int));
-					break;
-				case 'b': // print uint32 as binary
-					PutBinary(va_arg(args,uint32_t));
-					break;
-				case 'x': // print uint32 as hex
-					PutUnsignedHex(va_arg(args,uint32_t));
-					break;
-				default:
-					TxChannel->WriteChar((uint8_t)'%');
-					TxChannel->WriteChar((uint8_t)text[i]);
-			}
-		} else
-			TxChannel->WriteChar((uint8_t)text[i]);
-	}
-	va_end(args); // End format processing
-	//
-	TxChannel->StartTransmission();
-}
-
-char* Cli_t::Read(){
-	char temp;
-	uint8_t CmdBufferPtr = 0;
-
-	if(RxChannel->GetNumberOfBytesReady() == 0)
-		return NULL;
-	//Clear buffer beginning from useless symbols
-	while((RxChannel->GetNumberOfBytesReady() != 0)){
-		temp = RxChannel->ReadChar(NULL);
-		if((temp != '\r') or (temp != '\n'))
-			break;
-	}
-	if(RxChannel->GetNumberOfBytesReady() == 0)
-		return NULL;
-	CommandBuffer[CmdBufferPtr] = temp;
-	CmdBufferPtr++;
-	//Get command from buffer
-	while((RxChannel->GetNumberOfBytesReady() != 0)){
-		temp = RxChannel->ReadChar(NULL);
-		if((temp == '\r') or (temp == '\n') or (temp == ' '))
-			break;
-		CommandBuffer[CmdBufferPtr] = temp;
-		CmdBufferPtr++;
-	}
-	//Add terminator to string
-	CommandBuffer[CmdBufferPtr] = '\0';
-	return CommandBuffer;
-}
-
-char* Cli_t::ReadLine(){
-	char temp;
-	uint8_t CmdBufferPtr = 0;
-
-	if(RxChannel->GetNumberOfBytesReady() == 0)
-		return NULL;
-	//Clear buffer beginning from useless symbols
-	while((RxChannel->GetNumberOfBytesReady() != 0)){
-		temp = RxChannel->ReadChar(NULL);
-		if((temp != '\r') or (temp != '\n'))
-			break;
-	}
-	if(RxChannel->GetNumberOfBytesReady() == 0)
-		return NULL;
-
-	CommandBuffer[CmdBufferPtr] = temp;
-	CmdBufferPtr++;
-	//Get command from buffer
-	while((RxChannel->GetNumberOfBytesReady() != 0)){
-		temp = RxChannel->ReadChar(NULL);
-		if((temp == '\r') or (temp == '\n'))
-			break;
-		CommandBuffer[CmdBufferPtr] = temp;
-		CmdBufferPtr++;
-	}
-	//Add terminator to string
-	CommandBuffer[CmdBufferPtr] = '\0';
-	return CommandBuffer;
+uint32_t DmaRx_t::Read(uint8_t* data, uint32_t length){
+	uint32_t ready = GetNumberOfBytesReady();
+	if(length > ready)
+		length = ready;
+	uint32_t firstPart = BufferSize - BufferStartPtr;
+	if(firstPart > length)
+		firstPart = length;
+	memcpy(data, &Buffer[BufferStartPtr], firstPart);
+	memcpy(data + firstPart, Buffer, length - firstPart);
+	BufferStartPtr = (BufferStartPtr + length) % BufferSize;
+	ReadTotal += length;
+	return length;
 }
@@ -0,0 +1,307 @@
+/*
+ * jdy23.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <jdy23.h>
+
+uint8_t jdy23::GetRateIndex(uint32_t baud){
+	uint8_t rate = 0;
+	while((rate + 1 < JDY23_RATE_COUNT) and (Rates[rate + 1] <= baud))
+		rate++;
+	return rate;
+}
+
+//Jdy23_t
+/////////////////////////////////////////////////////////////////////
+
+void Jdy23_t::Start(uint32_t nowMs){
+	State = jdyBusy;
+	Finished = 0;
+	InfoChanged = 0;
+	InfoChecked = 0;
+	NameSet = 0;
+	StartMs = nowMs;
+	ReadyMs = 0;
+	ProbeCount = 0;
+	Blind = 0;
+	TargetRate = MaxRate;
+	// Module is most likely where it was left
+	SwitchRate(Info->Baud != 0 ? jdy23::GetRateIndex(Info->Baud) : jdy23::GetRateIndex(JDY23_DEFAULT_BAUD));
+	NextStep(jdyStepProbe, nowMs);
+}
+
+void Jdy23_t::SwitchRate(uint8_t rate){
+	Rate = rate;
+	SetBaud(jdy23::Rates[rate]);
+}
+
+void Jdy23_t::Send(uint32_t nowMs){
+	static const char* const Commands[] = {"AT+VER", "AT+MAC", "AT+NAME", "AT+NAME", "AT+BAUD", "AT+RESET", "AT+VER"};
+	char argument[2] = {0, 0};
+	const char* text = "";
+	if(Step == jdyStepSetName)
+		text = Name;
+	else if(Step == jdyStepBaud){
+		argument[0] = '4' + TargetRate;
+		text = argument;
+	}
+	gpio::DeactivatePin(PwrcGpio, PwrcPin);
+	SentBytes = strlen(Commands[Step]) + strlen(text) + 2;
+	Tx->Write((const uint8_t*)Commands[Step], strlen(Commands[Step]));
+	Tx->Write((const uint8_t*)text, strlen(text));
+	Tx->Write((const uint8_t*)"\r\n", 2);
+	Tx->StartTransmission();
+	SentMs = nowMs;
+}
+
+void Jdy23_t::NextStep(uint8_t step, uint32_t nowMs){
+	Step = step;
+	Retries = 0;
+	if(step == jdyStepDone)
+		Finish(jdyReady);
+	else
+		Send(nowMs);
+}
+
+void Jdy23_t::Finish(uint8_t state){
+	gpio::ActivatePin(PwrcGpio, PwrcPin);
+	State = state;
+	Step = jdyStepDone;
+	Finished = 1;
+}
+
+// Module information known, raise baud rate or finish
+void Jdy23_t::InfoDone(uint32_t nowMs){
+	if(Rate != TargetRate){
+		NextStep(jdyStepBaud, nowMs);
+		return;
+	}
+	if(Info->Baud != jdy23::Rates[Rate]){
+		Info->Baud = jdy23::Rates[Rate];
+		InfoChanged = 1;
+	}
+	NextStep(jdyStepDone, nowMs);
+}
+
+// New rate is not reliable. Module usually hears it and only its answers are
+// damaged, so it is told to go one rate lower without waiting for answer.
+// If that fails too, module is searched from there downwards.
+void Jdy23_t::Fallback(uint32_t nowMs){
+	RateStats[TargetRate].Failed++;
+	if(TargetRate == 0){
+		Finish(jdyFailed); // Even default rate does not work
+		return;
+	}
+	TargetRate--;
+	if(Blind){
+		Blind = 0;
+		ProbeCount = 0;
+		NextStep(jdyStepProbe, nowMs);
+	} else{
+		Blind = 1;
+		NextStep(jdyStepBaud, nowMs);
+	}
+}
+
+void Jdy23_t::AddThroughput(uint32_t bytes, uint32_t ms){
+	RateStats[Rate].BytesPerSecond = bytes*1000/(ms != 0 ? ms : 1);
+}
+
+// "+KEY=value", value is cut to size
+uint8_t Jdy23_t::CopyValue(const char* line, const char* key, char* value, uint32_t size){
+	uint32_t keyLength = strlen(key);
+	if((line[0] != '+') or (strncmp(&line[1], key, keyLength) != 0) or (line[keyLength + 1] != '='))
+		return retvNotFound;
+	const char* text = &line[keyLength + 2];
+	uint32_t length = strlen(text);
+	if(length > size - 1)
+		length = size - 1;
+	if((strncmp(value, text, length) == 0) and (value[length] == '\0'))
+		return retvSame;
+	memcpy(value, text, length);
+	value[length] = '\0';
+	return retvNew;
+}
+
+uint8_t Jdy23_t::ProcessLine(const char* line, uint32_t nowMs){
+	if(State != jdyBusy)
+		return retvFail;
+	uint8_t retv = retvNotFound;
+	uint32_t answerBytes = strlen(line) + 2;
+	switch(Step){
+		case jdyStepProbe:
+			retv = CopyValue(line, "VERSION", Info->Version, JDY23_VERSION_SIZE);
+			if(retv == retvNotFound)
+				break;
+			if(ReadyMs == 0)
+				ReadyMs = nowMs - StartMs;
+			AddThroughput(SentBytes + answerBytes, nowMs - SentMs);
+			if(InfoChecked){
+				InfoDone(nowMs);
+				break;
+			}
+			InfoChecked = 1;
+			// Same module as cached, no need to ask it again
+			if((retv == retvSame) and (Info->Mac[0] != '\0') and (strcmp(Info->Name, Name) == 0))
+				InfoDone(nowMs);
+			else
+				NextStep(jdyStepMac, nowMs);
+			break;
+		case jdyStepMac:
+			retv = CopyValue(line, "MAC", Info->Mac, JDY23_MAC_SIZE);
+			if(retv != retvNotFound)
+				NextStep(jdyStepName, nowMs);
+			break;
+		case jdyStepName:
+			retv = CopyValue(line, "NAME", Info->Name, JDY23_NAME_SIZE);
+			if(retv == retvNotFound)
+				break;
+			// Name is set once, module may cut it
+			if((strcmp(Info->Name, Name) != 0) and (NameSet == 0))
+				NextStep(jdyStepSetName, nowMs);
+			else
+				InfoDone(nowMs);
+			break;
+		case jdyStepSetName:
+			if(strstr(line, "OK") == NULL)
+				break;
+			retv = retvOk;
+			NameSet = 1;
+			NextStep(jdyStepName, nowMs);
+			break;
+		case jdyStepBaud:
+			if(strstr(line, "OK") == NULL)
+				break;
+			retv = retvOk;
+			NextStep(jdyStepReset, nowMs);
+			break;
+		case jdyStepReset:
+			retv = retvOk; // Restart is waited anyway
+			break;
+		case jdyStepVerify:{
+			retv = retvOk;
+			// Noise received before switch may stick to answer
+			const char* answer = strstr(line, "+VERSION=");
+			if((answer == NULL) or (strcmp(&answer[9], Info->Version) != 0)){
+				Fallback(nowMs); // Damaged or foreign answer
+				break;
+			}
+			VerifyBytes += SentBytes + answerBytes;
+			VerifyCount++;
+			if(VerifyCount < JDY23_VERIFY_COUNT){
+				Send(nowMs);
+				break;
+			}
+			AddThroughput(VerifyBytes, nowMs - VerifyStartMs);
+			RateStats[Rate].Verified++;
+			Blind = 0;
+			InfoDone(nowMs);
+			break;
+		}
+	}
+	if(retv == retvNotFound)
+		return retvNotFound;
+	if(retv == retvNew)
+		InfoChanged = 1;
+	return retvOk;
+}
+
+uint8_t Jdy23_t::Poll(uint32_t nowMs){
+	if(Finished){
+		Finished = 0;
+		return retvOk;
+	}
+	if(State != jdyBusy)
+		return retvEmpty;
+	if(nowMs - SentMs < GetTimeoutMs())
+		return retvBusy;
+
+	switch(Step){
+		case jdyStepProbe:
+			// One attempt per rate, all rates JDY23_RETRIES times
+			if(++ProbeCount >= JDY23_RATE_COUNT*JDY23_RETRIES){
+				Finish(jdyFailed);
+				Finished = 0;
+				return retvOk;
+			}
+			SwitchRate(Rate > 0 ? Rate - 1 : JDY23_RATE_COUNT - 1);
+			Send(nowMs);
+			break;
+		case jdyStepReset:
+			SwitchRate(TargetRate);
+			VerifyCount = 0;
+			VerifyBytes = 0;
+			VerifyStartMs = nowMs;
+			NextStep(jdyStepVerify, nowMs);
+			break;
+		case jdyStepVerify:
+			Fallback(nowMs);
+			break;
+		default:
+			if(Retries < JDY23_RETRIES){
+				Retries++;
+				Send(nowMs);
+			} else if(Step == jdyStepBaud){
+				if(Blind)
+					NextStep(jdyStepReset, nowMs);
+				else{
+					TargetRate = Rate; // Module keeps its rate
+					InfoDone(nowMs);
+				}
+			} else{
+				Finish(jdyFailed);
+				Finished = 0;
+				return retvOk;
+			}
+			break;
+	}
+	if(Finished){
+		Finished = 0;
+		return retvOk;
+	}
+	return retvBusy;
+}
+
+uint32_t Jdy23_t::GetWaitMs(uint32_t nowMs){
+	if(Finished)
+		return 0;
+	if(State != jdyBusy)
+		return 0xFFFFFFFF;
+	uint32_t elapsed = nowMs - SentMs;
+	return elapsed >= GetTimeoutMs() ? 0 : GetTimeoutMs() - elapsed;
+}
+
+//Jdy23Link_t
+/////////////////////////////////////////////////////////////////////
+
+void Jdy23Link_t::Init(uint8_t irqPrio){
+	gpio::SetupPin(Gpio, Pin, InputWithPull, PullDown); // Module off - disconnected
+	gpio::EnableExti(Gpio, Pin, ExtiBothEdges, irqPrio);
+	Connected = gpio::GetPinInput(Gpio, Pin); // Edge after this is seen by interrupt
+}
+
+uint8_t Jdy23Link_t::Subscribe(Jdy23LinkCallback_t callback){
+	if(SubscriberCount >= JDY23_LINK_SUBSCRIBERS)
+		return retvOutOfMemory;
+	Subscribers[SubscriberCount++] = callback;
+	return retvOk;
+}
+
+uint8_t Jdy23Link_t::IrqHandler(){
+	if(gpio::ClearExti(Pin) != retvOk)
+		return retvFail; // Other line of shared IRQ
+	uint8_t connected = gpio::GetPinInput(Gpio, Pin);
+	if(connected == Connected)
+		return retvSame;
+	Connected = connected;
+	if(connected)
+		Connects++;
+	else
+		Disconnects++;
+	for(uint8_t i = 0; i < SubscriberCount; i++)
+		Subscribers[i](connected);
+	return retvOk;
+}
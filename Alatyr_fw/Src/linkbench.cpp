@@ -0,0 +1,172 @@
+/*
+ * linkbench.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <linkbench.h>
+
+//LinkBench_t
+/////////////////////////////////////////////////////////////////////
+
+uint8_t LinkBench_t::Run(iWriter_t* tx, iReader_t* rx, uint8_t mode, uint32_t size, uint32_t durationMs){
+	if((size == 0) or (size > LINKBENCH_MAX_SIZE) or (mode > linkEcho))
+		return retvBadValue;
+	memset(&Result, 0, sizeof(Result));
+	memset(Histogram, 0, sizeof(Histogram));
+	TxCounter = 0;
+	RxCounter = 0;
+	if(durationMs > LINKBENCH_MAX_TIME_MS)
+		durationMs = LINKBENCH_MAX_TIME_MS;
+	uint32_t durationUs = durationMs*1000;
+	switch(mode){
+		case linkTx:
+			RunTx(tx, size, durationUs);
+			break;
+		case linkRx:
+			RunRx(rx, durationUs);
+			break;
+		case linkEcho:
+			RunEcho(tx, rx, size, durationUs);
+			ComputeLatency();
+			break;
+	}
+	return retvOk;
+}
+
+void LinkBench_t::RunTx(iWriter_t* tx, uint32_t size, uint32_t durationUs){
+	uint32_t startCycles = dwt::GetCycles();
+	while(GetUs(startCycles) < durationUs){
+		for(uint32_t i = 0; i < size; i++)
+			Buffer[i] = TxCounter + i;
+		// Writer full - same chunk again after wait
+		if(tx->Write(Buffer, size) != size){
+			Wait();
+			continue;
+		}
+		tx->StartTransmission();
+		TxCounter += size;
+		Result.Bytes += size;
+	}
+	Result.ElapsedUs = GetUs(startCycles);
+}
+
+void LinkBench_t::RunRx(iReader_t* rx, uint32_t durationUs){
+	uint32_t startCycles = dwt::GetCycles();
+	while(GetUs(startCycles) < durationUs){
+		uint32_t length = rx->Read(Buffer, LINKBENCH_MAX_SIZE);
+		if(length == 0){
+			Wait();
+			continue;
+		}
+		Result.Bytes += Check(Buffer, length);
+	}
+	Result.ElapsedUs = GetUs(startCycles);
+}
+
+void LinkBench_t::RunEcho(iWriter_t* tx, iReader_t* rx, uint32_t size, uint32_t durationUs){
+	uint32_t startCycles = dwt::GetCycles();
+	while(GetUs(startCycles) < durationUs){
+		for(uint32_t i = 0; i < size; i++)
+			Buffer[i] = TxCounter + i;
+		if(tx->Write(Buffer, size) != size){
+			Wait();
+			continue;
+		}
+		uint32_t sentCycles = dwt::GetCycles();
+		tx->StartTransmission();
+		TxCounter += size;
+
+		uint32_t received = 0;
+		while((received < size) and (GetUs(sentCycles) < LINKBENCH_ECHO_TIMEOUT_MS*1000)){
+			uint32_t length = rx->Read(Buffer, size - received);
+			if(length == 0){
+				Wait();
+				continue;
+			}
+			Result.Bytes += Check(Buffer, length);
+			received += length;
+		}
+		if(received < size){
+			Result.Timeouts++;
+			RxCounter = TxCounter; // Late bytes of this chunk count as errors
+			continue;
+		}
+		AddRoundTrip(GetUs(sentCycles));
+	}
+	Result.ElapsedUs = GetUs(startCycles);
+}
+
+// Returns intact bytes, stream continues from wrong byte
+uint32_t LinkBench_t::Check(const uint8_t* data, uint32_t length){
+	uint32_t intact = 0;
+	for(uint32_t i = 0; i < length; i++){
+		if(data[i] == RxCounter)
+			intact++;
+		else
+			Result.Errors++;
+		RxCounter = data[i] + 1;
+	}
+	return intact;
+}
+
+// Bins 0..15 are exact, then 8 bins per power of two
+void LinkBench_t::AddRoundTrip(uint32_t us){
+	uint32_t bin = us;
+	if(us >= 16){
+		uint32_t exponent = 31 - __builtin_clz(us);
+		bin = 8*(exponent - 2) + ((us >> (exponent - 3)) & 7);
+	}
+	if(bin >= LINKBENCH_BINS)
+		bin = LINKBENCH_BINS - 1;
+	if(Histogram[bin] < 0xFFFF)
+		Histogram[bin]++;
+	if(us > Result.LatencyMaxUs)
+		Result.LatencyMaxUs = us;
+	Result.RoundTrips++;
+}
+
+// Upper bound of bin holding given share of round trips, not above maximum
+uint32_t LinkBench_t::GetPercentile(uint32_t percent){
+	uint32_t total = 0; // Saturated bins may count less than RoundTrips
+	for(uint32_t i = 0; i < LINKBENCH_BINS; i++)
+		total += Histogram[i];
+	uint32_t rank = (total*percent + 99)/100; // 1-based
+	uint32_t count = 0;
+	uint32_t bin = 0;
+	for(; bin < LINKBENCH_BINS - 1; bin++){
+		count += Histogram[bin];
+		if(count >= rank)
+			break;
+	}
+	uint32_t limit = bin;
+	if(bin == LINKBENCH_BINS - 1)
+		limit = Result.LatencyMaxUs; // Top bin also holds all longer times
+	else if(bin >= 16){
+		uint32_t exponent = bin/8 + 2;
+		limit = ((8 + bin % 8) << (exponent - 3)) + (1UL << (exponent - 3)) - 1;
+	}
+	return limit < Result.LatencyMaxUs ? limit : Result.LatencyMaxUs;
+}
+
+void LinkBench_t::ComputeLatency(){
+	if(Result.RoundTrips == 0)
+		return;
+	Result.LatencyP50Us = GetPercentile(50);
+	Result.LatencyP99Us = GetPercentile(99);
+}
+
+uint32_t LinkBench_t::Drain(iReader_t* rx){
+	uint32_t dropped = 0;
+	uint32_t quietCycles = dwt::GetCycles();
+	while(GetUs(quietCycles) < LINKBENCH_SETTLE_MS*1000){
+		uint32_t length = rx->Read(Buffer, LINKBENCH_MAX_SIZE);
+		if(length != 0){
+			dropped += length;
+			quietCycles = dwt::GetCycles();
+		} else
+			Wait();
+	}
+	return dropped;
+}
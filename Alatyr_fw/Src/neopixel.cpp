@@ -37,19 +37,27 @@ uint32_t RgbToGrb(uint32_t rgbVal){
 	return grbVal;
 }
 
+uint32_t ScaleGrbColor(uint32_t grbColor, uint32_t scale){
+	uint32_t g = (((grbColor >> 16) & 0xFF)*scale) >> 8;
+	uint32_t r = (((grbColor >> 8) & 0xFF)*scale) >> 8;
+	uint32_t b = ((grbColor & 0xFF)*scale) >> 8;
+	return (g << 16) | (r << 8) | b;
+}
+
 void Neopixel_t::Init(uint32_t currentTimerClock, uint8_t dmaIrqPrio){
 	// Setup TIM parameters
 	Timer->PSC = (uint32_t)(currentTimerClock/NPX_TIM_FREQUECY) - 1; // 8 MHz counter clock
-	Timer->CR1 |= TIM_CR1_DIR; // Up counter
+	Timer->CR1 &= ~TIM_CR1_DIR; // Up counter, compare event is falling edge of bit
 	Timer->ARR = NPX_ARR; // Timer update frequency 800 kHz
 	Timer->EGR = TIM_EGR_UG; // Update event to reload prescaler value
 	// Enable channel output and set compare type
-	Timer->CCMR1 |= (outputComparePWM1 << TIM_CCMR1_OC1M_Pos); //TEMP!!
+	Timer->CCMR1 |= (outputComparePWM1 << TIM_CCMR1_OC1M_Pos) | TIM_CCMR1_OC1PE; //TEMP!!
 	Timer->CCER |= TIM_CCER_CC1E; //TEMP!!
 	Timer->CCER |= 0b1 << (TimerChannelNumber-1)*4; // Output compare enable output
 	if (Timer == TIM1)
 		TIM1->BDTR |= TIM_BDTR_MOE; // Main output enable
-	TIM1->DIER |= TIM_DIER_UDE; // Timer generates DMA request on update event
+	Timer->CNT = NPX_ARR;
+	Timer->DIER |= TIM_DIER_CC1DE; // DMA request on compare, value is loaded on next update //TEMP!!
 
 	// Setup DMA parameters
 	Dma->Channel->CCR =  DMA_CCR_MINC; // Memory increment
@@ -62,29 +70,231 @@ void Neopixel_t::Init(uint32_t currentTimerClock, uint8_t dmaIrqPrio){
 }
 
 void Neopixel_t::Update(){
+	LimitCurrent();
+	UpdateFromBuffer(Buffer);
+}
+
+uint8_t Neopixel_t::UpdateFromBuffer(const uint8_t* buffer){
 	if((Dma->Channel->CCR & DMA_CCR_EN) != 0)
-		return; //Nothing changes if DMA already running
+		return retvBusy; //Nothing changes if DMA already running
+	FrameStartCycles = dwt::GetCycles();
+	// First value goes to preload directly, rest of frame and stop slot by DMA
+	Timer->CCR1 = buffer[0]; //TEMP!!
 	Dma->Channel->CNDTR = StripLength*24;
-	Dma->Channel->CMAR = (uint32_t)&Buffer[0];
+	Dma->Channel->CMAR = (uint32_t)&buffer[1];
 	Dma->Channel->CPAR = (uint32_t)&TIM1->CCR1; //TEMP!!
 	// Enable DMA and Timer
 	Dma->Channel->CCR |= DMA_CCR_EN;
 	Timer->CR1 |= TIM_CR1_CEN;
+	return retvOk;
 }
 
 void Neopixel_t::Clear(){
 	for(uint32_t i = 0; i < 24*StripLength; i++)
 		Buffer[i] = NPX_LOW;
+	Buffer[24*StripLength] = NPX_STOP;
+	ChannelSum[0] = 0; ChannelSum[1] = 0; ChannelSum[2] = 0;
 }
 
 void Neopixel_t::WriteLedColor(uint8_t ledNumber, uint32_t gbrColor){
-	// Writing to buffer
-	uint32_t mask = 0x800000;
-	for(uint32_t i = 0; i < 24; i++){
-		if(mask & gbrColor)
-			Buffer[ledNumber*24 + i] = NPX_HIGH;
-		else
-			Buffer[ledNumber*24 + i] = NPX_LOW;
-		mask = mask >> 1;
+	if(CalEnabled)
+		gbrColor = CalibrateColor(gbrColor);
+	if(LimitScale < NPX_SCALE_MAX)
+		gbrColor = ScaleGrbColor(gbrColor, LimitScale);
+	EncodeLedColor(ledNumber, gbrColor);
+}
+
+// Writing to buffer, channel sums are updated with difference to previous color
+void Neopixel_t::EncodeLedColor(uint8_t ledNumber, uint32_t grbColor){
+	uint8_t* led = &Buffer[ledNumber*24];
+	for(uint32_t channel = 0; channel < 3; channel++){
+		uint32_t newValue = (grbColor >> (16 - 8*channel)) & 0xFF;
+		uint32_t oldValue = 0;
+		for(uint32_t mask = 0x80; mask > 0; mask = mask >> 1){
+			oldValue = (oldValue << 1) | (*led == NPX_HIGH);
+			if(mask & newValue)
+				*led = NPX_HIGH;
+			else
+				*led = NPX_LOW;
+			led++;
+		}
+		ChannelSum[channel] += newValue - oldValue;
 	}
 }
+
+uint32_t Neopixel_t::ReadLedColor(uint8_t ledNumber){
+	uint32_t grbColor = 0;
+	for(uint32_t i = 0; i < 24; i++)
+		grbColor = (grbColor << 1) | (Buffer[ledNumber*24 + i] == NPX_HIGH);
+	return grbColor;
+}
+
+//Color calibration
+/////////////////////////////////////////////////////////////////////
+
+void Neopixel_t::SetCalibration(const NpxCalibration_t* calibration){
+	CalEnabled = 0;
+	for(uint32_t row = 0; row < 3; row++){
+		for(uint32_t column = 0; column < 3; column++){
+			int32_t value = calibration->Matrix[3*row + column];
+			value = value*calibration->WhiteBalance[row]/NPX_CAL_ONE;
+			// Product may overflow int16, gain of 128 or more saturates output anyway
+			if(value > NPX_CAL_MAX)
+				value = NPX_CAL_MAX;
+			else if(value < NPX_CAL_MIN)
+				value = NPX_CAL_MIN;
+			CalMatrix[3*row + column] = value;
+			if(value != ((row == column) ? NPX_CAL_ONE : 0))
+				CalEnabled = 1; // Identity is skipped
+		}
+	}
+}
+
+uint32_t Neopixel_t::CalibrateColor(uint32_t grbColor){
+	int32_t g = (grbColor >> 16) & 0xFF;
+	int32_t r = (grbColor >> 8) & 0xFF;
+	int32_t b = grbColor & 0xFF;
+	uint32_t result = 0;
+	for(uint32_t row = 0; row < 3; row++){
+		const int16_t* m = &CalMatrix[3*row];
+		int32_t value = (m[0]*g + m[1]*r + m[2]*b) >> 8;
+		if(value < 0)
+			value = 0;
+		else if(value > 255)
+			value = 255;
+		result = (result << 8) | value;
+	}
+	return result;
+}
+
+//Power limiter
+/////////////////////////////////////////////////////////////////////
+
+// Budget at or below idle current keeps strip black, and every release step
+// from black would flash it for one frame
+uint8_t Neopixel_t::SetCurrentBudget(uint16_t budgetMa){
+	if(budgetMa > NPX_MAX_BUDGET_MA)
+		budgetMa = NPX_MAX_BUDGET_MA;
+	if((budgetMa != 0) and (budgetMa < GetMinBudgetMa()))
+		return retvBadValue;
+	CurrentBudgetMa = budgetMa;
+	if(budgetMa == 0)
+		LimitScale = NPX_SCALE_MAX;
+	return retvOk;
+}
+
+uint32_t Neopixel_t::EstimateCurrent(){
+	return StripLength*NPX_IDLE_UA_PER_LED + ChannelSum[0]*NPX_G_UA_PER_LSB
+			+ ChannelSum[1]*NPX_R_UA_PER_LSB + ChannelSum[2]*NPX_B_UA_PER_LSB;
+}
+
+// Fast attack - frame over budget is scaled down before sending,
+// slow release - scale returns to full while frames fit budget
+void Neopixel_t::LimitCurrent(){
+	uint32_t current = EstimateCurrent();
+	if(CurrentBudgetMa != 0){
+		uint32_t budget = CurrentBudgetMa*1000UL;
+		uint32_t idle = StripLength*NPX_IDLE_UA_PER_LED;
+		if(current > budget){
+			uint32_t scale = 0;
+			if(budget > idle)
+				scale = ((budget - idle) << 8)/(current - idle);
+			for(uint32_t i = 0; i < StripLength; i++)
+				EncodeLedColor(i, ScaleGrbColor(ReadLedColor(i), scale));
+			LimitScale = (LimitScale*scale) >> 8;
+			current = EstimateCurrent();
+		} else if(LimitScale < NPX_SCALE_MAX){
+			uint32_t scale = LimitScale + (NPX_SCALE_MAX - LimitScale)/NPX_LIMIT_RELEASE + 1;
+			// Same frame at new scale must fit budget
+			if(LimitScale == 0 or (current - idle)*scale/LimitScale + idle <= budget)
+				LimitScale = scale;
+		}
+	}
+	EstimatedCurrentUa = current;
+}
+
+//NpxPowerGate_t
+/////////////////////////////////////////////////////////////////////
+
+uint8_t NpxPowerGate_t::AddDataPin(GPIO_TypeDef* gpio, uint8_t pin, PinMode_t mode){
+	if(DataPinCount >= NPX_GATE_DATA_PINS)
+		return retvOutOfMemory;
+	DataPins[DataPinCount].Gpio = gpio;
+	DataPins[DataPinCount].Pin = pin;
+	DataPins[DataPinCount].Mode = mode;
+	DataPinCount++;
+	return retvOk;
+}
+
+void NpxPowerGate_t::Init(uint32_t nowMs){
+	gpio::SetupPin(Gpio, Pin, Output10MHzPushPull);
+	PowerOn(nowMs);
+	BlackSinceMs = nowMs;
+}
+
+void NpxPowerGate_t::PowerOff(uint32_t nowMs){
+	if(!Powered)
+		return;
+	// Last frame must be sent before clocks are gated
+	uint32_t startCycles = dwt::GetCycles();
+	uint32_t flushCycles = NPX_GATE_FLUSH_US*(rcc::GetCurrentSystemClock()/1000000);
+	while(Strip->IsBusy()){
+		if(dwt::GetCycles() - startCycles > flushCycles){
+			FlushTimeouts++;
+			break;
+		}
+	}
+	for(uint8_t i = 0; i < DataPinCount; i++){
+		gpio::DeactivatePin(DataPins[i].Gpio, DataPins[i].Pin);
+		gpio::SetupPin(DataPins[i].Gpio, DataPins[i].Pin, Output2MHzPushPull);
+	}
+	power::ReleaseClock(StripClock);
+	power::ReleaseClock(pwrClkDma1);
+	gpio::DeactivatePin(Gpio, Pin);
+	Powered = 0;
+	OffSinceMs = nowMs;
+}
+
+void NpxPowerGate_t::PowerOn(uint32_t nowMs){
+	if(Powered)
+		return;
+	power::RequestClock(pwrClkDma1);
+	power::RequestClock(StripClock);
+	gpio::ActivatePin(Gpio, Pin);
+	for(uint8_t i = 0; i < DataPinCount; i++)
+		gpio::SetupPin(DataPins[i].Gpio, DataPins[i].Pin, DataPins[i].Mode);
+	if(PowerCycles != 0)
+		OffTimeMs += nowMs - OffSinceMs;
+	Powered = 1;
+	PowerCycles++;
+}
+
+uint32_t NpxPowerGate_t::PrepareFrame(uint32_t nowMs, uint8_t frameIsBlack){
+	if(ForcedOff)
+		return 0;
+	if(!frameIsBlack){
+		BlackSinceMs = nowMs;
+		if(Powered)
+			return 0;
+		PowerOn(nowMs);
+		return SettleMs;
+	}
+	if(Powered and (nowMs - BlackSinceMs >= HoldMs))
+		PowerOff(nowMs);
+	return 0;
+}
+
+void NpxPowerGate_t::SetForcedOff(uint8_t forcedOff, uint32_t nowMs){
+	ForcedOff = forcedOff;
+	if(forcedOff)
+		PowerOff(nowMs);
+	else
+		BlackSinceMs = nowMs; // Automatic control from now
+}
+
+uint32_t NpxPowerGate_t::GetOffTimeMs(uint32_t nowMs){
+	if(Powered)
+		return OffTimeMs;
+	else
+		return OffTimeMs + nowMs - OffSinceMs;
+}
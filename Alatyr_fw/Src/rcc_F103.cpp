@@ -221,6 +221,47 @@ uint32_t rcc::GetCurrentTimersClock(uint32_t currentApbClockHz){
 	}
 }
 
+//power
+/////////////////////////////////////////////////////////////////////
+
+static uint8_t ClockUsers[pwrClkNumber];
+
+void power::RequestClock(PowerClock_t clock){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if(ClockUsers[clock] == 0){
+		switch(clock){
+			case pwrClkDma1: rcc::EnableClkAHB(RCC_AHBENR_DMA1EN); break;
+			case pwrClkTim1: rcc::EnableClkAPB2(RCC_APB2ENR_TIM1EN); break;
+			case pwrClkSpi2: rcc::EnableClkAPB1(RCC_APB1ENR_SPI2EN); break;
+			default: break;
+		}
+	}
+	ClockUsers[clock]++;
+	__set_PRIMASK(primask);
+}
+
+void power::ReleaseClock(PowerClock_t clock){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if(ClockUsers[clock] == 1){
+		// Peripheral registers keep their values while clock is gated
+		switch(clock){
+			case pwrClkDma1: rcc::DisableClkAHB(RCC_AHBENR_DMA1EN); break;
+			case pwrClkTim1: rcc::DisableClkAPB2(RCC_APB2ENR_TIM1EN); break;
+			case pwrClkSpi2: rcc::DisableClkAPB1(RCC_APB1ENR_SPI2EN); break;
+			default: break;
+		}
+	}
+	if(ClockUsers[clock] > 0)
+		ClockUsers[clock]--;
+	__set_PRIMASK(primask);
+}
+
+uint8_t power::GetClockUsers(PowerClock_t clock){
+	return ClockUsers[clock];
+}
+
 //flash
 /////////////////////////////////////////////////////////////////////
 /*
@@ -235,3 +276,47 @@ void flash::SetFlashPrefetchAndLatency(uint8_t Latency){
     Temp |= Latency << FLASH_ACR_LATENCY_Pos;
     FLASH->ACR = Temp;
 }
+
+static uint8_t WaitFlashOperation(uint32_t Timeout){
+	while(FLASH->SR & FLASH_SR_BSY){
+		Timeout--;
+		if (Timeout == 0)
+			return retvTimeout;
+	}
+	uint32_t status = FLASH->SR;
+	FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR; // Clear flags
+	if(status & FLASH_SR_WRPRTERR)
+		return retvWriteProtect;
+	if(status & FLASH_SR_PGERR)
+		return retvWriteError;
+	return retvOk;
+}
+
+// Flash must be unlocked
+uint8_t flash::ErasePage(uint32_t pageAddress, uint32_t Timeout){
+	FLASH->CR |= FLASH_CR_PER;
+	FLASH->AR = pageAddress;
+	FLASH->CR |= FLASH_CR_STRT;
+	uint8_t retv = WaitFlashOperation(Timeout);
+	FLASH->CR &= ~FLASH_CR_PER;
+	return retv;
+}
+
+// Flash must be unlocked and erased, address is half-word aligned
+uint8_t flash::ProgramHalfWords(uint32_t address, const uint16_t* data,
+		uint32_t count, uint32_t Timeout){
+	uint8_t retv = retvOk;
+	FLASH->CR |= FLASH_CR_PG;
+	for(uint32_t i = 0; i < count; i++){
+		*(volatile uint16_t*)(address + 2*i) = data[i];
+		retv = WaitFlashOperation(Timeout);
+		if(retv != retvOk)
+			break;
+		if(*(volatile uint16_t*)(address + 2*i) != data[i]){
+			retv = retvWriteError;
+			break;
+		}
+	}
+	FLASH->CR &= ~FLASH_CR_PG;
+	return retv;
+}
@@ -0,0 +1,229 @@
+/*
+ * rpc.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <rpc.h>
+
+//Packet coding
+/////////////////////////////////////////////////////////////////////
+
+// Half byte table, 32 bytes of flash instead of 512
+static const uint16_t Crc16Table[16] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+uint16_t rpc::Crc16(const uint8_t* data, uint32_t length, uint16_t crc){
+	for(uint32_t i = 0; i < length; i++){
+		crc = (crc << 4) ^ Crc16Table[(crc >> 12) ^ (data[i] >> 4)];
+		crc = (crc << 4) ^ Crc16Table[(crc >> 12) ^ (data[i] & 0x0F)];
+	}
+	return crc;
+}
+
+uint32_t rpc::CobsDecode(const uint8_t* data, uint32_t length, uint8_t* out, uint32_t outSize){
+	uint32_t in = 0;
+	uint32_t n = 0;
+	while(in < length){
+		uint8_t code = data[in++];
+		if(code == 0)
+			return 0;
+		for(uint32_t i = 1; i < code; i++){
+			if((in >= length) or (n >= outSize) or (data[in] == 0))
+				return 0;
+			out[n++] = data[in++];
+		}
+		// Block shorter than 254 bytes ends with zero, except last one
+		if((code != 0xFF) and (in < length)){
+			if(n >= outSize)
+				return 0;
+			out[n++] = 0;
+		}
+	}
+	return n;
+}
+
+uint32_t rpc::CobsEncode(const uint8_t* data, uint32_t length, uint8_t* out){
+	uint32_t codePtr = 0;
+	uint32_t n = 1;
+	uint8_t code = 1;
+	for(uint32_t i = 0; i < length; i++){
+		if(data[i] != 0){
+			out[n++] = data[i];
+			code++;
+		}
+		if((data[i] == 0) or (code == 0xFF)){
+			out[codePtr] = code;
+			codePtr = n++;
+			code = 1;
+		}
+	}
+	out[codePtr] = code;
+	return n;
+}
+
+uint32_t rpc::PutVarint(uint8_t* out, uint32_t size, uint32_t value){
+	uint32_t n = 0;
+	do{
+		if(n >= size)
+			return 0;
+		uint8_t data = value & 0x7F;
+		value >>= 7;
+		out[n++] = value ? data | 0x80 : data;
+	} while(value);
+	return n;
+}
+
+uint32_t rpc::GetVarint(const uint8_t* data, uint32_t length, uint32_t* value){
+	uint32_t result = 0;
+	for(uint32_t n = 0; (n < length) and (n < 5); n++){
+		result |= (uint32_t)(data[n] & 0x7F) << 7*n;
+		if((data[n] & 0x80) == 0){
+			*value = result;
+			return n + 1;
+		}
+	}
+	return 0;
+}
+
+//RpcLink_t
+/////////////////////////////////////////////////////////////////////
+
+/*
+* First zero opens packet, next one closes it. Zero that closes broken frame
+* (bad COBS or CRC) opens next one, so if a delimiter was lost, garbage up to
+* next host packet is dropped and that packet is received. Empty frames are
+* skipped, frame longer than packet drops link back to text mode, so text
+* swallowed after a lost delimiter stops within RPC_PACKET_SIZE bytes.
+*/
+void RpcLink_t::Receive(uint8_t data){
+	if(data != 0){
+		if(Length < sizeof(Frame))
+			Frame[Length++] = data;
+		else{
+			Stats.FrameErrors++;
+			InPacket = 0; // Rest of it is text
+			Length = 0;
+		}
+		return;
+	}
+	if((InPacket == 0) or (Length == 0)){
+		InPacket = 1;
+		Length = 0;
+		return;
+	}
+	uint8_t packet[RPC_PACKET_SIZE];
+	uint32_t length = rpc::CobsDecode(Frame, Length, packet, sizeof(packet));
+	Length = 0;
+	if(length == 0){
+		Stats.FrameErrors++;
+		return; // Stay in packet, zero opens next frame
+	}
+	if(Execute(packet, length) == retvOk)
+		InPacket = 0;
+}
+
+// Calls are executed until first broken one, answers of executed calls are sent
+uint8_t RpcLink_t::Execute(const uint8_t* packet, uint32_t length){
+	Stats.Packets++;
+	if(length < 3){
+		Stats.FrameErrors++;
+		return retvBadValue;
+	}
+	uint32_t end = length - 2;
+	if(rpc::Crc16(packet, end) != (packet[end] | (packet[end + 1] << 8))){
+		Stats.CrcErrors++;
+		return retvCRCError;
+	}
+
+	uint8_t response[RPC_PACKET_SIZE];
+	uint32_t out = 0;
+	uint32_t in = 0;
+	response[out++] = packet[in++]; // Request id
+	while((in < end) and (out + 2 + 2 <= sizeof(response))){
+		RpcArgs_t args;
+		uint8_t opcode = packet[in] & (RPC_MAX_OPS - 1);
+		args.Count = packet[in++] >> 5;
+		uint32_t i;
+		for(i = 0; i < args.Count; i++){
+			uint32_t used = rpc::GetVarint(&packet[in], end - in, &args.Arg[i]);
+			if(used == 0)
+				break;
+			in += used;
+		}
+		if(i != args.Count){
+			Stats.FrameErrors++;
+			break;
+		}
+
+		RpcArgs_t result;
+		result.Count = 0;
+		uint8_t status = retvCmdUnknown;
+		if(opcode < OpCount)
+			status = Ops[opcode](args, result);
+		Stats.Calls++;
+
+		// Results which don't fit are dropped, space for CRC is kept
+		uint32_t start = out;
+		out += 2;
+		for(i = 0; i < result.Count; i++){
+			uint32_t used = rpc::PutVarint(&response[out], sizeof(response) - 2 - out, result.Arg[i]);
+			if(used == 0)
+				break;
+			out += used;
+		}
+		if(i != result.Count){
+			out = start + 2;
+			result.Count = 0;
+			status = retvOutOfMemory;
+		}
+		response[start] = (result.Count << 5) | opcode;
+		response[start + 1] = status;
+	}
+	uint16_t crc = rpc::Crc16(response, out);
+	response[out++] = crc & 0xFF;
+	response[out++] = crc >> 8;
+
+	uint8_t frame[RPC_PACKET_SIZE + RPC_PACKET_SIZE/254 + 3];
+	frame[0] = 0;
+	uint32_t frameLength = rpc::CobsEncode(response, out, &frame[1]) + 1;
+	frame[frameLength++] = 0;
+	if(Output->Write(frame, frameLength) != frameLength)
+		Stats.TxDropped++;
+	Output->StartTransmission();
+	return retvOk;
+}
+
+uint8_t RpcLink_t::ReadChar(retv_t* retv){
+	uint8_t data = 0;
+	uint32_t length = Read(&data, 1);
+	if(retv != NULL)
+		*retv = length ? retvOk : retvEmpty;
+	return data;
+}
+
+uint32_t RpcLink_t::Read(uint8_t* data, uint32_t length){
+	uint8_t chunk[16];
+	uint32_t n = 0;
+	while(n < length){
+		// Never more than caller can take, all of chunk may be text
+		uint32_t size = length - n < sizeof(chunk) ? length - n : sizeof(chunk);
+		size = Input->Read(chunk, size);
+		if(size == 0)
+			break;
+		for(uint32_t i = 0; i < size; i++){
+			if(InPacket or (chunk[i] == 0))
+				Receive(chunk[i]);
+			else
+				data[n++] = chunk[i];
+		}
+	}
+	return n;
+}
+
+uint32_t RpcLink_t::GetNumberOfBytesReady(){
+	return Input->GetNumberOfBytesReady();
+}
@@ -0,0 +1,54 @@
+/*
+ * settings.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <settings.h>
+#include <cstring>
+
+extern uint32_t _settings_start; // Linker script
+
+static uint32_t GetChecksum(const Settings_t* settings){
+	const uint32_t* words = (const uint32_t*)settings;
+	uint32_t sum = 0;
+	for(uint32_t i = 0; i < sizeof(Settings_t)/4 - 1; i++)
+		sum += words[i];
+	return ~sum;
+}
+
+void settings::SetDefaults(Settings_t* settings){
+	memset(settings, 0, sizeof(Settings_t));
+	for(uint32_t i = 0; i < 3; i++){
+		settings->NpxCalibration.Matrix[4*i] = NPX_CAL_ONE; // Identity
+		settings->NpxCalibration.WhiteBalance[i] = NPX_CAL_ONE;
+	}
+}
+
+uint8_t settings::Load(Settings_t* settings){
+	const Settings_t* stored = (const Settings_t*)&_settings_start;
+	if((stored->Magic != SETTINGS_MAGIC) or (stored->Size != sizeof(Settings_t))
+			or (stored->Checksum != GetChecksum(stored))){
+		SetDefaults(settings);
+		return retvNotFound;
+	}
+	memcpy(settings, stored, sizeof(Settings_t));
+	return retvOk;
+}
+
+uint8_t settings::Save(Settings_t* settings){
+	settings->Magic = SETTINGS_MAGIC;
+	settings->Size = sizeof(Settings_t);
+	settings->Checksum = GetChecksum(settings);
+	if(memcmp(settings, &_settings_start, sizeof(Settings_t)) == 0)
+		return retvNoChanges; // Save flash write cycles
+
+	uint32_t address = (uint32_t)&_settings_start;
+	flash::Unlock();
+	uint8_t retv = flash::ErasePage(address);
+	if(retv == retvOk)
+		retv = flash::ProgramHalfWords(address, (const uint16_t*)settings, sizeof(Settings_t)/2);
+	flash::Lock();
+	return retv;
+}
@@ -0,0 +1,154 @@
+/*
+ * shell.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <shell.h>
+
+//LineEditor_t
+/////////////////////////////////////////////////////////////////////
+
+void LineEditor_t::Print(const char* text){
+	Echo->Write((const uint8_t*)text, strlen(text));
+}
+
+// Raw input is taken only while there is no finished line
+void LineEditor_t::Process(){
+	if(Ready)
+		return;
+	if(PromptPending){
+		PromptPending = 0;
+		Print(SHELL_PROMPT);
+		Echo->StartTransmission();
+	}
+	uint8_t echoed = 0;
+	while((Ready == 0) and (Input->GetNumberOfBytesReady() != 0)){
+		ProcessChar(Input->ReadChar(NULL));
+		echoed = 1;
+	}
+	if(echoed)
+		Echo->StartTransmission();
+}
+
+void LineEditor_t::ProcessChar(char c){
+	uint8_t lastCr = LastCr;
+	LastCr = (c == '\r');
+	if(EscState == 1){
+		EscState = (c == '[') ? 2 : 0;
+		return;
+	}
+	if(EscState == 2){
+		EscState = 0;
+		if((c == 'A') and (HistoryPos < HistoryCount))
+			Recall(HistoryPos + 1);
+		else if((c == 'B') and (HistoryPos > 0))
+			Recall(HistoryPos - 1);
+		return;
+	}
+
+	switch(c){
+		case '\x1B':
+			EscState = 1;
+			break;
+		case '\n':
+			if(lastCr)
+				break;
+			// fall through
+		case '\r':
+			Finish();
+			break;
+		case '\b':
+		case '\x7F':
+			if(Length > 0){
+				Length--;
+				Print("\b \b");
+			}
+			break;
+		case '\x15': // Ctrl+U
+			Length = 0;
+			Redraw();
+			break;
+		case '\x03': // Ctrl+C
+			Length = 0;
+			HistoryPos = 0;
+			Print("^C\r\n" SHELL_PROMPT);
+			break;
+		default:
+			if((c < ' ') or (c > '~'))
+				break;
+			if(Length < SHELL_LINE_SIZE - 1){ // Place for '\n'
+				Line[Length++] = c;
+				Echo->WriteChar(c);
+			} else
+				Echo->WriteChar('\a');
+			break;
+	}
+}
+
+void LineEditor_t::Redraw(){
+	Print("\r\x1B[K" SHELL_PROMPT);
+	Echo->Write((const uint8_t*)Line, Length);
+}
+
+void LineEditor_t::Recall(uint8_t pos){
+	HistoryPos = pos;
+	Length = 0;
+	if(pos != 0){
+		const char* entry = History[(HistoryHead + SHELL_HISTORY_SIZE - pos) % SHELL_HISTORY_SIZE];
+		Length = strlen(entry);
+		memcpy(Line, entry, Length);
+	}
+	Redraw();
+}
+
+void LineEditor_t::Finish(){
+	Print("\r\n");
+	HistoryPos = 0;
+	if(Length == 0){
+		Print(SHELL_PROMPT);
+		return;
+	}
+	// Repeated command is stored once
+	const char* last = History[(HistoryHead + SHELL_HISTORY_SIZE - 1) % SHELL_HISTORY_SIZE];
+	if((HistoryCount == 0) or (strncmp(last, Line, Length) != 0) or (last[Length] != '\0')){
+		memcpy(History[HistoryHead], Line, Length);
+		History[HistoryHead][Length] = '\0';
+		HistoryHead = (HistoryHead + 1) % SHELL_HISTORY_SIZE;
+		if(HistoryCount < SHELL_HISTORY_SIZE)
+			HistoryCount++;
+	}
+	Line[Length++] = '\n';
+	ReadPtr = 0;
+	Ready = 1;
+}
+
+uint8_t LineEditor_t::ReadChar(retv_t* retv){
+	uint8_t data = 0;
+	uint32_t length = Read(&data, 1);
+	if(retv != NULL)
+		*retv = length ? retvOk : retvEmpty;
+	return data;
+}
+
+uint32_t LineEditor_t::Read(uint8_t* data, uint32_t length){
+	Process();
+	if(Ready == 0)
+		return 0;
+	if(length > (uint32_t)(Length - ReadPtr))
+		length = Length - ReadPtr;
+	memcpy(data, &Line[ReadPtr], length);
+	ReadPtr += length;
+	if(ReadPtr == Length){
+		Ready = 0;
+		Length = 0;
+		PromptPending = 1;
+	}
+	return length;
+}
+
+uint32_t LineEditor_t::GetNumberOfBytesReady(){
+	Process();
+	return Ready ? Length - ReadPtr : 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * tokenizer.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <tokenizer.h>
+
+//LineTokenizer_t
+/////////////////////////////////////////////////////////////////////
+
+void LineTokenizer_t::Clear(){
+	Length = 0;
+	LineLength = 0;
+	Scanned = 0;
+	Discarding = 0;
+	Argc = 0;
+}
+
+// One byte kept for terminator of line filling whole buffer
+char* LineTokenizer_t::GetFreeSpace(uint32_t* length){
+	*length = Size - 1 - Length;
+	return &Buffer[Length];
+}
+
+void LineTokenizer_t::Append(uint32_t length){
+	Length += length;
+}
+
+uint32_t LineTokenizer_t::Append(const char* data, uint32_t length){
+	uint32_t free;
+	char* space = GetFreeSpace(&free);
+	if(length > free)
+		length = free;
+	memcpy(space, data, length);
+	Append(length);
+	return length;
+}
+
+uint8_t LineTokenizer_t::NextLine(){
+	// Remove previous line, rest of input moved to buffer start
+	if(LineLength != 0){
+		Length -= LineLength;
+		memmove(Buffer, &Buffer[LineLength], Length);
+		Scanned = 0;
+		LineLength = 0;
+		Argc = 0;
+	}
+
+	while(Scanned < Length){
+		char c = Buffer[Scanned];
+		if((c != '\r') and (c != '\n')){
+			Scanned++;
+			continue;
+		}
+		uint32_t end = Scanned;
+		Scanned++;
+		if(Discarding or (end == 0)){
+			// End of dropped line or empty line
+			Discarding = 0;
+			Length -= Scanned;
+			memmove(Buffer, &Buffer[Scanned], Length);
+			Scanned = 0;
+			continue;
+		}
+		Buffer[end] = '\0';
+		LineLength = Scanned;
+		Stats.Lines++;
+		return retvOk;
+	}
+
+	if(Length == Size - 1){
+		// No line end in full buffer
+		if(Discarding == 0)
+			Stats.Overflows++;
+		Discarding = 1;
+		Length = 0;
+		Scanned = 0;
+		return retvOutOfMemory;
+	}
+	return retvEmpty;
+}
+
+uint8_t LineTokenizer_t::Tokenize(){
+	Argc = 0;
+	if(LineLength == 0)
+		return retvEmpty;
+	char* ptr = Buffer;
+	while(1){
+		while((*ptr == ' ') or (*ptr == '\t'))
+			*ptr++ = '\0';
+		if(*ptr == '\0')
+			return retvOk;
+		if(Argc == TOKENIZER_MAX_ARGS){
+			Stats.TooManyArgs++;
+			Argc = 0;
+			return retvOutOfMemory;
+		}
+		Argv[Argc++] = ptr;
+		while((*ptr != ' ') and (*ptr != '\t') and (*ptr != '\0'))
+			ptr++;
+	}
+}
@@ -10,5 +10,6 @@
 
 #define USE_SYSTICK_DELAY	0
 #define HSE_FREQ_HZ 		12000000
+#define USE_APA102 			0 // 1 - effects on APA102/SK9822 fixture at SPI2 instead of WS2812
 
 #endif /* BOARD_H_ */
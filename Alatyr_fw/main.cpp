@@ -7,15 +7,28 @@
 
 #include <stdint.h>
 #include <interface_F103.h>
+#include <cli.h>
+#include <command.h>
+#include <shell.h>
+#include <rpc.h>
 #include <rcc_F103.h>
 #include <gpio_F103.h>
 #include <tim_F103.h>
 #include <neopixel.h>
+#include <apa102.h>
+#include <clip.h>
+#include <clip_demo.h>
+#include <settings.h>
+#include <binlog.h>
+#include <jdy23.h>
+#include <linkbench.h>
+#include <cmdqueue.h>
 
 #include <stm32f1xx.h>
 
 #include <FreeRTOS.h>
 #include <task.h>
+#include <semphr.h>
 
 //RTOS tasks declarations and priorities
 /////////////////////////////////////////////////////////////////////
@@ -23,38 +36,127 @@
 
 #define UART_IRQ_PRIORITY configSTM_MAX_SYSCALL_INTERRUPT_PRIORITY
 #define DMA_IRQ_PRIORITY configSTM_MAX_SYSCALL_INTERRUPT_PRIORITY
+#define EXTI_IRQ_PRIORITY configSTM_MAX_SYSCALL_INTERRUPT_PRIORITY
+#define TIM_IRQ_PRIORITY configSTM_MAX_SYSCALL_INTERRUPT_PRIORITY
 
 TaskHandle_t NeopixelTaskHandle;
 void NeopixelTask(void *pvParametrs);
 
-TaskHandle_t BleTaskHandle;
-void BleTask(void *pvParametrs);
+TaskHandle_t ShellTaskHandle;
+void ShellTask(void *pvParametrs);
 
 TaskHandle_t ButtonTaskHandle;
 void ButtonTask(void *pvParametrs);
 
+Settings_t Settings;
+
 // Uart shell for debug
 Uart_t CmdUart; // UART1
 DmaChannel_t DmaCh4 = {.Channel = DMA1_Channel4, .Number = 4, .Irq = DMA1_Channel4_IRQn};
 uint8_t CmdTxBuffer[128];
-DmaTx_t CmdTxDma(&DmaCh4, CmdTxBuffer, 128);
-Cli_t CmdCli(&CmdTxDma, &CmdUart);
+TxDescriptor_t CmdTxQueue[8]; // Zero copy buffers
+DmaTx_t CmdTxDma(&DmaCh4, CmdTxBuffer, 128, CmdTxQueue, 8);
+#define CMD_TX_TIMEOUT 20 // ms, task waits for free space in log buffer
+#define CMD_TX_COALESCE 64 // bytes, smaller log output waits for more
+#define CMD_TX_DEADLINE 5 // ms, maximum delay of coalesced output
+// Log of tasks to debug UART, text or binary (decoded by Alatyr_tools/log_decoder.py)
+uint8_t BinaryLog = 0;
+#define SYS_LOG(text, ...) (BinaryLog ? (void)LOG_BIN(&CmdTxDma, text, ##__VA_ARGS__) : \
+		(void)CLI_PRINT(CmdCli, text, ##__VA_ARGS__))
+#define CMD_TX_WRITERS 3 // NPX, SHL and BTN tasks may wait at once
+SemaphoreHandle_t CmdTxSpace; // Counting, one give per waiting writer
+volatile uint32_t CmdTxWaiters;
+Cli<DmaTx_t, Uart_t> CmdCli(&CmdTxDma, &CmdUart); // Channels known at compile time
+// USART1 RX, in APA102 builds SPI2 TX takes it and debug UART stays output only
+DmaChannel_t DmaCh5 = {.Channel = DMA1_Channel5, .Number = 5, .Irq = DMA1_Channel5_IRQn};
+#if (USE_APA102 == 0)
+uint8_t CmdRxBuffer[128];
+DmaRx_t CmdRxDma(&DmaCh5, CmdRxBuffer, 128);
+LineEditor_t CmdEditor(&CmdRxDma, &CmdTxDma);
+Cli_t CmdShell(&CmdTxDma, &CmdEditor); // Own session, commands shared with BLE
+#endif
 
 // Bluetooth
 Uart_t BleUart; // UART2
 DmaChannel_t DmaCh7 = {.Channel = DMA1_Channel7, .Number = 7, .Irq = DMA1_Channel7_IRQn};
 uint8_t BleTxBuffer[128];
-DmaTx_t BleTxDma(&DmaCh7, BleTxBuffer, 128);
+TxDescriptor_t BleTxQueue[4];
+DmaTx_t BleTxDma(&DmaCh7, BleTxBuffer, 128, BleTxQueue, 4);
 DmaChannel_t DmaCh6 = {.Channel = DMA1_Channel6, .Number = 6, .Irq = DMA1_Channel6_IRQn};
 uint8_t BleRxBuffer[128];
 DmaRx_t BleRxDma(&DmaCh6, BleRxBuffer, 128);
-Cli_t BleCli(&BleTxDma, &BleRxDma);
+// Binary RPC next to text commands, opcode is index in RpcOps (Alatyr_tools/rpc_client.py)
+uint8_t PingRpc(const RpcArgs_t& args, RpcArgs_t& result);
+uint8_t StatusRpc(const RpcArgs_t& args, RpcArgs_t& result);
+uint8_t BrightnessRpc(const RpcArgs_t& args, RpcArgs_t& result);
+uint8_t ColorRpc(const RpcArgs_t& args, RpcArgs_t& result);
+uint8_t NpxPowerRpc(const RpcArgs_t& args, RpcArgs_t& result);
+uint8_t ClipRpc(const RpcArgs_t& args, RpcArgs_t& result);
+uint8_t SaveRpc(const RpcArgs_t& args, RpcArgs_t& result);
+const RpcOp_t RpcOps[] = {PingRpc, StatusRpc, BrightnessRpc, ColorRpc, NpxPowerRpc, ClipRpc, SaveRpc};
+RpcLink_t BleRpc(&BleRxDma, &BleTxDma, RpcOps, sizeof(RpcOps)/sizeof(RpcOps[0]));
+Cli_t BleCli(&BleTxDma, &BleRpc);
+// Commands of both sessions wait here, LED frames get ahead of long ones
+CommandQueue_t CommandQueue(configCPU_CLOCK_HZ/1000000);
+// Module configuration, AT answers arrive through BleCli (PA4 - PWRC)
+#define BLE_NAME "GenshinVision"
+#define BLE_MAX_BAUD 115200 // Link is raised up to it, lower rate is used if not reliable
+void BleSetBaud(uint32_t baud);
+Jdy23_t BleModule(&BleTxDma, BleSetBaud, PA4, &Settings.Ble, BLE_NAME, BLE_MAX_BAUD);
+// Time of last reception event and command latency statistics
+volatile uint32_t BleRxEventCycles;
+Histogram_t<16> BleLatencyUs;
+// Central connected (PA6 - STATUS), without it BLE input is not parsed and output is held
+Jdy23Link_t BleLink(PA6);
 
 // Neopixel
 #define NEOPIXEL_LENGTH 6
-DmaChannel_t DmaCh5 = {.Channel = DMA1_Channel5, .Number = 5, .Irq = DMA1_Channel5_IRQn};
-uint8_t NeopixelBuffer[24*NEOPIXEL_LENGTH];
-Neopixel_t LedStrip(TIM1, 1, &DmaCh5, NeopixelBuffer, NEOPIXEL_LENGTH);
+#define NEOPIXEL_CURRENT_BUDGET 200 // mA from 5V boost converter
+#define NEOPIXEL_BLACK_HOLD 2000 // ms of black strip before 5V boost is disabled
+#define NEOPIXEL_BOOST_SETTLE 5 // ms for 5V rail to settle after boost enable
+DmaChannel_t DmaCh2 = {.Channel = DMA1_Channel2, .Number = 2, .Irq = DMA1_Channel2_IRQn}; // TIM1 CC1
+uint8_t NeopixelBuffer[NPX_FRAME_SIZE(NEOPIXEL_LENGTH)];
+Neopixel_t LedStrip(TIM1, 1, &DmaCh2, NeopixelBuffer, NEOPIXEL_LENGTH);
+#if (USE_APA102 == 1)
+// APA102/SK9822 fixture on SPI2 (PB13 - SCK, PB15 - MOSI), SPI2 TX uses DMA channel 5.
+// Brightness is its global 5-bit level, effect is drawn at full level. Current
+// limiter and color calibration are WS2812 power model and Neopixel_t encoder,
+// their commands are not built and status reports no estimate.
+#define APA102_SPI_FREQUENCY 4000000
+uint8_t Apa102Buffer[APA102_BUFFER_SIZE(NEOPIXEL_LENGTH)];
+Apa102_t Apa102Strip(SPI2, &DmaCh5, Apa102Buffer, NEOPIXEL_LENGTH);
+iLedStrip_t* const EffectStrip = &Apa102Strip;
+NpxPowerGate_t NpxGate(EffectStrip, pwrClkSpi2, PB1, NEOPIXEL_BLACK_HOLD, NEOPIXEL_BOOST_SETTLE);
+#else
+iLedStrip_t* const EffectStrip = &LedStrip;
+NpxPowerGate_t NpxGate(EffectStrip, pwrClkTim1, PB1, NEOPIXEL_BLACK_HOLD, NEOPIXEL_BOOST_SETTLE);
+#endif
+// Precomputed clips in flash
+ClipPlayer_t ClipPlayer(EffectStrip);
+const uint8_t* const ClipTable[] = {ClipDemo};
+#define CLIP_TABLE_SIZE (sizeof(ClipTable)/sizeof(ClipTable[0]))
+
+// Debug UART starts at CMD_UART_BAUD, "uartbaud" and "autobaud" change it,
+// autobaud captures sync character on PB7 (USART1 RX) with TIM4 channel 2
+#define CMD_UART_BAUD 115200
+#define AUTOBAUD_TIMEOUT 10000 // ms
+AutoBaud_t CmdAutoBaud(TIM4, 2);
+uint32_t AutoBaudStartMs;
+
+// Serial link benchmark (Alatyr_tools/serial_bench.py), port 0 - debug UART, 1 - BLE UART
+#define LINKBENCH_TIME 2000 // ms per run
+void LinkBenchWait();
+LinkBench_t LinkBench(configCPU_CLOCK_HZ/1000000, LinkBenchWait);
+// Cycles spent in idle task, gap between idle hook calls longer than
+// IDLE_GAP_CYCLES means other task or long interrupt ran
+#define IDLE_GAP_CYCLES 2000
+volatile uint32_t IdleCycles;
+
+// Log stress test, TIM2 interrupt writes records together with BLE task
+#define LOG_STRESS_RATE 1000 // Hz
+#define LOG_STRESS_TIME 1000 // ms
+volatile uint32_t IsrLogWritten;
+volatile uint32_t IsrLogDropped;
 
 Button_t Button1(PA0, PullUp);
 Button_t Button2(PC13, PullUp);
@@ -66,92 +168,873 @@ extern "C" {
 	void DMA1_Channel7_IRQHandler(){
 		BleTxDma.IrqHandler();
 	}
+	void DMA1_Channel6_IRQHandler(){
+		BleRxDma.IrqHandler();
+	}
+	void USART2_IRQHandler(){
+		BleUart.IrqHandler();
+	}
+	void EXTI9_5_IRQHandler(){
+		BleLink.IrqHandler();
+	}
+	void TIM2_IRQHandler(){
+		TIM2->SR &= ~TIM_SR_UIF;
+		if(CLI_PRINT(CmdCli, "[ISR] %d\r\n", IsrLogWritten + IsrLogDropped) == retvOk)
+			IsrLogWritten++;
+		else
+			IsrLogDropped++;
+	}
+#if (USE_APA102 == 1)
 	void DMA1_Channel5_IRQHandler(){
+		Apa102Strip.IrqHandler();
+	}
+#else
+	void DMA1_Channel5_IRQHandler(){
+		CmdRxDma.IrqHandler();
+	}
+	void USART1_IRQHandler(){
+		CmdUart.IrqHandler();
+	}
+	void DMA1_Channel2_IRQHandler(){
 		LedStrip.IrqHandler();
 	}
+	void TIM4_IRQHandler(){
+		CmdAutoBaud.IrqHandler();
+	}
+#endif
 }
 
 //RTOS tasks
 /////////////////////////////////////////////////////////////////////
 #define NEOPIXEL_POLL 100
 uint8_t NpxBrigthness = 15;
+#define NPX_EFFECT_MAX_BRIGHTNESS 127
+uint8_t NpxSolid = 0; // Whole strip in NpxColor instead of effect
+uint32_t NpxColor; // GRB
+inline uint32_t GetTimeMs() {return xTaskGetTickCount()*portTICK_PERIOD_MS;}
+
+// Fixed frame rate, frame late by whole period is skipped instead of
+// rendering missed ones back to back
+void WaitNextFrame(TickType_t* lastWake, uint32_t periodMs){
+	vTaskDelayUntil(lastWake, pdMS_TO_TICKS(periodMs));
+	uint32_t lateMs = (xTaskGetTickCount() - *lastWake)*portTICK_PERIOD_MS;
+	CommandQueue.StartFrame(periodMs, lateMs);
+	if(lateMs >= periodMs)
+		*lastWake = xTaskGetTickCount();
+	if(CommandQueue.IsDeferred())
+		xTaskNotifyGive(ShellTaskHandle); // Slice for deferred command
+}
+
+// APA102 dims whole strip with LED brightness, effect keeps color resolution
+inline uint8_t GetEffectBrightness() {return (USE_APA102 == 1) ? NPX_EFFECT_MAX_BRIGHTNESS : NpxBrigthness;}
+
+void ApplyBrightness(){
+#if (USE_APA102 == 1)
+	uint32_t scale = 2*NpxBrigthness;
+	Apa102Strip.SetBrightness(scale < NPX_SCALE_MAX ? scale : NPX_SCALE_MAX);
+#endif
+}
+
 void NeopixelTask(void *pvParameters){
 	uint32_t counter = 0;
+	TickType_t lastWake = xTaskGetTickCount();
 	while(1){
+		if(ClipPlayer.IsPlaying()){
+			uint32_t settleMs = NpxGate.PrepareFrame(GetTimeMs(), 0);
+			if(settleMs){
+				vTaskDelay(pdMS_TO_TICKS(settleMs));
+				lastWake = xTaskGetTickCount(); // Power up is not deadline miss
+			}
+			if(NpxGate.IsPowered())
+				ClipPlayer.PlayNextFrame();
+			if(ClipPlayer.IsPlaying()){
+				WaitNextFrame(&lastWake, ClipPlayer.GetFramePeriodMs());
+				continue;
+			}
+		}
 		for(uint8_t i = 0; i < NEOPIXEL_LENGTH; i++)
-			LedStrip.WriteLedColor(i, MakeHexGrbColor((counter + i) & 255, NpxBrigthness));
-		LedStrip.Update();
+			EffectStrip->WriteLedColor(i, NpxSolid ? NpxColor : MakeHexGrbColor((counter + i) & 255, GetEffectBrightness()));
+		uint32_t settleMs = NpxGate.PrepareFrame(GetTimeMs(), EffectStrip->IsBlack());
+		if(settleMs){
+			vTaskDelay(pdMS_TO_TICKS(settleMs));
+			lastWake = xTaskGetTickCount();
+		}
+		if(NpxGate.IsPowered())
+			EffectStrip->Update();
 		counter++;
-		vTaskDelay(pdMS_TO_TICKS(NEOPIXEL_POLL));
+		WaitNextFrame(&lastWake, NEOPIXEL_POLL);
 	}
 }
 
-#define BLE_ANSWER_DELAY 100
-void SendCommandAndWaitAnswer(const char* command){
-	gpio::DeactivatePin(PA4);
-	BleCli.Printf("%s\r\n", command);
-	CmdCli.Printf("[BLE] %s\r\n", command);
-	vTaskDelay(pdMS_TO_TICKS(100));
-	CmdCli.Printf("%s\r\n",BleCli.ReadLine());
-	gpio::ActivatePin(PA4);
+#define SHELL_POLL_TIMEOUT 500
+
+// UART IDLE line or RX DMA half/full buffer - wake up shell task
+void ShellRxCallback(uint32_t events){
+	BaseType_t higherPriorityTaskWoken = pdFALSE;
+	if(ShellTaskHandle == NULL)
+		return; // Data received before task creation
+	vTaskNotifyGiveFromISR(ShellTaskHandle, &higherPriorityTaskWoken);
+	portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+void BleRxCallback(uint32_t events){
+	BleRxEventCycles = dwt::GetCycles();
+	ShellRxCallback(events);
 }
 
-uint8_t stringCompare(const char* str1, const char* str2){
-	uint32_t ptr = 0;
-	while((str1[ptr] != '\0') or (str2[ptr] != '\0')){
-		if(str1[ptr] != str2[ptr])
-			return 0;
-		ptr++;
+// Sync character measured or refused, shell task applies result
+void AutoBaudCallback(uint32_t baud){
+	ShellRxCallback(0);
+}
+
+// STATUS pin edge, shell task applies new state
+void BleLinkCallback(uint8_t connected){
+	ShellRxCallback(0);
+}
+
+// Module configuration is not gated, AT mode works without central
+void BleLinkGate(uint8_t connected){
+	uint32_t queued = BleTxDma.GetNumberOfBytesInBuffer();
+	BleTxDma.Hold(connected == 0);
+	if(connected)
+		SYS_LOG("[BLE] Connected, %d queued bytes sent\r\n", queued);
+	else{
+		CommandQueue.Remove(&BleCli);
+		BleCli.Clear(); // Partial line of closed session
+		SYS_LOG("[BLE] Disconnected\r\n");
 	}
-	return 1;
 }
 
-uint32_t stringToInt(const char* str1){
-	uint32_t ptr = 0;
-	uint32_t number = 0;
-	while(str1[ptr] != '\0'){
-		if((str1[ptr] >= '0') and (str1[ptr] <= '9')){
-			number = number*10 + (str1[ptr] - '0');
-			ptr++;
-		}else
-				return 0;
+// Buffered output and last byte left UART, e.g. before baud rate change.
+// retvTimeout - output held (BLE without central) or stuck
+#define TX_DONE_TIMEOUT 2000 // ms, full buffer and queued blocks at 9600 baud
+uint8_t WaitTxDone(DmaTx_t* dma, USART_TypeDef* usart){
+	uint32_t startMs = GetTimeMs();
+	while(dma->GetNumberOfBytesInBuffer() != 0){
+		if(GetTimeMs() - startMs > TX_DONE_TIMEOUT)
+			return retvTimeout;
+		vTaskDelay(pdMS_TO_TICKS(1));
 	}
-	return number;
+	while((usart->SR & USART_SR_TC) == 0)
+		if(GetTimeMs() - startMs > TX_DONE_TIMEOUT)
+			return retvTimeout;
+	return retvOk;
 }
 
-void BleTask(void *pvParameters){
-	char* text = NULL;
+// Last command leaves at old rate, called by module driver
+void BleSetBaud(uint32_t baud){
+	WaitTxDone(&BleTxDma, USART2);
+	uint32_t ahbClock = rcc::GetCurrentAHBClock(rcc::GetCurrentSystemClock());
+	BleUart.UpdateBaudrate(rcc::GetCurrentAPB1Clock(ahbClock), baud);
+}
 
-	SendCommandAndWaitAnswer("AT+VER");
-	SendCommandAndWaitAnswer("AT+MAC");
-	SendCommandAndWaitAnswer("AT+NAMEGenshinVision");
-	SendCommandAndWaitAnswer("AT+NAME");
+// AT answers go to module driver until configuration finished
+uint8_t BleConfigure(){
+	uint32_t nowMs = GetTimeMs();
+	char* line = BleCli.ReadLine();
+	while(line != NULL){
+		if(BleModule.ProcessLine(line, nowMs) != retvOk)
+			SYS_LOG("[BLE] %s\r\n", line);
+		line = BleCli.ReadLine();
+	}
+	if(BleModule.Poll(nowMs) != retvOk)
+		return BleModule.IsBusy() ? retvBusy : retvEmpty;
+
+	const Jdy23Info_t* info = BleModule.GetInfo();
+	if(BleModule.GetState() == jdyFailed)
+		SYS_LOG("[BLE] No answer from module\r\n");
+	else
+		SYS_LOG("[BLE] %s, MAC %s, name %s, ready %d ms, %d baud\r\n", info->Version, info->Mac, info->Name,
+				BleModule.GetReadyMs(), BleModule.GetBaud());
+	for(uint8_t i = 0; i < JDY23_RATE_COUNT; i++){
+		const Jdy23RateStats_t* stats = BleModule.GetRateStats(i);
+		if((stats->BytesPerSecond != 0) or (stats->Failed != 0))
+			SYS_LOG("[BLE] %d baud: %d B/s, failed %d\r\n", jdy23::Rates[i], stats->BytesPerSecond, stats->Failed);
+	}
+	if(BleModule.IsInfoChanged())
+		SYS_LOG("[BLE] Info cached: %d\r\n", settings::Save(&Settings));
+	return retvOk;
+}
+
+// Log writers block on full buffer, until scheduler starts output is dropped.
+// Freed space wakes every waiting writer, each checks for its own record.
+// Give left by writer which timed out only makes next wait check once more
+uint8_t CmdTxWait(uint32_t timeoutMs){
+	if((CmdTxSpace == NULL) or (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING))
+		return retvFail;
+	taskENTER_CRITICAL();
+	CmdTxWaiters++;
+	taskEXIT_CRITICAL();
+	BaseType_t taken = xSemaphoreTake(CmdTxSpace, pdMS_TO_TICKS(timeoutMs));
+	taskENTER_CRITICAL();
+	CmdTxWaiters--;
+	taskEXIT_CRITICAL();
+	return (taken == pdTRUE) ? retvOk : retvTimeout;
+}
+
+void CmdTxSpaceFreed(){
+	BaseType_t higherPriorityTaskWoken = pdFALSE;
+	if(CmdTxSpace == NULL)
+		return;
+	for(uint32_t i = 0; i < CmdTxWaiters; i++)
+		xSemaphoreGiveFromISR(CmdTxSpace, &higherPriorityTaskWoken);
+	portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+// Zero copy dump of flash to debug UART, called from DMA interrupt
+volatile uint32_t DumpDoneCycles;
+void DumpSentCallback(const uint8_t* data, void* context){
+	DumpDoneCycles = dwt::GetCycles();
+}
 
+//Commands
+/////////////////////////////////////////////////////////////////////
+void ResetCommand(Cli_t& cli, const CommandArgs_t& args){
+	NVIC_SystemReset();
+}
+
+void BrightnessCommand(Cli_t& cli, const CommandArgs_t& args){
+	NpxBrigthness = args.Arg[0].Int;
+	ApplyBrightness();
+	CLI_PRINT(cli, "Neopixel brihtness: %d\r\n", NpxBrigthness);
+}
+
+void ColorCommand(Cli_t& cli, const CommandArgs_t& args){
+	if(args.Count == 0){
+		NpxSolid = 0;
+		CLI_PRINT(cli, "Npx effect restored\r\n");
+		return;
+	}
+	uint32_t rgb = args.Arg[0].Unsigned;
+	NpxColor = RgbToGrb(rgb);
+	NpxSolid = 1;
+	CLI_PRINT(cli, "Npx color R %d G %d B %d\r\n", rgb >> 16, (rgb >> 8) & 0xFF, rgb & 0xFF);
+}
+
+void SleepCommand(Cli_t& cli, const CommandArgs_t& args){
+	power::EnableWakeup1();
+	power::EnterStandby();
+}
+
+void NpxPowerCommand(Cli_t& cli, const CommandArgs_t& args){
+	if(args.Arg[0].Int == 0){
+		CLI_PRINT(cli, "Npx power disabled\r\n");
+		NpxGate.SetForcedOff(1, GetTimeMs());
+	}else{
+		CLI_PRINT(cli, "Npx power automatic\r\n");
+		NpxGate.SetForcedOff(0, GetTimeMs());
+	}
+}
+
+void NpxGateCommand(Cli_t& cli, const CommandArgs_t& args){
+	uint32_t offTimeMs = NpxGate.GetOffTimeMs(GetTimeMs());
+	CLI_PRINT(cli, "Npx boost off %d of %d ms, %d power cycles, %d flush timeouts\r\n",
+			offTimeMs, GetTimeMs(), NpxGate.GetPowerCycles(), NpxGate.GetFlushTimeouts());
+	// Power model, not measured
+	CLI_PRINT(cli, "Npx idle saving est. %d uA, est. %d uAh total\r\n",
+			NpxGate.GetIdleSavingUa(), NpxGate.GetIdleSavingUa()*(offTimeMs/1000)/3600);
+}
+
+#if (USE_APA102 == 0)
+void NpxBudgetCommand(Cli_t& cli, const CommandArgs_t& args){
+	int32_t budget = args.Arg[0].Int;
+	if((budget < 0) or (budget > NPX_MAX_BUDGET_MA) or (LedStrip.SetCurrentBudget(budget) != retvOk)){
+		CLI_PRINT(cli, "npxbudget mA(%d..%d), 0 - no limit\r\n", LedStrip.GetMinBudgetMa(), NPX_MAX_BUDGET_MA);
+		return;
+	}
+	CLI_PRINT(cli, "Npx current budget: %d mA\r\n", budget);
+}
+
+void NpxCurrentCommand(Cli_t& cli, const CommandArgs_t& args){
+	CLI_PRINT(cli, "Npx current: %d uA, scale %d/256\r\n",
+			LedStrip.GetEstimatedCurrentUa(), LedStrip.GetLimitScale());
+}
+
+void NpxMatrixCommand(Cli_t& cli, const CommandArgs_t& args){
+	uint32_t index = args.Arg[0].Unsigned;
+	int32_t value = args.Arg[1].Int;
+	if((index >= 9) or (value < NPX_CAL_MIN) or (value > NPX_CAL_MAX)){
+		CLI_PRINT(cli, "npxmatrix index(0..8) value(%d..%d)\r\n", NPX_CAL_MIN, NPX_CAL_MAX);
+		return;
+	}
+	Settings.NpxCalibration.Matrix[index] = value;
+	LedStrip.SetCalibration(&Settings.NpxCalibration);
+	CLI_PRINT(cli, "Npx matrix[%d] = %d\r\n", index, value);
+}
+
+void NpxWhiteBalanceCommand(Cli_t& cli, const CommandArgs_t& args){
+	for(uint32_t i = 0; i < 3; i++)
+		if((args.Arg[i].Int < 0) or (args.Arg[i].Int > NPX_WB_MAX)){
+			CLI_PRINT(cli, "npxwb G R B, each 0..%d (%d = 1.0)\r\n", NPX_WB_MAX, NPX_CAL_ONE);
+			return;
+		}
+	for(uint32_t i = 0; i < 3; i++)
+		Settings.NpxCalibration.WhiteBalance[i] = args.Arg[i].Int;
+	LedStrip.SetCalibration(&Settings.NpxCalibration);
+	CLI_PRINT(cli, "Npx white balance G %d R %d B %d\r\n",
+			Settings.NpxCalibration.WhiteBalance[0], Settings.NpxCalibration.WhiteBalance[1],
+			Settings.NpxCalibration.WhiteBalance[2]);
+}
+
+void NpxCalibrationCommand(Cli_t& cli, const CommandArgs_t& args){
+	int16_t* m = Settings.NpxCalibration.Matrix;
+	for(uint32_t row = 0; row < 3; row++)
+		CLI_PRINT(cli, "%d %d %d\r\n", m[3*row], m[3*row + 1], m[3*row + 2]);
+}
+
+void NpxCalibrationResetCommand(Cli_t& cli, const CommandArgs_t& args){
+	Settings_t defaults;
+	settings::SetDefaults(&defaults);
+	Settings.NpxCalibration = defaults.NpxCalibration;
+	LedStrip.SetCalibration(&Settings.NpxCalibration);
+	CLI_PRINT(cli, "Npx calibration reset\r\n");
+}
+#endif
+
+void SaveCommand(Cli_t& cli, const CommandArgs_t& args){
+	CLI_PRINT(cli, "Settings save: %d\r\n", settings::Save(&Settings));
+}
+
+void LedBenchCommand(Cli_t& cli, const CommandArgs_t& args){
+	uint32_t cyclesPerUs = rcc::GetCurrentSystemClock()/1000000;
+	uint32_t frameUs = EffectStrip->GetFrameCycles()/cyclesPerUs;
+	// WS2812 - 24 bits of 1.25 us per LED and 50 us reset, not measured
+	uint32_t ws2812FrameUs = NEOPIXEL_LENGTH*30 + 50;
+	if(frameUs != 0)
+		CLI_PRINT(cli, "Strip frame %d us, %d fps (measured)\r\n", frameUs, 1000000/frameUs);
+	CLI_PRINT(cli, "WS2812 wire time %d us, %d fps (computed)\r\n", ws2812FrameUs, 1000000/ws2812FrameUs);
+}
+
+void LatencyCommand(Cli_t& cli, const CommandArgs_t& args){
+	CLI_PRINT(cli, "Command latency, us: count\r\n");
+	for(uint32_t i = 0; i < 16; i++)
+		if(BleLatencyUs.Get(i) != 0)
+			CLI_PRINT(cli, "<%d: %d\r\n", BleLatencyUs.GetBinLimit(i), BleLatencyUs.Get(i));
+}
+
+void RxStatsCommand(Cli_t& cli, const CommandArgs_t& args){
+	const DmaRxStats_t* dmaStats = BleRxDma.GetStats();
+	const UartStats_t* uartStats = BleUart.GetStats();
+	CLI_PRINT(cli, "BLE RX %d bytes, %d laps, high water %d\r\n",
+			dmaStats->Bytes, dmaStats->Laps, dmaStats->HighWater);
+	CLI_PRINT(cli, "Overruns %d (%d bytes lost)\r\n", dmaStats->Overruns, dmaStats->LostBytes);
+	CLI_PRINT(cli, "UART errors: overrun %d, framing %d, noise %d, parity %d\r\n",
+			uartStats->Overrun, uartStats->Framing, uartStats->Noise, uartStats->Parity);
+}
+
+// Reception events of both UARTs wake shell task
+void LinkBenchWait(){
+	ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1));
+}
+
+void LinkBenchCommand(Cli_t& cli, const CommandArgs_t& args){
+	static const char* const modes[] = {"tx", "rx", "echo"};
+	uint8_t mode = 0;
+	while((mode <= linkEcho) and (strcmp(args.Arg[1].String, modes[mode]) != 0))
+		mode++;
+	uint32_t ahbClock = rcc::GetCurrentAHBClock(rcc::GetCurrentSystemClock());
+	Uart_t* uart = &BleUart;
+	USART_TypeDef* usart = USART2;
+	DmaTx_t* tx = &BleTxDma;
+	DmaRx_t* rx = &BleRxDma;
+	uint32_t clock = rcc::GetCurrentAPB1Clock(ahbClock);
+#if (USE_APA102 == 1)
+	if(args.Arg[0].Unsigned == 0){
+		CLI_PRINT(cli, "Debug UART is output only\r\n");
+		return;
+	}
+#else
+	if(args.Arg[0].Unsigned == 0){
+		uart = &CmdUart;
+		usart = USART1;
+		tx = &CmdTxDma;
+		rx = &CmdRxDma;
+		clock = rcc::GetCurrentAPB2Clock(ahbClock);
+	}
+#endif
+	if((mode > linkEcho) or (args.Arg[0].Unsigned > 1) or (args.Arg[2].Unsigned > LINKBENCH_MAX_SIZE)){
+		CLI_PRINT(cli, "linkbench 0|1 tx|rx|echo size(1..%d) [baud]\r\n", LINKBENCH_MAX_SIZE);
+		return;
+	}
+	uint32_t linkBaud = uart->GetBaud();
+	uint32_t baud = (args.Count > 3) ? args.Arg[3].Unsigned : linkBaud;
+	if(uart::CheckBaud(clock, baud) != retvOk){
+		CLI_PRINT(cli, "LB fail baud=%d max=%d\r\n", baud, uart::GetMaxBaud(clock));
+		return;
+	}
+	// BLE output is held without central, nothing would leave
+	if((tx == &BleTxDma) and (BleTxDma.IsHeld() or !BleLink.IsConnected())){
+		CLI_PRINT(cli, "LB fail port=1 connected=0\r\n");
+		return;
+	}
+
+	CLI_PRINT(cli, "LB ready ms=%d\r\n", LINKBENCH_TIME);
+	vTaskDelay(pdMS_TO_TICKS(LINKBENCH_SETTLE_MS)); // Host switches baud rate
+	if(WaitTxDone(tx, usart) != retvOk){
+		CLI_PRINT(cli, "LB fail tx=stuck\r\n");
+		return;
+	}
+	if(baud != linkBaud)
+		uart->UpdateBaudrate(clock, baud);
+	UartStats_t uartStats = *uart->GetStats();
+	uint32_t overruns = rx->GetStats()->Overruns;
+	uint32_t idleCycles = IdleCycles;
+	uint32_t startCycles = dwt::GetCycles();
+
+	LinkBench.Run(tx, rx, mode, args.Arg[2].Unsigned, LINKBENCH_TIME);
+	uint32_t cpuLoad = 100 - (uint64_t)(IdleCycles - idleCycles)*100/(dwt::GetCycles() - startCycles);
+	WaitTxDone(tx, usart);
+	uint32_t dropped = LinkBench.Drain(rx);
+	if(baud != linkBaud)
+		uart->UpdateBaudrate(clock, linkBaud);
+
+	const UartStats_t* uartNow = uart->GetStats();
+	uint32_t uartErrors = (uartNow->Overrun - uartStats.Overrun) + (uartNow->Framing - uartStats.Framing)
+			+ (uartNow->Noise - uartStats.Noise) + (uartNow->Parity - uartStats.Parity);
+	const LinkBenchResult_t* result = LinkBench.GetResult();
+	CLI_PRINT(cli, "LB port=%d mode=%s size=%d baud=%d ppm=%d bytes=%d us=%d rate=%d cpu=%d\r\n",
+			args.Arg[0].Unsigned, modes[mode], args.Arg[2].Unsigned, baud, uart::GetErrorPpm(clock, baud),
+			result->Bytes, result->ElapsedUs, LinkBench.GetBytesPerSecond(), cpuLoad);
+	CLI_PRINT(cli, "LB errors=%d timeouts=%d uart=%d overruns=%d late=%d trips=%d p50=%d p99=%d max=%d\r\n",
+			result->Errors, result->Timeouts, uartErrors, rx->GetStats()->Overruns - overruns, dropped,
+			result->RoundTrips, result->LatencyP50Us, result->LatencyP99Us, result->LatencyMaxUs);
+}
+
+void BleInfoCommand(Cli_t& cli, const CommandArgs_t& args){
+	const Jdy23Info_t* info = BleModule.GetInfo();
+	CLI_PRINT(cli, "BLE state %d, ready %d ms, %d baud\r\n", BleModule.GetState(), BleModule.GetReadyMs(),
+			BleModule.GetBaud());
+	CLI_PRINT(cli, "Version %s, MAC %s, name %s\r\n", info->Version, info->Mac, info->Name);
+	CLI_PRINT(cli, "Connected %d, connects %d, disconnects %d\r\n", BleLink.IsConnected(),
+			BleLink.GetConnects(), BleLink.GetDisconnects());
+	for(uint8_t i = 0; i < JDY23_RATE_COUNT; i++){
+		const Jdy23RateStats_t* stats = BleModule.GetRateStats(i);
+		CLI_PRINT(cli, "%6d baud: %d B/s, verified %d, failed %d\r\n", jdy23::Rates[i],
+				stats->BytesPerSecond, stats->Verified, stats->Failed);
+	}
+}
+
+// Answer leaves at old rate
+void UartBaudCommand(Cli_t& cli, const CommandArgs_t& args){
+	uint32_t clock = rcc::GetCurrentAPB2Clock(rcc::GetCurrentAHBClock(rcc::GetCurrentSystemClock()));
+	uint32_t baud = args.Arg[0].Unsigned;
+	if(uart::CheckBaud(clock, baud) != retvOk){
+		if((baud != 0) and (baud <= uart::GetMaxBaud(clock)))
+			CLI_PRINT(cli, "Baud %d error %d ppm, limit %d ppm\r\n", baud, uart::GetErrorPpm(clock, baud),
+					UART_MAX_ERROR_PPM);
+		else
+			CLI_PRINT(cli, "Baud %d out of range, max %d\r\n", baud, uart::GetMaxBaud(clock));
+		return;
+	}
+	CLI_PRINT(cli, "Debug UART %d baud, BRR %d, error %d ppm\r\n", baud, uart::GetBrr(clock, baud),
+			uart::GetErrorPpm(clock, baud));
+	WaitTxDone(&CmdTxDma, USART1);
+	CmdUart.UpdateBaudrate(clock, baud);
+}
+
+// Shell task applies measured rate, see ApplyAutoBaud
+void AutoBaudCommand(Cli_t& cli, const CommandArgs_t& args){
+#if (USE_APA102 == 1)
+	CLI_PRINT(cli, "Debug UART is output only\r\n");
+#else
+	CLI_PRINT(cli, "Autobaud armed, send 'U' at new rate within %d ms\r\n", AUTOBAUD_TIMEOUT);
+	AutoBaudStartMs = GetTimeMs();
+	CmdAutoBaud.Start();
+#endif
+}
+
+void CommandStatsCommand(Cli_t& cli, const CommandArgs_t& args){
+	static const char* const priorities[] = {"urgent", "normal", "background"};
+	const CommandQueueStats_t* stats = CommandQueue.GetStats();
+	CLI_PRINT(cli, "Frames %d, late %d (by commands %d), skipped %d, max late %d ms\r\n", stats->Frames,
+			stats->Misses, stats->CommandMisses, stats->Skipped, stats->MaxLateMs);
+	CLI_PRINT(cli, "Deferred %d, budget %d%% of frame\r\n", stats->Deferred, CMDQ_BUDGET_PERCENT);
+	for(uint8_t i = 0; i < cmdPriorityCount; i++)
+		CLI_PRINT(cli, "%-10s %d runs, max %d us, estimate %d us\r\n", priorities[i], stats->Executed[i],
+				stats->MaxUs[i], CommandQueue.GetEstimateUs(i));
+	CommandQueue.ClearStats();
+}
+
+void CliBenchCommand(Cli_t& cli, const CommandArgs_t& args){
+	// Typical log line to debug UART, per byte virtual calls against block write
+	static const char line[] = "[NPX] frame 1234 us, current 187 mA, scale 256\r\n";
+	const uint32_t length = sizeof(line) - 1;
+	iWriter_t* tx = &CmdTxDma;
+	uint32_t cyclesPerUs = rcc::GetCurrentSystemClock()/1000000;
+	uint32_t startCycles = dwt::GetCycles();
+	for(uint32_t i = 0; i < length; i++)
+		tx->WriteChar(line[i]);
+	uint32_t charCycles = dwt::GetCycles() - startCycles;
+	tx->StartTransmission();
+	vTaskDelay(pdMS_TO_TICKS(10)); // Let DMA drain buffer
+	startCycles = dwt::GetCycles();
+	tx->Write((const uint8_t*)line, length);
+	uint32_t blockCycles = dwt::GetCycles() - startCycles;
+	tx->StartTransmission();
+	vTaskDelay(pdMS_TO_TICKS(10));
+	startCycles = dwt::GetCycles();
+	CmdCli.Printf("[NPX] frame %d us, current %d mA, scale %d\r\n", 1234, 187, 256);
+	uint32_t printfCycles = dwt::GetCycles() - startCycles;
+	vTaskDelay(pdMS_TO_TICKS(10));
+	// Format parsed at compile time
+	startCycles = dwt::GetCycles();
+	CLI_PRINT(CmdCli, "[NPX] frame %d us, current %d mA, scale %d\r\n", 1234, 187, 256);
+	uint32_t printCycles = dwt::GetCycles() - startCycles;
+	vTaskDelay(pdMS_TO_TICKS(10));
+	// Same line through virtual interfaces
+	Cli_t dynamicCli(&CmdTxDma, &CmdUart);
+	startCycles = dwt::GetCycles();
+	dynamicCli.Printf("[NPX] frame %d us, current %d mA, scale %d\r\n", 1234, 187, 256);
+	uint32_t dynamicCycles = dwt::GetCycles() - startCycles;
+	CLI_PRINT(cli, "%d bytes, cycles: per char %d, block %d\r\n", length, charCycles, blockCycles);
+	CLI_PRINT(cli, "Printf cycles: static %d, virtual %d\r\n", printfCycles, dynamicCycles);
+	CLI_PRINT(cli, "CLI_PRINT cycles: %d\r\n", printCycles);
+	CLI_PRINT(cli, "Bytes/us x100: per char %d, block %d\r\n",
+			length*100*cyclesPerUs/charCycles, length*100*cyclesPerUs/blockCycles);
+}
+
+void TokenizerBenchCommand(Cli_t& cli, const CommandArgs_t& args){
+	// Random traffic with long lines and runs of spaces, fed in chunks
+	static char traffic[512];
+	const uint32_t length = sizeof(traffic);
+	char buffer[COMMAND_BUFFER_SIZE];
+	LineTokenizer_t tokenizer(buffer, sizeof(buffer));
+	uint32_t seed = dwt::GetCycles();
+	for(uint32_t i = 0; i < length; i++){
+		seed = seed*1664525 + 1013904223;
+		uint32_t r = seed >> 24;
+		traffic[i] = r < 8 ? '\n' : (r < 48 ? ' ' : 'a' + r % 26);
+	}
+	uint32_t tokens = 0;
+	uint32_t startCycles = dwt::GetCycles();
+	for(uint32_t pos = 0; pos < length;){
+		uint32_t chunk = length - pos < 32 ? length - pos : 32;
+		pos += tokenizer.Append(&traffic[pos], chunk);
+		uint8_t retv;
+		while((retv = tokenizer.NextLine()) != retvEmpty){
+			if((retv == retvOk) and (tokenizer.Tokenize() == retvOk))
+				tokens += tokenizer.GetArgc();
+		}
+	}
+	uint32_t cycles = dwt::GetCycles() - startCycles;
+	const TokenizerStats_t* stats = tokenizer.GetStats();
+	CLI_PRINT(cli, "%d bytes, %d cycles, %.2f bytes/us\r\n", length, cycles,
+			length*100*(rcc::GetCurrentSystemClock()/1000000)/cycles);
+	CLI_PRINT(cli, "Lines %d, tokens %d, overflows %d, too many args %d\r\n",
+			stats->Lines, tokens, stats->Overflows, stats->TooManyArgs);
+}
+
+void RpcStatsCommand(Cli_t& cli, const CommandArgs_t& args){
+	const RpcStats_t* stats = BleRpc.GetStats();
+	CLI_PRINT(cli, "RPC packets %d, calls %d\r\n", stats->Packets, stats->Calls);
+	CLI_PRINT(cli, "CRC errors %d, frame errors %d, TX dropped %d\r\n",
+			stats->CrcErrors, stats->FrameErrors, stats->TxDropped);
+}
+
+void BinaryLogCommand(Cli_t& cli, const CommandArgs_t& args){
+	BinaryLog = args.Arg[0].Int != 0;
+	CLI_PRINT(cli, "Binary log %d\r\n", BinaryLog);
+}
+
+void LogBenchCommand(Cli_t& cli, const CommandArgs_t& args){
+	// Same record as text and as binary
+	const uint32_t textBytes = sizeof("[NPX] frame 1234 us, current 187 mA, scale 256\r\n") - 1;
+	uint32_t startCycles = dwt::GetCycles();
+	CLI_PRINT(CmdCli, "[NPX] frame %d us, current %d mA, scale %d\r\n", 1234, 187, 256);
+	uint32_t textCycles = dwt::GetCycles() - startCycles;
+	vTaskDelay(pdMS_TO_TICKS(10));
+	startCycles = dwt::GetCycles();
+	uint32_t binaryBytes = LOG_BIN(&CmdTxDma, "[NPX] frame %d us, current %d mA, scale %d\r\n", 1234, 187, 256);
+	uint32_t binaryCycles = dwt::GetCycles() - startCycles;
+	CLI_PRINT(cli, "Text %d bytes %d cycles\r\n", textBytes, textCycles);
+	CLI_PRINT(cli, "Binary %d bytes %d cycles\r\n", binaryBytes, binaryCycles);
+}
+
+void LogStressCommand(Cli_t& cli, const CommandArgs_t& args){
+	// Other tasks are blocked during test
+	uint32_t taskWritten = 0;
+	uint32_t taskDropped = 0;
+	IsrLogWritten = 0;
+	IsrLogDropped = 0;
+	rcc::EnableClkAPB1(RCC_APB1ENR_TIM2EN);
+	uint32_t apb1Clock = rcc::GetCurrentAPB1Clock(rcc::GetCurrentAHBClock(rcc::GetCurrentSystemClock()));
+	Timer_t stressTimer;
+	stressTimer.Init(TIM2, rcc::GetCurrentTimersClock(apb1Clock), 1000000, 1000000/LOG_STRESS_RATE - 1, UpCounter);
+	TIM2->DIER |= TIM_DIER_UIE;
+	nvic::SetupIrq(TIM2_IRQn, DMA_IRQ_PRIORITY);
+	stressTimer.StartCount();
+	uint32_t startMs = GetTimeMs();
+	while(GetTimeMs() - startMs < LOG_STRESS_TIME){
+		if(CLI_PRINT(CmdCli, "[TSK] record %d of log stress test\r\n", taskWritten + taskDropped) == retvOk)
+			taskWritten++;
+		else
+			taskDropped++;
+	}
+	stressTimer.StopCount();
+	TIM2->DIER &= ~TIM_DIER_UIE;
+	NVIC_DisableIRQ(TIM2_IRQn);
+	rcc::DisableClkAPB1(RCC_APB1ENR_TIM2EN);
+	CLI_PRINT(cli, "Task records %d, dropped %d\r\n", taskWritten, taskDropped);
+	CLI_PRINT(cli, "ISR records %d, dropped %d\r\n", IsrLogWritten, IsrLogDropped);
+	CLI_PRINT(cli, "Log bytes dropped %d, lines truncated %d\r\n", CmdTxDma.GetDroppedBytes(), CmdCli.GetTruncated());
+}
+
+void TxStatsCommand(Cli_t& cli, const CommandArgs_t& args){
+	const DmaTxStats_t* stats = CmdTxDma.GetStats();
+	if(stats->Bytes != 0)
+		CLI_PRINT(cli, "Log TX %d bytes, %d transfers, %d interrupts/KB\r\n",
+				stats->Bytes, stats->Transfers, stats->Transfers*1024/stats->Bytes);
+	CmdTxDma.ClearStats();
+}
+
+void TxCoalesceCommand(Cli_t& cli, const CommandArgs_t& args){
+	uint32_t threshold = args.Arg[0].Unsigned;
+	CmdTxDma.SetCoalescing(threshold, CMD_TX_DEADLINE);
+	CmdTxDma.ClearStats();
+	CLI_PRINT(cli, "Log coalescing threshold %d bytes\r\n", threshold);
+}
+
+void ClipDumpCommand(Cli_t& cli, const CommandArgs_t& args){
+	uint32_t clipNumber = args.Arg[0].Unsigned;
+	if(clipNumber < CLIP_TABLE_SIZE){
+		const ClipHeader_t* header = (const ClipHeader_t*)ClipTable[clipNumber];
+		uint32_t size = sizeof(ClipHeader_t) + header->DataSize;
+		DumpDoneCycles = 0;
+		uint32_t startCycles = dwt::GetCycles();
+		if(CmdTxDma.Send(ClipTable[clipNumber], size, DumpSentCallback, NULL) == retvOk){
+			CmdTxDma.StartTransmission();
+			// 115200 baud - about 11 bytes per ms
+			vTaskDelay(pdMS_TO_TICKS(size/11 + 10));
+			if(DumpDoneCycles != 0)
+				CLI_PRINT(cli, "Clip %d dumped, %d bytes in %d us\r\n", clipNumber, size,
+						(DumpDoneCycles - startCycles)/(rcc::GetCurrentSystemClock()/1000000));
+			else
+				CLI_PRINT(cli, "Clip %d dump in progress\r\n", clipNumber);
+		} else
+			CLI_PRINT(cli, "TX queue full\r\n");
+	}
+}
+
+void ClipCommand(Cli_t& cli, const CommandArgs_t& args){
+	// No argument - stop clip
+	uint32_t clipNumber = args.Count ? args.Arg[0].Unsigned : CLIP_TABLE_SIZE;
+	if(clipNumber >= CLIP_TABLE_SIZE){
+		ClipPlayer.Stop();
+		CLI_PRINT(cli, "Clip stopped\r\n");
+	}else if(ClipPlayer.Start(ClipTable[clipNumber]) == retvOk)
+		CLI_PRINT(cli, "Clip %d started\r\n", clipNumber);
+	else
+		CLI_PRINT(cli, "Clip %d is broken\r\n", clipNumber);
+}
+
+void ClipStatCommand(Cli_t& cli, const CommandArgs_t& args){
+	if(ClipPlayer.IsPlaying())
+		CLI_PRINT(cli, "Clip ratio x100: %d, decode cycles: %d (max %d)\r\n",
+				ClipPlayer.GetCompressionRatio(), ClipPlayer.GetLastDecodeCycles(),
+				ClipPlayer.GetMaxDecodeCycles());
+	else
+		CLI_PRINT(cli, "No clip playing\r\n");
+}
+
+void HelpCommand(Cli_t& cli, const CommandArgs_t& args);
+
+//Command table
+/////////////////////////////////////////////////////////////////////
+// Shared by all shells, arguments are described in command.h
+constexpr Command_t Commands[] = {
+	Command_t("help", HelpCommand, "", cmdBackground),
+	Command_t("reset", ResetCommand),
+	Command_t("brightness", BrightnessCommand, "d", cmdUrgent),
+	Command_t("color", ColorCommand, "[c", cmdUrgent),
+	Command_t("sleep", SleepCommand),
+	Command_t("npxpower", NpxPowerCommand, "d", cmdUrgent),
+	Command_t("npxgate", NpxGateCommand, "", cmdBackground),
+#if (USE_APA102 == 0)
+	Command_t("npxbudget", NpxBudgetCommand, "d"),
+	Command_t("npxcurrent", NpxCurrentCommand, "", cmdBackground),
+	Command_t("npxmatrix", NpxMatrixCommand, "dd"),
+	Command_t("npxwb", NpxWhiteBalanceCommand, "ddd"),
+	Command_t("npxcal", NpxCalibrationCommand),
+	Command_t("npxcalreset", NpxCalibrationResetCommand),
+#endif
+	Command_t("save", SaveCommand),
+	Command_t("ledbench", LedBenchCommand, "", cmdBackground),
+	Command_t("latency", LatencyCommand, "", cmdBackground),
+	Command_t("rxstats", RxStatsCommand, "", cmdBackground),
+	Command_t("bleinfo", BleInfoCommand, "", cmdBackground),
+	Command_t("linkbench", LinkBenchCommand, "dsd[d", cmdBackground),
+	Command_t("uartbaud", UartBaudCommand, "d"),
+	Command_t("autobaud", AutoBaudCommand),
+	Command_t("rpcstats", RpcStatsCommand, "", cmdBackground),
+	Command_t("clibench", CliBenchCommand, "", cmdBackground),
+	Command_t("tokbench", TokenizerBenchCommand, "", cmdBackground),
+	Command_t("binlog", BinaryLogCommand, "d"),
+	Command_t("logbench", LogBenchCommand, "", cmdBackground),
+	Command_t("logstress", LogStressCommand, "", cmdBackground),
+	Command_t("txstats", TxStatsCommand, "", cmdBackground),
+	Command_t("txcoalesce", TxCoalesceCommand, "d"),
+	Command_t("clipdump", ClipDumpCommand, "d", cmdBackground),
+	Command_t("clip", ClipCommand, "[d", cmdUrgent),
+	Command_t("clipstat", ClipStatCommand, "", cmdBackground),
+	Command_t("cmdstats", CommandStatsCommand, "", cmdBackground)
+};
+constexpr CommandTable_t<COMMAND_COUNT(Commands)> CommandTable(Commands);
+static_assert(CommandTable.IsUnique(), "Duplicate command name");
+
+void HelpCommand(Cli_t& cli, const CommandArgs_t& args){
+	for(uint32_t i = 0; i < CommandTable.GetCount(); i++)
+		CLI_PRINT(cli, "%s %s\r\n", CommandTable.Get(i).Name, CommandTable.Get(i).Args);
+}
+
+//RPC operations
+/////////////////////////////////////////////////////////////////////
+// Arguments
+uint8_t PingRpc(const RpcArgs_t& args, RpcArgs_t& result){
+	result = args;
+	return retvOk;
+}
+
+// Brightness, solid color on, color 0xRRGGBB, current uA, limit scale, clip playing, uptime ms
+uint8_t StatusRpc(const RpcArgs_t& args, RpcArgs_t& result){
+	result.Count = 7;
+	result.Arg[0] = NpxBrigthness;
+	result.Arg[1] = NpxSolid;
+	result.Arg[2] = RgbToGrb(NpxColor); // Swap of R and G works both ways
+#if (USE_APA102 == 1)
+	result.Arg[3] = 0; // No power model
+	result.Arg[4] = NPX_SCALE_MAX;
+#else
+	result.Arg[3] = LedStrip.GetEstimatedCurrentUa();
+	result.Arg[4] = LedStrip.GetLimitScale();
+#endif
+	result.Arg[5] = ClipPlayer.IsPlaying();
+	result.Arg[6] = GetTimeMs();
+	return retvOk;
+}
+
+// [brightness] - set, returns current
+uint8_t BrightnessRpc(const RpcArgs_t& args, RpcArgs_t& result){
+	if(args.Count > 0){
+		if(args.Arg[0] > 255)
+			return retvBadValue;
+		NpxBrigthness = args.Arg[0];
+		ApplyBrightness();
+	}
+	result.Count = 1;
+	result.Arg[0] = NpxBrigthness;
+	return retvOk;
+}
+
+// [0xRRGGBB] - solid color, no argument - effect
+uint8_t ColorRpc(const RpcArgs_t& args, RpcArgs_t& result){
+	if(args.Count == 0){
+		NpxSolid = 0;
+		return retvOk;
+	}
+	if(args.Arg[0] > 0xFFFFFF)
+		return retvBadValue;
+	NpxColor = RgbToGrb(args.Arg[0]);
+	NpxSolid = 1;
+	return retvOk;
+}
+
+// 0 - forced off, 1 - automatic
+uint8_t NpxPowerRpc(const RpcArgs_t& args, RpcArgs_t& result){
+	if(args.Count != 1)
+		return retvBadValue;
+	NpxGate.SetForcedOff(args.Arg[0] == 0, GetTimeMs());
+	return retvOk;
+}
+
+// [clip] - start, no argument - stop
+uint8_t ClipRpc(const RpcArgs_t& args, RpcArgs_t& result){
+	if(args.Count == 0){
+		ClipPlayer.Stop();
+		return retvOk;
+	}
+	if(args.Arg[0] >= CLIP_TABLE_SIZE)
+		return retvBadValue;
+	return ClipPlayer.Start(ClipTable[args.Arg[0]]);
+}
+
+uint8_t SaveRpc(const RpcArgs_t& args, RpcArgs_t& result){
+	return settings::Save(&Settings);
+}
+
+#if (USE_APA102 == 0)
+// Sync character received at unknown rate is garbage for UART, so shell
+// input is dropped with it. Other characters re-arm capture until timeout.
+void ApplyAutoBaud(){
+	uint8_t state = CmdAutoBaud.GetState();
+	if(state == autoBaudIdle)
+		return;
+	if(state == autoBaudDone){
+		CmdAutoBaud.ClearState();
+		uint32_t clock = rcc::GetCurrentAPB2Clock(rcc::GetCurrentAHBClock(rcc::GetCurrentSystemClock()));
+		uint32_t baud = CmdAutoBaud.GetBaud();
+		WaitTxDone(&CmdTxDma, USART1);
+		if(CmdUart.UpdateBaudrate(clock, baud) != retvOk){
+			CLI_PRINT(CmdShell, "Autobaud %d not reachable, %d kept\r\n", baud, CmdUart.GetBaud());
+			return;
+		}
+		LinkBench.Drain(&CmdRxDma); // Until line is quiet
+		CommandQueue.Remove(&CmdShell);
+		CmdShell.Clear();
+		CLI_PRINT(CmdShell, "Autobaud %d (measured %d), error %d ppm\r\n", baud,
+				CmdAutoBaud.GetMeasuredBaud(), CmdUart.GetErrorPpm());
+		return;
+	}
+	if(GetTimeMs() - AutoBaudStartMs > AUTOBAUD_TIMEOUT){
+		CmdAutoBaud.Cancel();
+		CLI_PRINT(CmdShell, "Autobaud timeout, %d kept\r\n", CmdUart.GetBaud());
+	} else if(state == autoBaudFailed)
+		CmdAutoBaud.Start();
+}
+#endif
+
+// Serves BLE and debug UART sessions, each with own input buffer, deferred
+// command is woken up by render task
+void ShellTask(void *pvParameters){
+	char* text = NULL;
+	uint8_t bleConnected = 1; // Output is not held until configuration finished
+
+	BleModule.Start(GetTimeMs());
 	while(1){
-		text = BleCli.Read();
-		if(text != NULL){
-			if(stringCompare(text, "reset"))
-				NVIC_SystemReset();
-			else if(stringCompare(text, "brightness")){
-				text = BleCli.Read();
-				NpxBrigthness = stringToInt(text);
-				BleCli.Printf("Neopixel brihtness: %d\r\n", NpxBrigthness);
-			}else if(stringCompare(text, "sleep")){
-				power::EnableWakeup1();
-				power::EnterStandby();
-			}else if(stringCompare(text, "npxpower")){
-				text = BleCli.Read();
-				if(stringToInt(text) == 0){
-					BleCli.Printf("Npx power disabled\r\n");
-					gpio::DeactivatePin(PB1);
-				}else{
-					BleCli.Printf("Npx power enabled\r\n");
-					gpio::ActivatePin(PB1);
-				}
-			}else
-				BleCli.Printf("Unknown command: %s\r\n", text);
+		uint8_t executed = 0;
+		uint32_t waitMs = SHELL_POLL_TIMEOUT;
+		if(BleModule.IsBusy()){
+			if(BleConfigure() == retvBusy){
+				uint32_t moduleWaitMs = BleModule.GetWaitMs(GetTimeMs());
+				if(moduleWaitMs < waitMs)
+					waitMs = moduleWaitMs + 1; // Retry right after timeout
+			} else
+				executed = 1; // Commands may wait in buffer
+		} else{
+			if(BleLink.IsConnected() != bleConnected){
+				bleConnected = BleLink.IsConnected();
+				BleLinkGate(bleConnected);
+			}
+			if(bleConnected and !CommandQueue.IsPosted(&BleCli) and ((text = BleCli.ReadCommand()) != NULL)){
+				BleLatencyUs.Add((dwt::GetCycles() - BleRxEventCycles)/(rcc::GetCurrentSystemClock()/1000000));
+				CommandQueue.Post(&BleCli, text, CommandTable.GetPriority(text));
+			}
+		}
+#if (USE_APA102 == 0)
+		ApplyAutoBaud();
+		if(!CommandQueue.IsPosted(&CmdShell) and ((text = CmdShell.ReadCommand()) != NULL))
+			CommandQueue.Post(&CmdShell, text, CommandTable.GetPriority(text));
+#endif
+		// One command per pass, render task may run in between
+		CommandJob_t job;
+		if(CommandQueue.Take(&job) == retvOk){
+			CommandTable.Execute(*job.Cli, job.Name);
+			CommandQueue.Done(&job);
+			executed = 1;
 		}
-		vTaskDelay(pdMS_TO_TICKS(500));
+		if(executed){
+			taskYIELD(); // Process rest of buffers after other tasks
+		}else // Wait for reception event
+			ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
 	}
 }
 
@@ -163,29 +1046,29 @@ void ButtonTask(void *pvParameters){
 
 		switch(button1){
 		case Pressed:
-			CmdCli.Printf("Button 1 pressed\n\r");
+			SYS_LOG("Button 1 pressed\n\r");
 			break;
 		case HoldDown:
-			CmdCli.Printf("Button 1 hold down\n\r");
+			SYS_LOG("Button 1 hold down\n\r");
 			break;
 		case Idle:
 			break;
 		case Released:
-			CmdCli.Printf("Button 1 released\n\r");
+			SYS_LOG("Button 1 released\n\r");
 			break;
 		}
 
 		switch(button2){
 		case Pressed:
-			CmdCli.Printf("Button 2 pressed\n\r");
+			SYS_LOG("Button 2 pressed\n\r");
 			break;
 		case HoldDown:
-			CmdCli.Printf("Button 2 hold down\n\r");
+			SYS_LOG("Button 2 hold down\n\r");
 			break;
 		case Idle:
 			break;
 		case Released:
-			CmdCli.Printf("Button 2 released\n\r");
+			SYS_LOG("Button 2 released\n\r");
 			break;
 		}
 
@@ -195,17 +1078,16 @@ void ButtonTask(void *pvParameters){
 
 int main(){
 	flash::SetFlashPrefetchAndLatency(1);
+	dwt::EnableCycleCounter();
 	rcc::EnableHSI8();
 	rcc::SetupPLL(pllSrcHsiDiv2, 8);
 	rcc::EnablePLL();
 	rcc::SwitchSysClk(sysClkPll);
 
-	//Enable peripheral clock
-	rcc::EnableClkAHB(RCC_AHBENR_DMA1EN);
-
+	//Enable peripheral clock, DMA1 and strip clocks are reference counted
+	//(power::RequestClock) by DMA channels and Neopixel power gate
 	rcc::EnableClkAPB1(RCC_APB1ENR_USART2EN);
 
-	rcc::EnableClkAPB2(RCC_APB2ENR_TIM1EN);
 	rcc::EnableClkAPB2(RCC_APB2ENR_AFIOEN);
 	rcc::EnableClkAPB2(RCC_APB2ENR_IOPAEN);
 	rcc::EnableClkAPB2(RCC_APB2ENR_IOPBEN);
@@ -221,14 +1103,28 @@ int main(){
 	gpio::Afio1Remap(AFIO_MAPR_USART1_REMAP);
 	gpio::SetupPin(PB6, AfOutput10MHzPushPull); // USART1 TX afer remap
 	gpio::SetupPin(PB7, InputWithPull, PullUp); // USART1 RX after remap
-	CmdUart.Init(USART1, currentApb2Clock, 115200);
+	CmdUart.Init(USART1, currentApb2Clock, CMD_UART_BAUD);
+#if (USE_APA102 == 0)
+	CmdUart.EnableDmaRequest(USART_CR3_DMAT|USART_CR3_DMAR);
+#else
 	CmdUart.EnableDmaRequest(USART_CR3_DMAT);
+#endif
 	CmdUart.Enable();
 
 	//USART1 DMA for command line
-	CmdTxDma.Init((uint32_t)&USART1->DR);
-//	DmaRxUart1.Init((uint32_t)&USART1->DR);
-//	DmaRxUart1.Start();
+	CmdTxDma.Init((uint32_t)&USART1->DR, DMA_IRQ_PRIORITY);
+	CmdTxSpace = xSemaphoreCreateCounting(CMD_TX_WRITERS, 0);
+	CmdTxDma.SetOverflowPolicy(txBlock, CMD_TX_TIMEOUT, CmdTxWait, CmdTxSpaceFreed);
+	CmdTxDma.SetCoalescing(CMD_TX_COALESCE, CMD_TX_DEADLINE);
+	binlog::SetTimeSource(GetTimeMs);
+#if (USE_APA102 == 0)
+	CmdRxDma.Init((uint32_t)&USART1->DR);
+	CmdRxDma.EnableIrq(DMA_IRQ_PRIORITY, ShellRxCallback);
+	CmdUart.EnableRxIrq(UART_IRQ_PRIORITY, ShellRxCallback);
+	CmdRxDma.Start();
+	rcc::EnableClkAPB1(RCC_APB1ENR_TIM4EN);
+	CmdAutoBaud.Init(rcc::GetCurrentTimersClock(currentApb1Clock), TIM_IRQ_PRIORITY, AutoBaudCallback);
+#endif
 
 	//USART2 for BLE
 	gpio::SetupPin(PA2, AfOutput10MHzPushPull); // USART2 TX
@@ -238,43 +1134,76 @@ int main(){
 	BleUart.Enable();
 
 	//DMA for BLE
-	BleTxDma.Init((uint32_t)&USART2->DR);
+	BleTxDma.Init((uint32_t)&USART2->DR, DMA_IRQ_PRIORITY);
 	BleRxDma.Init((uint32_t)&USART2->DR);
+	BleRxDma.EnableIrq(DMA_IRQ_PRIORITY, BleRxCallback);
+	BleUart.EnableRxIrq(UART_IRQ_PRIORITY, BleRxCallback);
 	BleRxDma.Start();
 
 	gpio::SetupPin(PA4, Output10MHzPushPull);
 	gpio::SetupPin(PA5, Output10MHzPushPull);
-	gpio::SetupPin(PA6, InputFloating);
+	BleLink.Subscribe(BleLinkCallback);
+	BleLink.Init(EXTI_IRQ_PRIORITY); // PA6 - STATUS
 	gpio::ActivatePin(PA4); // BLE PWRC
 	gpio::ActivatePin(PA5); // BLE RST
 
 	//Neopixel
-	gpio::SetupPin(PB1, Output10MHzPushPull);
-	gpio::ActivatePin(PB1); // 5V DC-DC enable
-	gpio::SetupPin(PA8, AfOutput10MHzPushPull); // TIM1 channel 1
+#if (USE_APA102 == 1)
+	NpxGate.AddDataPin(PB13, AfOutput50MHzPushPull); // SPI2 SCK
+	NpxGate.AddDataPin(PB15, AfOutput50MHzPushPull); // SPI2 MOSI
+#else
+	NpxGate.AddDataPin(PA8, AfOutput10MHzPushPull); // TIM1 channel 1
+#endif
+	NpxGate.Init(0); // 5V DC-DC enable, strip and DMA clocks, data pins
+#if (USE_APA102 == 1)
+	Apa102Strip.Init(currentApb1Clock, APA102_SPI_FREQUENCY, 0);
+	ApplyBrightness();
+#else
 	LedStrip.Init(rcc::GetCurrentTimersClock(currentApb2Clock), 0);
 	LedStrip.Clear();
+	LedStrip.SetCurrentBudget(NEOPIXEL_CURRENT_BUDGET);
+#endif
+	if(settings::Load(&Settings) != retvOk)
+		CLI_PRINT(CmdCli, "[SYS] Default settings\n\r");
+#if (USE_APA102 == 0)
+	LedStrip.SetCalibration(&Settings.NpxCalibration);
+#endif
 
 	// Buttons
 	Button1.Init();
 	Button2.Init();
 
-	CmdCli.Printf("[SYS] Clock %d\n\r",currentSystemClock);
+	CLI_PRINT(CmdCli, "[SYS] Clock %d\n\r",currentSystemClock);
+	CLI_PRINT(CmdCli, "[SYS] Debug UART %d baud, error %d ppm\n\r", CmdUart.GetBaud(), CmdUart.GetErrorPpm());
 
 	xTaskCreate(&NeopixelTask, "NPX", 512, NULL,
 			DEFAULT_TASK_PRIORITY, &NeopixelTaskHandle);
-	xTaskCreate(&BleTask, "BLE", 512, NULL,
-			DEFAULT_TASK_PRIORITY, &BleTaskHandle);
+	xTaskCreate(&ShellTask, "SHL", 512, NULL,
+			DEFAULT_TASK_PRIORITY, &ShellTaskHandle);
 	xTaskCreate(&ButtonTask, "BTN", 512, NULL,
 			DEFAULT_TASK_PRIORITY, &ButtonTaskHandle);
 
-	CmdCli.Printf("[SYS] Starting sheduler\n\r");
+	CLI_PRINT(CmdCli, "[SYS] Starting sheduler\n\r");
 	vTaskStartScheduler();
 	while(1);
 }
 
 //Main and FreeRTOS hooks
 /////////////////////////////////////////////////////////////////////
+// Deadline of coalesced log output
+void vApplicationTickHook(){
+	CmdTxDma.TickHandler();
+}
+
+// Not declared by task.h
+extern "C" void vApplicationIdleHook(){
+	static uint32_t lastCycles;
+	uint32_t cycles = dwt::GetCycles();
+	if(cycles - lastCycles < IDLE_GAP_CYCLES)
+		IdleCycles += cycles - lastCycles;
+	lastCycles = cycles;
+}
+
 void vApplicationMallocFailedHook(){
-	CmdCli.Printf("[ERR] Malloc failed\n\r");
+	CLI_PRINT(CmdCli, "[ERR] Malloc failed\n\r");
 }
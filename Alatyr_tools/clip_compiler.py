@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+"""
+Clip compiler - converts image sequence to on-flash clip for ClipPlayer_t
+(see Alatyr_fw/Inc/clip.h for format description).
+
+Every image is one frame, pixels are taken row by row as LEDs.
+PPM (P6) images are read without dependencies, other formats need Pillow.
+
+Example:
+    clip_compiler.py -n ClipDemo -p 50 -e auto -o ../Alatyr_fw/Inc/clip_demo.h frames/*.ppm
+"""
+
+import argparse
+import struct
+import sys
+
+CLIP_MAGIC = 0x50494C43
+ENCODINGS = {"rle": 0, "delta": 1, "raw": 2}
+# Must match neopixel.h
+NPX_HIGH = 5
+NPX_LOW = 2
+NPX_STOP = 0
+
+
+def read_ppm(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    tokens = []
+    pos = 0
+    # Header: magic, width, height, maxval separated by whitespace and comments
+    while len(tokens) < 4:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        if data[pos:pos + 1] == b"#":
+            while data[pos:pos + 1] not in (b"\n", b""):
+                pos += 1
+            continue
+        start = pos
+        while not data[pos:pos + 1].isspace():
+            pos += 1
+        tokens.append(data[start:pos])
+    if tokens[0] != b"P6" or int(tokens[3]) != 255:
+        raise ValueError("%s: only 8-bit binary PPM (P6) supported" % path)
+    width, height = int(tokens[1]), int(tokens[2])
+    pixels = data[pos + 1:pos + 1 + width * height * 3]
+    return [tuple(pixels[i:i + 3]) for i in range(0, len(pixels), 3)]
+
+
+def read_image(path):
+    if path.lower().endswith((".ppm", ".pnm")):
+        return read_ppm(path)
+    try:
+        from PIL import Image
+    except ImportError:
+        sys.exit("%s: Pillow is required for non-PPM images" % path)
+    return list(Image.open(path).convert("RGB").getdata())
+
+
+def to_grb(rgb):
+    return (rgb[1], rgb[0], rgb[2])
+
+
+def encode_rle(frames):
+    out = bytearray()
+    for frame in frames:
+        i = 0
+        while i < len(frame):
+            count = 1
+            while i + count < len(frame) and count < 255 and frame[i + count] == frame[i]:
+                count += 1
+            out += bytes((count,) + frame[i])
+            i += count
+    return out
+
+
+def encode_delta(frames):
+    out = bytearray()
+    previous = None
+    for frame in frames:
+        # First frame covers all LEDs, so clip can loop without clearing strip
+        changed = [previous is None or frame[i] != previous[i] for i in range(len(frame))]
+        i = 0
+        while i < len(frame):
+            skip = 0
+            while i < len(frame) and not changed[i] and skip < 255:
+                skip += 1
+                i += 1
+            count = 0
+            while i + count < len(frame) and changed[i + count] and count < 255:
+                count += 1
+            out += bytes((skip, count))
+            for led in frame[i:i + count]:
+                out += bytes(led)
+            i += count
+        previous = frame
+    return out
+
+
+def encode_raw(frames):
+    out = bytearray()
+    for frame in frames:
+        for led in frame:
+            for channel in led:
+                for bit in range(7, -1, -1):
+                    out.append(NPX_HIGH if channel & (1 << bit) else NPX_LOW)
+        out.append(NPX_STOP)
+    return out
+
+
+def make_header(frames, period, encoding, data):
+    return struct.pack("<IHHHBBI", CLIP_MAGIC, len(frames), len(frames[0]),
+                       period, ENCODINGS[encoding], 0, len(data))
+
+
+def write_source(path, name, blob):
+    lines = []
+    for i in range(0, len(blob), 16):
+        lines.append("\t" + ", ".join("0x%02X" % b for b in blob[i:i + 16]) + ",")
+    guard = name.upper() + "_H_"
+    with open(path, "w") as f:
+        f.write("/*\n * Generated by Alatyr_tools/clip_compiler.py, do not edit\n */\n\n")
+        f.write("#ifndef %s\n#define %s\n\n#include <clip.h>\n\n" % (guard, guard))
+        f.write("const uint8_t %s[%d] CLIP_SECTION = {\n" % (name, len(blob)))
+        f.write("\n".join(lines))
+        f.write("\n};\n\n#endif /* %s */\n" % guard)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("images", nargs="+", help="frames in playback order")
+    parser.add_argument("-n", "--name", default="Clip", help="C array name")
+    parser.add_argument("-p", "--period", type=int, default=50, help="frame period, ms")
+    parser.add_argument("-e", "--encoding", default="auto",
+                        choices=["auto"] + list(ENCODINGS), help="frame encoding")
+    parser.add_argument("-l", "--leds", type=int, help="use only first N pixels of image")
+    parser.add_argument("-o", "--output", help="output header, default <name>.h")
+    args = parser.parse_args()
+
+    frames = []
+    for path in args.images:
+        pixels = read_image(path)
+        if args.leds:
+            pixels = pixels[:args.leds]
+        frames.append([to_grb(p) for p in pixels])
+    if any(len(f) != len(frames[0]) for f in frames):
+        sys.exit("All frames must have the same number of pixels")
+
+    encoders = {"rle": encode_rle, "delta": encode_delta, "raw": encode_raw}
+    if args.encoding == "auto":
+        candidates = {e: encoders[e](frames) for e in ("rle", "delta")}
+        encoding = min(candidates, key=lambda e: len(candidates[e]))
+        data = candidates[encoding]
+    else:
+        encoding = args.encoding
+        data = encoders[encoding](frames)
+
+    blob = make_header(frames, args.period, encoding, data) + data
+    write_source(args.output or args.name.lower() + ".h", args.name, blob)
+
+    raw_size = len(frames) * len(frames[0]) * 3
+    print("%s: %d frames x %d LEDs, %s, %d bytes (raw GRB %d bytes, ratio %.2f)" % (
+        args.name, len(frames), len(frames[0]), encoding, len(blob), raw_size,
+        raw_size / len(data)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,137 @@
+/*
+ * binlog_records.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <stdio.h>
+#include <string>
+//
+#include <binlog.h>
+
+//Binary log records for log_decoder.py test
+/////////////////////////////////////////////////////////////////////
+/*
+* Records are built by binlog::Log as on target and written with plain
+* text between them, as debug UART carries both. Format strings get
+* offsets in host string table instead of ".logstr" addresses, so decoder
+* is used with base 0. Expected text of each record is written by hand.
+*
+* binlog_records <dir> writes logstr.bin, capture.bin and expected.txt,
+* test_log_decoder.py runs it.
+*/
+
+#define TEST_LOG(text, ...) binlog::Log(&Capture, []{ \
+	struct Format_t{ \
+		static constexpr const char* Get() {return text;} \
+		static uint32_t Id() {static const uint32_t id = AddString(text); return id;} \
+	}; return Format_t{}; }(), ##__VA_ARGS__)
+
+static std::string LogStrings;
+static std::string Expected;
+static uint32_t TimeMs = 0;
+
+static uint32_t AddString(const char* text){
+	uint32_t offset = LogStrings.size();
+	LogStrings.append(text);
+	LogStrings.push_back('\0');
+	return offset;
+}
+
+static uint32_t GetTimeMs(){
+	return TimeMs;
+}
+
+class Capture_t{
+public:
+	std::string Data;
+	uint32_t Write(const uint8_t* data, uint32_t length){
+		Data.append((const char*)data, length);
+		return length;
+	}
+	uint8_t StartTransmission() {return retvOk;}
+	void Text(const char* text){
+		Data.append(text);
+		Expected.append(text);
+	}
+} Capture;
+
+// Time prefix printed by decoder, each record one second later
+static void Expect(const std::string& text){
+	char prefix[16];
+	snprintf(prefix, sizeof(prefix), "[%6u.%03u] ", TimeMs/1000, TimeMs%1000);
+	Expected += prefix + text;
+	TimeMs += 1000;
+}
+
+static uint8_t WriteFile(const std::string& dir, const char* name, const std::string& data){
+	FILE* file = fopen((dir + "/" + name).c_str(), "wb");
+	if(file == NULL)
+		return retvFail;
+	uint8_t result = (fwrite(data.data(), 1, data.size(), file) == data.size()) ? retvOk : retvWriteError;
+	fclose(file);
+	return result;
+}
+
+int main(int argc, char* argv[]){
+	if(argc != 2){
+		fprintf(stderr, "usage: %s <output dir>\n", argv[0]);
+		return 2;
+	}
+	binlog::SetTimeSource(GetTimeMs);
+	TimeMs = 1234;
+
+	Capture.Text("Boot text\r\n");
+
+	// Integers
+	TEST_LOG("[NPX] frame %d us\r\n", 1234);
+	Expect("[NPX] frame 1234 us\r\n");
+	TEST_LOG("%d %u %x %b\r\n", -5, 4000000000U, 0xBEEFU, 5U);
+	Expect("-5 4000000000 0xBEEF 0b101\r\n");
+	TEST_LOG("[%5d|%-5d|%05d|%04x]\r\n", 42, -42, -42, 0xAU);
+	Expect("[   42|-42  |-0042|0x0A]\r\n");
+	TEST_LOG("%c%c 100%%\r\n", 'o', 'k');
+	Expect("ok 100%\r\n");
+
+	// Fixed point, float scaled and rounded on target
+	TEST_LOG("%.2f V %.1f C %.3f\r\n", 3.14159f, -2.25f, 1234);
+	Expect("3.14 V -2.3 C 1.234\r\n");
+
+	// Strings and hex dumps
+	static const uint8_t bytes[] = {0x01, 0xAB, 0xFF};
+	TEST_LOG("name=%s [%-8s] [%6s]\r\n", "alatyr", "abc", "xy");
+	Expect("name=alatyr [abc     ] [    xy]\r\n");
+	TEST_LOG("dump %h, empty '%s'\r\n", format::HexDump(bytes, sizeof(bytes)), "");
+	Expect("dump 01 AB FF, empty ''\r\n");
+
+	Capture.Text("Text between records\r\n");
+
+	// Cut records. Header takes 8 bytes, string keeps length byte.
+	// String cut to rest of record, next argument doesn't fit.
+	std::string longText(70, 'L');
+	TEST_LOG("%s end %d\r\n", longText.c_str(), 7);
+	Expect(std::string(BINLOG_RECORD_SIZE - BINLOG_HEADER_SIZE - 1, 'L') + " end <cut>");
+	Capture.Text("\r\n");
+
+	// Ten words leave 16 bytes, hex dump keeps 15 of 20
+	uint8_t ramp[20];
+	for(uint32_t i = 0; i < sizeof(ramp); i++)
+		ramp[i] = i;
+	TEST_LOG("%d%d%d%d%d%d%d%d%d%d %h\r\n", 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, format::HexDump(ramp, sizeof(ramp)));
+	Expect("0123456789 00 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E\r\n");
+
+	// Fourteen words fill record, no room for length byte of string
+	TEST_LOG("%d%d%d%d%d%d%d%d%d%d%d%d%d%d full %s\r\n",
+			0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, "lost");
+	Expect("01234567890123 full <cut>");
+	Capture.Text("\r\nDone\r\n");
+
+	if((WriteFile(argv[1], "logstr.bin", LogStrings) != retvOk) or
+			(WriteFile(argv[1], "capture.bin", Capture.Data) != retvOk) or
+			(WriteFile(argv[1], "expected.txt", Expected) != retvOk)){
+		fprintf(stderr, "can't write to %s\n", argv[1]);
+		return 1;
+	}
+	return 0;
+}
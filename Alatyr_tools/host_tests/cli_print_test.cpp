@@ -0,0 +1,113 @@
+/*
+ * cli_print_test.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+//
+#include <cli.h>
+
+//Cli output test
+/////////////////////////////////////////////////////////////////////
+/*
+* Each Print/Printf call must reach channel as one Write() record with
+* expected text, output longer than CLI_LINE_SIZE is cut to one record
+* ending with line end and counted.
+*/
+
+class Capture_t{
+public:
+	std::vector<std::string> Records;
+	uint32_t Free = UINT32_MAX; // Bytes accepted before channel is full
+	uint32_t Write(const uint8_t* data, uint32_t length){
+		if(length > Free)
+			return 0;
+		Free -= length;
+		Records.push_back(std::string((const char*)data, length));
+		return length;
+	}
+	uint8_t StartTransmission() {return retvOk;}
+};
+
+class NoInput_t{
+public:
+	uint32_t Read(uint8_t* data, uint32_t length) {return 0;}
+};
+
+static Capture_t Capture;
+static NoInput_t NoInput;
+static Cli<Capture_t, NoInput_t> TestCli(&Capture, &NoInput);
+static uint32_t Failures = 0;
+
+static void Expect(const char* name, uint8_t retv, uint8_t expectedRetv, const std::string& expected){
+	if((retv != expectedRetv) or (Capture.Records.size() != 1) or (Capture.Records[0] != expected)){
+		printf("FAIL %s: retv %u/%u, %zu records\n", name, retv, expectedRetv, Capture.Records.size());
+		for(const std::string& record: Capture.Records)
+			printf("  \"%s\"\n", record.c_str());
+		printf("  expected \"%s\"\n", expected.c_str());
+		Failures++;
+	}
+	Capture.Records.clear();
+}
+
+int main(){
+	// Formatting
+	Expect("integers", CLI_PRINT(TestCli, "%d %u %x %b %c|\r\n", -5, 4000000000U, 0xBEEFU, 5U, 'k'), retvOk,
+			"-5 4000000000 0xBEEF 0b101 k|\r\n");
+	Expect("padding", CLI_PRINT(TestCli, "[%5d|%-5d|%05d|%04x|%%]\r\n", 42, -42, -42, 0xAU), retvOk,
+			"[   42|-42  |-0042|0x0A|%]\r\n");
+	Expect("fixed point", CLI_PRINT(TestCli, "%.2f %.1f %.3f %.0f\r\n", 3.14159f, -2.25f, 1234, 7), retvOk,
+			"3.14 -2.3 1.234 7\r\n");
+	static const uint8_t bytes[] = {0x01, 0xAB, 0xFF};
+	Expect("strings", CLI_PRINT(TestCli, "[%-6s][%4s] %h\r\n", "ab", "xy", format::HexDump(bytes, 3)), retvOk,
+			"[ab    ][  xy] 01 AB FF\r\n");
+	Expect("printf", TestCli.Printf("%d %u %s %c %x %b %q\r\n", -7, 7, "str", 'c', 255, 2), retvOk,
+			"-7 7 str c 0xFF 0b10 %q\r\n");
+
+	// Longest line fits exactly
+	std::string full(CLI_LINE_SIZE - 2, 'F');
+	Expect("full line", CLI_PRINT(TestCli, "%s\r\n", full.c_str()), retvOk, full + "\r\n");
+	if(TestCli.GetTruncated() != 0){
+		printf("FAIL line of CLI_LINE_SIZE counted as truncated\n");
+		Failures++;
+	}
+
+	// Longer output is one cut record
+	std::string longText(3*CLI_LINE_SIZE, 'L');
+	std::string cut = std::string(CLI_LINE_SIZE - 2, 'L') + "\r\n";
+	Expect("long string", CLI_PRINT(TestCli, "%s\r\n", longText.c_str()), retvOverflow, cut);
+	Expect("long literal", CLI_PRINT(TestCli, "%s tail %d\r\n", full.c_str(), 1), retvOverflow,
+			full.substr(0, CLI_LINE_SIZE - 2) + "\r\n");
+	Expect("long printf", TestCli.Printf("%s%d\r\n", longText.c_str(), 5), retvOverflow, cut);
+	uint8_t ramp[CLI_LINE_SIZE];
+	for(uint32_t i = 0; i < sizeof(ramp); i++)
+		ramp[i] = i;
+	std::string hex = "dump";
+	for(uint32_t i = 0; hex.size() < CLI_LINE_SIZE - 2; i++){
+		static const char digits[] = "0123456789ABCDEF";
+		hex += (i%3 == 0) ? ' ' : digits[((i%3 == 1) ? ramp[i/3] >> 4 : ramp[i/3] & 0xF)];
+	}
+	Expect("long hex dump", CLI_PRINT(TestCli, "dump %h\r\n", format::HexDump(ramp, sizeof(ramp))), retvOverflow,
+			hex + "\r\n");
+	if(TestCli.GetTruncated() != 4){
+		printf("FAIL %u lines counted as truncated, expected 4\n", TestCli.GetTruncated());
+		Failures++;
+	}
+
+	// Full channel drops whole record
+	Capture.Free = 4;
+	uint8_t retv = CLI_PRINT(TestCli, "dropped %d\r\n", 1);
+	if((retv != retvOutOfMemory) or !Capture.Records.empty()){
+		printf("FAIL dropped output: retv %u, %zu records\n", retv, Capture.Records.size());
+		Failures++;
+	}
+
+	if(Failures != 0)
+		return 1;
+	printf("cli print: ok\n");
+	return 0;
+}
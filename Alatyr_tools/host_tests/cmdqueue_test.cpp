@@ -0,0 +1,150 @@
+/*
+ * cmdqueue_test.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <stdio.h>
+//
+#include <cmdqueue.h>
+
+//CommandQueue_t scheduler test
+/////////////////////////////////////////////////////////////////////
+/*
+* Time is host DWT cycle counter, moved by test, so command run times and
+* frame lateness are exact. Counter starts next to wrap. Covers priority
+* order, deferral by frame slice and by next frame deadline, miss
+* accounting and lateness longer than cycle counter range.
+*/
+
+#define CYCLES_PER_US 	72
+#define PERIOD_MS 		20 // Slice is CMDQ_BUDGET_PERCENT of it, 5000 us
+
+static Cli_t SessionA(NULL, NULL);
+static Cli_t SessionB(NULL, NULL);
+static Cli_t SessionC(NULL, NULL);
+static uint32_t Failures = 0;
+
+static void Check(const char* name, bool passed){
+	if(!passed){
+		printf("FAIL %s\n", name);
+		Failures++;
+	}
+}
+
+static void AdvanceUs(uint32_t us) {host::Dwt.CYCCNT += us*CYCLES_PER_US;}
+
+// Takes job of expected session and runs it for given time
+static void Run(CommandQueue_t& queue, const char* name, Cli_t* expected, uint32_t us){
+	CommandJob_t job;
+	if((queue.Take(&job) != retvOk) or (job.Cli != expected)){
+		Check(name, false);
+		return;
+	}
+	AdvanceUs(us);
+	queue.Done(&job);
+}
+
+static void Order(){
+	CommandQueue_t queue(CYCLES_PER_US);
+	CommandJob_t job;
+	Check("empty queue", queue.Take(&job) == retvEmpty);
+	Check("post", queue.Post(&SessionA, "a", cmdBackground) == retvOk);
+	Check("post twice", queue.Post(&SessionA, "a", cmdUrgent) == retvBusy);
+	Check("post", queue.Post(&SessionB, "b", cmdNormal) == retvOk);
+	Check("no free slot", queue.Post(&SessionC, "c", cmdUrgent) == retvOverflow);
+	Run(queue, "normal before background", &SessionB, 10);
+	Run(queue, "background", &SessionA, 10);
+	queue.Post(&SessionA, "a", cmdNormal);
+	queue.Post(&SessionB, "b", cmdNormal);
+	Run(queue, "same priority in order of arrival", &SessionA, 10);
+	queue.Post(&SessionA, "a", cmdNormal);
+	Run(queue, "same priority in order of arrival", &SessionB, 10);
+	queue.Remove(&SessionA);
+	Check("removed", queue.Take(&job) == retvEmpty);
+}
+
+static void Deferral(){
+	CommandQueue_t queue(CYCLES_PER_US);
+	CommandJob_t job;
+	queue.StartFrame(PERIOD_MS, 0);
+	queue.Post(&SessionA, "a", cmdBackground);
+	Run(queue, "first run", &SessionA, 4000);
+	Check("estimate", queue.GetEstimateUs(cmdBackground) == 4000);
+
+	// 4000 us used, another 4000 us doesn't fit slice
+	queue.Post(&SessionA, "a", cmdBackground);
+	Check("over slice deferred", queue.Take(&job) == retvBusy);
+	Check("deferred flag", queue.IsDeferred() and (queue.GetStats()->Deferred == 1));
+	queue.Post(&SessionB, "b", cmdUrgent);
+	Run(queue, "urgent never deferred", &SessionB, 4000);
+	Check("still deferred", queue.Take(&job) == retvBusy);
+
+	// Deferred command runs in next frame
+	queue.StartFrame(PERIOD_MS, 0);
+	Run(queue, "deferred runs next frame", &SessionA, 4000);
+	Check("not deferred", !queue.IsDeferred());
+
+	// Slice is free, but command would delay next frame
+	queue.StartFrame(PERIOD_MS, 0);
+	AdvanceUs(17000);
+	queue.Post(&SessionA, "a", cmdBackground);
+	Check("next frame deadline", queue.Take(&job) == retvBusy);
+	queue.StartFrame(PERIOD_MS, 0);
+	Run(queue, "deferred runs next frame", &SessionA, 100);
+
+	// Estimate is peak of recent runs, decays by 1/8 per run
+	for(uint32_t i = 0; i < 30; i++){
+		queue.StartFrame(PERIOD_MS, 0);
+		queue.Post(&SessionA, "a", cmdBackground);
+		Run(queue, "short runs", &SessionA, 100);
+	}
+	Check("estimate decays", queue.GetEstimateUs(cmdBackground) < 200);
+	Check("max", queue.GetStats()->MaxUs[cmdBackground] == 4000);
+	Check("executed", queue.GetStats()->Executed[cmdBackground] == 33);
+}
+
+static void Misses(){
+	CommandQueue_t queue(CYCLES_PER_US);
+	queue.StartFrame(PERIOD_MS, 0);
+	queue.Post(&SessionA, "a", cmdNormal);
+	Run(queue, "run", &SessionA, 1000);
+	AdvanceUs(4000);
+
+	// Frame due 5 ms ago, command finished 4 ms ago
+	queue.StartFrame(PERIOD_MS, 5);
+	const CommandQueueStats_t* stats = queue.GetStats();
+	Check("command miss", (stats->Misses == 1) and (stats->CommandMisses == 1));
+	AdvanceUs(10000);
+	queue.StartFrame(PERIOD_MS, 3);
+	Check("miss without command", (stats->Misses == 2) and (stats->CommandMisses == 1));
+	queue.StartFrame(PERIOD_MS, CMDQ_MISS_MS);
+	Check("late within limit", stats->Misses == 2);
+	queue.StartFrame(PERIOD_MS, 45);
+	Check("skipped frames", (stats->Skipped == 2) and (stats->MaxLateMs == 45));
+	Check("frames", stats->Frames == 5);
+
+	// Command finished 1 s ago, frame due 60 s ago. Lateness in cycles is
+	// beyond 32 bit, capped to counter range, not wrapped to 0.35 s
+	queue.ClearStats();
+	queue.Post(&SessionA, "a", cmdNormal);
+	Run(queue, "run", &SessionA, 1000);
+	AdvanceUs(1000000);
+	queue.StartFrame(PERIOD_MS, 60000);
+	Check("long stall command miss", stats->CommandMisses == 1);
+	queue.StartFrame(PERIOD_MS, UINT32_MAX);
+	Check("longest stall", (stats->Misses == 2) and (stats->CommandMisses == 2) and
+			(stats->MaxLateMs == UINT32_MAX));
+}
+
+int main(){
+	host::Dwt.CYCCNT = UINT32_MAX - 1000*CYCLES_PER_US; // Wraps during tests
+	Order();
+	Deferral();
+	Misses();
+	if(Failures != 0)
+		return 1;
+	printf("cmdqueue: ok\n");
+	return 0;
+}
@@ -0,0 +1,183 @@
+/*
+ * dmatx_stress.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+//
+#include <interface_F103.h>
+
+//DmaTx_t ring stress test
+/////////////////////////////////////////////////////////////////////
+/*
+* Writer threads put numbered records into small ring with Write(), which
+* reserves and commits with exclusive access, and retry records dropped
+* on full ring. Simulated DMA copies each started transfer out of the ring
+* and then fills sent bytes with poison before transfer complete
+* interrupt frees them. Sent stream must hold every record of every
+* writer whole and in order. Interleaved records, data sent before commit
+* or sent twice break record framing or checksum.
+*
+* Threads are switched at random around exclusive accesses, so writer is
+* often preempted between reservation and commit.
+*
+* dmatx_stress [writers] [records per writer] [seed]
+*/
+
+#define RING_SIZE 		256
+#define RECORD_START 	0x02
+#define RECORD_END 		0x03
+#define RECORD_HEADER 	7 // Start, writer, sequence, payload length
+#define RECORD_MAX 		(RECORD_HEADER + 60 + 2)
+#define POISON 			0xEE
+#define STUCK_MS 		5000
+
+static uint8_t Ring[RING_SIZE]; // Static, address fits 32 bit CMAR
+static DMA_Channel_TypeDef Channel;
+static DmaChannel_t DmaCh = {.Channel = &Channel, .Number = 4, .Irq = DMA1_Channel4_IRQn};
+static DmaTx_t Tx(&DmaCh, Ring, sizeof(Ring));
+
+static std::vector<uint8_t> Sent;
+static std::atomic<uint32_t> WritersDone;
+static std::atomic<uint32_t> Retries;
+static uint32_t Seed = 1;
+
+static void RandomSwitch(){
+	static thread_local std::minstd_rand random(Seed + std::hash<std::thread::id>()(std::this_thread::get_id()));
+	if(random()%4 == 0)
+		std::this_thread::yield();
+}
+
+static uint32_t BuildRecord(uint8_t* record, uint8_t writer, uint32_t sequence, uint32_t payload){
+	record[0] = RECORD_START;
+	record[1] = writer;
+	memcpy(&record[2], &sequence, sizeof(sequence));
+	record[6] = payload;
+	uint8_t sum = 0;
+	for(uint32_t i = 0; i < payload; i++){
+		record[RECORD_HEADER + i] = writer*31 + sequence + i;
+		sum += record[RECORD_HEADER + i];
+	}
+	record[RECORD_HEADER + payload] = sum;
+	record[RECORD_HEADER + payload + 1] = RECORD_END;
+	return RECORD_HEADER + payload + 2;
+}
+
+static void Writer(uint8_t writer, uint32_t records){
+	std::minstd_rand random(Seed*131 + writer);
+	uint8_t record[RECORD_MAX];
+	for(uint32_t sequence = 0; sequence < records; sequence++){
+		uint32_t length = BuildRecord(record, writer, sequence, random()%61);
+		while(Tx.Write(record, length) != length){
+			Retries++;
+			std::this_thread::yield(); // Ring full, wait for DMA
+		}
+		Tx.StartTransmission();
+	}
+	WritersDone++;
+}
+
+// Transfer complete interrupt
+static void CompleteTransfer(){
+	__disable_irq();
+	host::IpsrValue = 16 + DmaCh.Irq;
+	Channel.CNDTR = 0;
+	DMA1->ISR |= DMA_ISR_TCIF1 << 4*(DmaCh.Number - 1);
+	Tx.IrqHandler();
+	DMA1->ISR = 0; // Cleared by IFCR write
+	host::IpsrValue = 0;
+	__enable_irq();
+}
+
+static uint8_t Dma(uint32_t writers){
+	auto lastProgress = std::chrono::steady_clock::now();
+	while(1){
+		__disable_irq();
+		uint32_t enabled = Channel.CCR & DMA_CCR_EN;
+		uint8_t* data = (uint8_t*)(uintptr_t)Channel.CMAR;
+		uint32_t length = Channel.CNDTR;
+		__enable_irq();
+		if(enabled){
+			// Ring bytes of transfer belong to DMA until interrupt
+			Sent.insert(Sent.end(), data, data + length);
+			memset(data, POISON, length);
+			CompleteTransfer();
+			lastProgress = std::chrono::steady_clock::now();
+			continue;
+		}
+		if((WritersDone == writers) and (Tx.GetNumberOfBytesInBuffer() == 0))
+			return retvOk;
+		Tx.Flush(); // Idle tick
+		std::this_thread::yield();
+		if(std::chrono::steady_clock::now() - lastProgress > std::chrono::milliseconds(STUCK_MS))
+			return retvTimeout;
+	}
+}
+
+static uint8_t Check(uint32_t writers, uint32_t records){
+	std::vector<uint32_t> next(writers, 0);
+	uint32_t pos = 0;
+	while(pos < Sent.size()){
+		const uint8_t* record = &Sent[pos];
+		uint32_t left = Sent.size() - pos;
+		uint32_t sequence;
+		if((left < RECORD_HEADER) or (record[0] != RECORD_START) or (record[1] >= writers)){
+			printf("FAIL bad record start at byte %u\n", pos);
+			return retvFail;
+		}
+		memcpy(&sequence, &record[2], sizeof(sequence));
+		uint8_t expected[RECORD_MAX];
+		uint32_t length = BuildRecord(expected, record[1], sequence, record[6] <= 60 ? record[6] : 0);
+		if((left < length) or (memcmp(record, expected, length) != 0)){
+			printf("FAIL record of writer %u sequence %u at byte %u broken\n", record[1], sequence, pos);
+			return retvFail;
+		}
+		if(sequence != next[record[1]]){
+			printf("FAIL writer %u sequence %u, expected %u\n", record[1], sequence, next[record[1]]);
+			return retvFail;
+		}
+		next[record[1]]++;
+		pos += length;
+	}
+	for(uint32_t i = 0; i < writers; i++)
+		if(next[i] != records){
+			printf("FAIL writer %u sent %u of %u records\n", i, next[i], records);
+			return retvFail;
+		}
+	return retvOk;
+}
+
+int main(int argc, char* argv[]){
+	uint32_t writers = argc > 1 ? atoi(argv[1]) : 4;
+	uint32_t records = argc > 2 ? atoi(argv[2]) : 20000;
+	Seed = argc > 3 ? atoi(argv[3]) : 1;
+	if(((uintptr_t)Ring >> 32) != 0){
+		printf("FAIL ring above 4 GB, build without PIE\n");
+		return 1;
+	}
+	host::ExclusiveHook = RandomSwitch;
+
+	std::vector<std::thread> threads;
+	for(uint32_t i = 0; i < writers; i++)
+		threads.emplace_back(Writer, i, records);
+	if(Dma(writers) != retvOk){
+		// Writers may wait for space forever, don't join them
+		printf("FAIL no transfer for %u ms, %u bytes in ring\n", STUCK_MS, Tx.GetNumberOfBytesInBuffer());
+		fflush(stdout);
+		_Exit(1);
+	}
+	for(auto& thread: threads)
+		thread.join();
+	if(Check(writers, records) != retvOk)
+		return 1;
+	printf("dmatx stress: %u writers x %u records ok, %zu bytes in %u transfers, %u retries on full ring\n",
+			writers, records, Sent.size(), Tx.GetStats()->Transfers, Retries.load());
+	return 0;
+}
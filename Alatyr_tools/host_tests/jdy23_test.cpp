@@ -0,0 +1,233 @@
+/*
+ * jdy23_test.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <stdio.h>
+#include <deque>
+#include <string>
+#include <vector>
+//
+#include <jdy23.h>
+
+//Jdy23_t configuration test against scripted module
+/////////////////////////////////////////////////////////////////////
+/*
+* FakeJdy_t is the module on the other end of TX channel. It hears command
+* only when local UART runs at its rate and answers JDY23_ANSWER_MS later,
+* answer sent at another rate than local one arrives as garbage line. Time
+* only moves in test loop, to next answer or to timeout of Jdy23_t.
+*
+* Covers configuration of new and cached module, module that never
+* answers, ERROR answers, and new baud rate failing verification with
+* fallback to lower rates down to the one module keeps.
+*/
+
+#define JDY23_ANSWER_MS 	20
+#define TEST_LIMIT_MS 		60000
+#define TEST_NAME 			"GenshinVision"
+#define TEST_VERSION 		"JDY-23-V2.1"
+#define TEST_MAC 			"3C4A92B1C0DE"
+
+typedef struct{
+	uint32_t DueMs;
+	uint32_t Baud; // Rate answer is sent at
+	std::string Text;
+} Answer_t;
+
+class FakeJdy_t final:public iWriter_t{
+protected:
+	std::string Line; // Being written by Jdy23_t
+	void Answer(const std::string& text){
+		std::string sent = text;
+		if(Baud == DamagedBaud)
+			for(char& c: sent)
+				c = (c == 'O') ? '0' : (c == 'N') ? 'M' : c;
+		Answers.push_back({NowMs + JDY23_ANSWER_MS, Baud, sent});
+	}
+	void Receive(const std::string& command){
+		Sent.push_back(command);
+		if(Off or (LocalBaud != Baud))
+			return; // Garbage for module
+		if((ErrorCommand != NULL) and (command.compare(0, strlen(ErrorCommand), ErrorCommand) == 0))
+			Answer("ERROR");
+		else if(command == "AT+VER")
+			Answer("+VERSION=" TEST_VERSION);
+		else if(command == "AT+MAC")
+			Answer("+MAC=" TEST_MAC);
+		else if(command == "AT+NAME")
+			Answer("+NAME=" + Name);
+		else if(command.compare(0, 7, "AT+NAME") == 0){
+			Name = command.substr(7);
+			Answer("OK");
+		} else if(command.compare(0, 7, "AT+BAUD") == 0){
+			if(!KeepsBaud)
+				PendingBaud = jdy23::Rates[command[7] - '4'];
+			Answer("OK");
+		} else if(command == "AT+RESET"){
+			Answer("OK");
+			if(PendingBaud != 0)
+				Baud = PendingBaud;
+			PendingBaud = 0;
+		}
+	}
+public:
+	// Module
+	uint32_t Baud = 9600;
+	uint32_t PendingBaud = 0; // Taken by AT+RESET
+	uint32_t DamagedBaud = 0; // Module hears at this rate, its answers are damaged
+	uint8_t KeepsBaud = 0; // Answers OK to AT+BAUD and stays at its rate
+	uint8_t Off = 0;
+	const char* ErrorCommand = NULL; // Answered with ERROR
+	std::string Name = "JDY-23";
+	// Link
+	uint32_t LocalBaud = 0;
+	uint32_t NowMs = 0;
+	std::vector<std::string> Sent; // Every command, heard or not
+	std::deque<Answer_t> Answers;
+	uint8_t WriteChar(uint8_t data) {Line += (char)data; return retvOk;}
+	uint32_t Write(const uint8_t* data, uint32_t length){
+		Line.append((const char*)data, length);
+		return length;
+	}
+	uint8_t StartTransmission(){
+		if((Line.size() >= 2) and (Line.compare(Line.size() - 2, 2, "\r\n") == 0)){
+			Receive(Line.substr(0, Line.size() - 2));
+			Line.clear();
+		}
+		return retvOk;
+	}
+	uint32_t Count(const char* command){
+		uint32_t count = 0;
+		for(const std::string& sent: Sent)
+			count += sent == command;
+		return count;
+	}
+};
+
+static FakeJdy_t Module;
+static GPIO_TypeDef PwrcGpio;
+static uint32_t Failures = 0;
+
+static void SetBaud(uint32_t baud) {Module.LocalBaud = baud;}
+
+static void Check(const char* name, bool passed){
+	if(!passed){
+		printf("FAIL %s, commands:", name);
+		for(const std::string& sent: Module.Sent)
+			printf(" %s", sent.c_str());
+		printf("\n");
+		Failures++;
+	}
+}
+
+// Runs configuration as shell task does, returns duration
+static uint32_t Run(Jdy23_t& ble){
+	uint32_t startMs = Module.NowMs;
+	ble.Start(Module.NowMs);
+	while(ble.IsBusy() and (Module.NowMs - startMs < TEST_LIMIT_MS)){
+		while(!Module.Answers.empty() and (Module.Answers.front().DueMs <= Module.NowMs)){
+			Answer_t answer = Module.Answers.front();
+			Module.Answers.pop_front();
+			ble.ProcessLine(answer.Baud == Module.LocalBaud ? answer.Text.c_str() : "\xF8\x80~", Module.NowMs);
+		}
+		if(ble.Poll(Module.NowMs) == retvOk)
+			break;
+		uint32_t nextMs = Module.NowMs + ble.GetWaitMs(Module.NowMs);
+		if(!Module.Answers.empty() and (Module.Answers.front().DueMs < nextMs))
+			nextMs = Module.Answers.front().DueMs;
+		Module.NowMs = nextMs > Module.NowMs ? nextMs : Module.NowMs + 1;
+	}
+	Check("finished", !ble.IsBusy());
+	return Module.NowMs - startMs;
+}
+
+static void NewModule(){
+	Module = FakeJdy_t();
+	Jdy23Info_t info = {};
+	Jdy23_t ble(&Module, SetBaud, &PwrcGpio, 4, &info, TEST_NAME, 115200);
+	Run(ble);
+	Check("new module ready", ble.GetState() == jdyReady);
+	Check("new module info", (strcmp(info.Version, TEST_VERSION) == 0) and (strcmp(info.Mac, TEST_MAC) == 0) and
+			(strcmp(info.Name, TEST_NAME) == 0) and (info.Baud == 115200) and ble.IsInfoChanged());
+	Check("name set", (Module.Name == TEST_NAME) and (Module.Count("AT+NAME" TEST_NAME) == 1));
+	Check("raised to 115200", (Module.Baud == 115200) and (ble.GetBaud() == 115200) and
+			(Module.Count("AT+BAUD8") == 1) and (ble.GetRateStats(4)->Verified == 1));
+	Check("verified", Module.Count("AT+VER") == 1 + JDY23_VERIFY_COUNT);
+	Check("PWRC released", PwrcGpio.BSRR == (1UL << 4));
+
+	// Same module next time, only version is asked
+	Module.Sent.clear();
+	Run(ble);
+	Check("cached module", (ble.GetState() == jdyReady) and !ble.IsInfoChanged() and
+			(Module.Sent == std::vector<std::string>{"AT+VER"}));
+}
+
+static void NoAnswer(){
+	Module = FakeJdy_t();
+	Module.Off = 1;
+	Jdy23Info_t info = {};
+	Jdy23_t ble(&Module, SetBaud, &PwrcGpio, 4, &info, TEST_NAME, 115200);
+	uint32_t ms = Run(ble);
+	Check("silent module failed", ble.GetState() == jdyFailed);
+	Check("every rate probed", (Module.Count("AT+VER") == JDY23_RATE_COUNT*JDY23_RETRIES) and
+			(ms == JDY23_RATE_COUNT*JDY23_RETRIES*JDY23_TIMEOUT_MS));
+	Check("info kept", (info.Baud == 0) and !ble.IsInfoChanged());
+}
+
+static void ErrorAnswers(){
+	// Baud rate refused, module keeps working at its rate
+	Module = FakeJdy_t();
+	Module.ErrorCommand = "AT+BAUD";
+	Jdy23Info_t info = {};
+	Jdy23_t ble(&Module, SetBaud, &PwrcGpio, 4, &info, TEST_NAME, 115200);
+	Run(ble);
+	Check("baud refused ready", (ble.GetState() == jdyReady) and (ble.GetBaud() == 9600) and (info.Baud == 9600));
+	Check("baud retried", (Module.Count("AT+BAUD8") == 1 + JDY23_RETRIES) and (Module.Count("AT+RESET") == 0));
+
+	// MAC is required
+	Module = FakeJdy_t();
+	Module.ErrorCommand = "AT+MAC";
+	info = {};
+	Jdy23_t noMac(&Module, SetBaud, &PwrcGpio, 4, &info, TEST_NAME, 115200);
+	Run(noMac);
+	Check("MAC refused failed", (noMac.GetState() == jdyFailed) and (Module.Count("AT+MAC") == 1 + JDY23_RETRIES));
+}
+
+static void Fallback(){
+	// Module hears 115200, but its answers are damaged there
+	Module = FakeJdy_t();
+	Module.DamagedBaud = 115200;
+	Jdy23Info_t info = {};
+	Jdy23_t ble(&Module, SetBaud, &PwrcGpio, 4, &info, TEST_NAME, 115200);
+	Run(ble);
+	Check("damaged rate ready", (ble.GetState() == jdyReady) and (ble.GetBaud() == 57600) and
+			(Module.Baud == 57600) and (info.Baud == 57600));
+	Check("told blind to go lower", Module.Count("AT+BAUD7") == 1 + JDY23_RETRIES);
+	Check("damaged rate stats", (ble.GetRateStats(4)->Failed == 1) and (ble.GetRateStats(4)->Verified == 0) and
+			(ble.GetRateStats(3)->Verified == 1) and (ble.GetRateStats(3)->BytesPerSecond != 0));
+
+	// Module answers OK to AT+BAUD, but stays at old rate, so every
+	// verification fails and link ends at old rate
+	Module = FakeJdy_t();
+	Module.KeepsBaud = 1;
+	info = {};
+	Jdy23_t kept(&Module, SetBaud, &PwrcGpio, 4, &info, TEST_NAME, 115200);
+	Run(kept);
+	Check("kept rate ready", (kept.GetState() == jdyReady) and (kept.GetBaud() == 9600) and (info.Baud == 9600));
+	for(uint8_t rate = 1; rate < JDY23_RATE_COUNT; rate++)
+		Check("kept rate stats", (kept.GetRateStats(rate)->Failed == 1) and (kept.GetRateStats(rate)->Verified == 0));
+}
+
+int main(){
+	NewModule();
+	NoAnswer();
+	ErrorAnswers();
+	Fallback();
+	if(Failures != 0)
+		return 1;
+	printf("jdy23: ok\n");
+	return 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * linkbench_test.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+//
+#include <linkbench.h>
+
+//LinkBench_t round trip histogram test
+/////////////////////////////////////////////////////////////////////
+/*
+* Bins of known times around exact range end and powers of two, bins must
+* cover every time once and be at most 1/8 wide, except top bin holding
+* all longer times, its percentile is maximum. Percentiles
+* of random samples are compared with exact ones from sorted samples,
+* they may be only up to 1/8 above and never above maximum. Saturated
+* counters and times beyond top bin keep percentiles within bounds.
+*/
+
+class TestBench_t:public LinkBench_t{
+public:
+	TestBench_t():LinkBench_t(72, NULL) {}
+	using LinkBench_t::AddRoundTrip;
+	using LinkBench_t::GetPercentile;
+	using LinkBench_t::ComputeLatency;
+	// Bin which got only round trip so far
+	int32_t GetBin(){
+		for(uint32_t i = 0; i < LINKBENCH_BINS; i++)
+			if(Histogram[i] != 0)
+				return i;
+		return -1;
+	}
+	inline uint16_t GetCount(uint32_t bin) {return Histogram[bin];}
+};
+
+static uint32_t Failures = 0;
+
+static void Check(const char* name, bool passed){
+	if(!passed){
+		printf("FAIL %s\n", name);
+		Failures++;
+	}
+}
+
+static void Bins(){
+	static const struct{
+		uint32_t Us;
+		int32_t Bin;
+		uint32_t UpperUs;
+	} vectors[] = {
+		{0, 0, 0}, {1, 1, 1}, {15, 15, 15}, {16, 16, 17}, {17, 16, 17}, {18, 17, 19},
+		{31, 23, 31}, {32, 24, 35}, {35, 24, 35}, {36, 25, 39}, {63, 31, 63}, {64, 32, 71},
+		{245759, 126, 245759}, {245760, 127, 1000000}, // Top bin is open, its bound is maximum
+	};
+	for(const auto& vector: vectors){
+		TestBench_t bench;
+		bench.AddRoundTrip(vector.Us);
+		int32_t bin = bench.GetBin();
+		bench.AddRoundTrip(1000000); // Maximum above, percentile is not cut
+		uint32_t upperUs = bench.GetPercentile(50);
+		if((bin != vector.Bin) or (upperUs != vector.UpperUs)){
+			printf("FAIL %u us: bin %d, upper bound %u us, expected %d and %u us\n", vector.Us, bin, upperUs,
+					vector.Bin, vector.UpperUs);
+			Failures++;
+		}
+	}
+
+	// Every time falls into bin whose range holds it, bins are contiguous
+	// up to top bin
+	uint32_t lastBin = 0;
+	uint32_t lowerUs = 0;
+	for(uint32_t us = 0; us <= 262143; us++){
+		TestBench_t bench;
+		bench.AddRoundTrip(us);
+		uint32_t bin = bench.GetBin();
+		bench.AddRoundTrip(1000000);
+		uint32_t upperUs = bench.GetPercentile(50);
+		if(bin != lastBin){
+			if(bin != lastBin + 1){
+				printf("FAIL %u us skips from bin %u to %u\n", us, lastBin, bin);
+				Failures++;
+				return;
+			}
+			lastBin = bin;
+			lowerUs = us;
+		}
+		if((upperUs < us) or ((bin != LINKBENCH_BINS - 1) and (upperUs - lowerUs > lowerUs/8))){
+			printf("FAIL %u us in bin %u of %u..%u us\n", us, bin, lowerUs, upperUs);
+			Failures++;
+			return;
+		}
+	}
+	Check("top bin", lastBin == LINKBENCH_BINS - 1);
+
+	// Beyond top bin, maximum is exact
+	TestBench_t bench;
+	bench.AddRoundTrip(5000000);
+	Check("beyond top bin", (bench.GetBin() == LINKBENCH_BINS - 1) and (bench.GetPercentile(50) == 5000000) and
+			(bench.GetPercentile(99) == 5000000));
+}
+
+// Exact percentile, same rank as LinkBench_t
+static uint32_t Percentile(std::vector<uint32_t> samples, uint32_t percent){
+	std::sort(samples.begin(), samples.end());
+	uint32_t rank = (samples.size()*percent + 99)/100;
+	return samples[rank - 1];
+}
+
+static void Percentiles(){
+	TestBench_t bench;
+	for(uint32_t us = 1; us <= 100; us++)
+		bench.AddRoundTrip(us);
+	bench.ComputeLatency();
+	const LinkBenchResult_t* result = bench.GetResult();
+	Check("p50 of 1..100 us", result->LatencyP50Us == 51);
+	Check("p99 of 1..100 us", result->LatencyP99Us == 100); // Bin ends at 103, cut to maximum
+	Check("round trips", (result->RoundTrips == 100) and (result->LatencyMaxUs == 100));
+
+	std::mt19937 random(1);
+	for(uint32_t i = 0; i < 2000; i++){
+		TestBench_t bench;
+		std::vector<uint32_t> samples(1 + random()%3000);
+		// Log-uniform from 1 us to 100 ms, as serial round trips spread
+		for(uint32_t& us: samples){
+			us = (uint32_t)std::exp(std::uniform_real_distribution<double>(0, std::log(100000.0))(random));
+			bench.AddRoundTrip(us);
+		}
+		bench.ComputeLatency();
+		const LinkBenchResult_t* result = bench.GetResult();
+		uint32_t p50 = Percentile(samples, 50);
+		uint32_t p99 = Percentile(samples, 99);
+		uint32_t max = *std::max_element(samples.begin(), samples.end());
+		if((result->LatencyP50Us < p50) or (result->LatencyP50Us > p50 + p50/8) or
+				(result->LatencyP99Us < p99) or (result->LatencyP99Us > p99 + p99/8) or
+				(result->LatencyP99Us > max) or (result->LatencyMaxUs != max)){
+			printf("FAIL %zu samples: p50 %u/%u, p99 %u/%u, max %u/%u us (histogram/exact)\n", samples.size(),
+					result->LatencyP50Us, p50, result->LatencyP99Us, p99, result->LatencyMaxUs, max);
+			Failures++;
+			return;
+		}
+	}
+}
+
+static void Saturation(){
+	// Bin of 100 us stops at 0xFFFF, percentiles come from counted part
+	TestBench_t bench;
+	for(uint32_t i = 0; i < 70000; i++)
+		bench.AddRoundTrip(100);
+	for(uint32_t i = 0; i < 1000; i++)
+		bench.AddRoundTrip(4000);
+	for(uint32_t i = 0; i < 10; i++)
+		bench.AddRoundTrip(8000);
+	bench.ComputeLatency();
+	const LinkBenchResult_t* result = bench.GetResult();
+	Check("saturated bin", bench.GetCount(36) == 0xFFFF);
+	Check("round trips over saturated bin", result->RoundTrips == 71010);
+	Check("p50 with saturated bin", result->LatencyP50Us == 103);
+	Check("p99 with saturated bin", result->LatencyP99Us == 4095); // Rank 65880 of 66545 counted
+	Check("max with saturated bin", result->LatencyMaxUs == 8000);
+
+	// Every sample in saturated bin
+	TestBench_t full;
+	for(uint32_t i = 0; i < 70000; i++)
+		full.AddRoundTrip(7);
+	full.ComputeLatency();
+	Check("all in saturated bin", (full.GetResult()->LatencyP50Us == 7) and (full.GetResult()->LatencyP99Us == 7));
+}
+
+int main(){
+	Bins();
+	Percentiles();
+	Saturation();
+	if(Failures != 0)
+		return 1;
+	printf("linkbench: ok\n");
+	return 0;
+}
@@ -0,0 +1,394 @@
+/*
+ * rpc_test.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <stdio.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+//
+#include <rpc.h>
+
+//Binary RPC test
+/////////////////////////////////////////////////////////////////////
+/*
+* Packet coding - CRC check values, known COBS vectors, COBS and varint
+* round trips with random data, rejected broken input.
+*
+* RpcLink_t - scripted input with text and packets is read through link
+* with different read sizes. Text must reach reader unchanged, every
+* packet must be answered. Lost and merged delimiters, corrupted and
+* overlong frames must cost only the broken packet, next one is answered.
+*/
+
+typedef std::vector<uint8_t> Bytes_t;
+
+static uint32_t Failures = 0;
+
+static void Check(const char* name, bool passed){
+	if(!passed){
+		printf("FAIL %s\n", name);
+		Failures++;
+	}
+}
+
+static std::string Hex(const Bytes_t& data){
+	std::string out;
+	char hex[4];
+	for(uint8_t byte: data){
+		snprintf(hex, sizeof(hex), "%02X ", byte);
+		out += hex;
+	}
+	return out;
+}
+
+//Packet coding
+/////////////////////////////////////////////////////////////////////
+
+static Bytes_t Encode(const Bytes_t& data){
+	Bytes_t out(data.size() + data.size()/254 + 1);
+	out.resize(rpc::CobsEncode(data.data(), data.size(), out.data()));
+	return out;
+}
+
+static Bytes_t Decode(const Bytes_t& data, uint32_t outSize){
+	Bytes_t out(outSize);
+	out.resize(rpc::CobsDecode(data.data(), data.size(), out.data(), outSize));
+	return out;
+}
+
+static void Crc(){
+	const uint8_t* check = (const uint8_t*)"123456789";
+	// CRC-16/CCITT-FALSE, same value from rpc_client.py crc16()
+	Check("crc check value", rpc::Crc16(check, 9) == 0x29B1);
+	Check("crc of nothing", rpc::Crc16(check, 0) == 0xFFFF);
+	Check("crc in parts", rpc::Crc16(&check[4], 5, rpc::Crc16(check, 4)) == 0x29B1);
+	Check("crc of zero", rpc::Crc16((const uint8_t*)"\0", 1) == 0xE1F0);
+}
+
+static void CobsVectors(){
+	static const struct{
+		Bytes_t Data;
+		Bytes_t Encoded;
+	} vectors[] = {
+		{{}, {0x01}},
+		{{0x00}, {0x01, 0x01}},
+		{{0x00, 0x00}, {0x01, 0x01, 0x01}},
+		{{0x11, 0x22, 0x00, 0x33}, {0x03, 0x11, 0x22, 0x02, 0x33}},
+		{{0x11, 0x22, 0x33, 0x44}, {0x05, 0x11, 0x22, 0x33, 0x44}},
+		{{0x11, 0x00, 0x00, 0x00}, {0x02, 0x11, 0x01, 0x01, 0x01}},
+	};
+	for(const auto& vector: vectors){
+		Bytes_t encoded = Encode(vector.Data);
+		if(encoded != vector.Encoded){
+			printf("FAIL cobs encode %s-> %s\n", Hex(vector.Data).c_str(), Hex(encoded).c_str());
+			Failures++;
+		}
+		if(!vector.Data.empty() and (Decode(vector.Encoded, 8) != vector.Data)){
+			printf("FAIL cobs decode %s\n", Hex(vector.Encoded).c_str());
+			Failures++;
+		}
+	}
+	// 254 non-zero bytes are one full block without zero after it
+	Bytes_t block(255);
+	block[0] = 0xFF;
+	for(uint32_t i = 1; i < block.size(); i++)
+		block[i] = i;
+	Bytes_t decoded = Decode(block, 300);
+	Check("cobs full block", (decoded.size() == 254) and (decoded == Bytes_t(block.begin() + 1, block.end())));
+
+	// Broken encoding and too small output are refused
+	Check("cobs zero inside", Decode({0x03, 0x11, 0x00, 0x02, 0x33}, 8).empty());
+	Check("cobs zero code", Decode({0x00, 0x11}, 8).empty());
+	Check("cobs block past end", Decode({0x05, 0x11, 0x22}, 8).empty());
+	Check("cobs output full", Decode({0x05, 0x11, 0x22, 0x33, 0x44}, 3).empty());
+	Check("cobs output full by zero", Decode({0x02, 0x11, 0x01}, 1).empty());
+}
+
+static void CobsRoundTrip(std::mt19937& random){
+	for(uint32_t i = 0; i < 20000; i++){
+		Bytes_t data(random()%600);
+		uint32_t zeros = random()%4; // Some inputs have no zeros, long blocks
+		for(uint8_t& byte: data)
+			byte = (zeros and (random()%(4*zeros) == 0)) ? 0 : 1 + random()%255;
+		Bytes_t encoded = Encode(data);
+		bool noZero = true;
+		for(uint8_t byte: encoded)
+			noZero = noZero and (byte != 0);
+		if(!noZero or (encoded.size() > data.size() + data.size()/254 + 1) or
+				(!data.empty() and (Decode(encoded, data.size()) != data))){
+			printf("FAIL cobs round trip of %zu bytes: %s\n", data.size(), Hex(data).c_str());
+			Failures++;
+			return;
+		}
+	}
+}
+
+static void Varint(std::mt19937& random){
+	static const struct{
+		uint32_t Value;
+		uint32_t Length;
+	} vectors[] = {
+		{0, 1}, {1, 1}, {127, 1}, {128, 2}, {300, 2}, {16383, 2}, {16384, 3},
+		{(1UL << 21) - 1, 3}, {1UL << 28, 5}, {UINT32_MAX, 5},
+	};
+	uint8_t out[5];
+	uint32_t value;
+	for(const auto& vector: vectors){
+		uint32_t length = rpc::PutVarint(out, sizeof(out), vector.Value);
+		if((length != vector.Length) or (rpc::GetVarint(out, length, &value) != length) or (value != vector.Value)){
+			printf("FAIL varint %u: %u bytes, read back %u\n", vector.Value, length, value);
+			Failures++;
+		}
+		Check("varint without space", rpc::PutVarint(out, vector.Length - 1, vector.Value) == 0);
+		Check("varint cut", (length == 1) or (rpc::GetVarint(out, length - 1, &value) == 0));
+	}
+	for(uint32_t i = 0; i < 100000; i++){
+		uint32_t number = random() >> (random()%32);
+		uint32_t length = rpc::PutVarint(out, sizeof(out), number);
+		if((rpc::GetVarint(out, sizeof(out), &value) != length) or (value != number)){
+			printf("FAIL varint round trip %u\n", number);
+			Failures++;
+			break;
+		}
+	}
+	static const uint8_t unterminated[] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x01};
+	Check("varint longer than 5 bytes", rpc::GetVarint(unterminated, sizeof(unterminated), &value) == 0);
+	Check("zigzag", (rpc::ZigZag(0) == 0) and (rpc::ZigZag(-1) == 1) and (rpc::ZigZag(1) == 2) and
+			(rpc::ZigZag(INT32_MIN) == UINT32_MAX));
+	static const int32_t signedValues[] = {0, -1, 1, -64, 64, INT32_MIN, INT32_MAX};
+	for(int32_t number: signedValues)
+		Check("zigzag round trip", rpc::UnZigZag(rpc::ZigZag(number)) == number);
+}
+
+//RpcLink_t
+/////////////////////////////////////////////////////////////////////
+
+class Script_t final:public iReader_t{
+public:
+	Bytes_t Data;
+	uint32_t Position = 0;
+	uint32_t Chunk = 1; // Most bytes returned by one Read
+	uint8_t ReadChar(retv_t* retv){
+		uint8_t data = 0;
+		uint32_t length = Read(&data, 1);
+		if(retv != NULL)
+			*retv = length ? retvOk : retvEmpty;
+		return data;
+	}
+	uint32_t Read(uint8_t* data, uint32_t length){
+		length = std::min<uint32_t>({length, Chunk, (uint32_t)Data.size() - Position});
+		memcpy(data, &Data[Position], length);
+		Position += length;
+		return length;
+	}
+	uint32_t GetNumberOfBytesReady() {return Data.size() - Position;}
+};
+
+class Sent_t final:public iWriter_t{
+public:
+	Bytes_t Data;
+	uint8_t WriteChar(uint8_t data) {Data.push_back(data); return retvOk;}
+	uint32_t Write(const uint8_t* data, uint32_t length){
+		Data.insert(Data.end(), data, data + length);
+		return length;
+	}
+	uint8_t StartTransmission() {return retvOk;}
+};
+
+// Opcode 0 returns arguments back, opcode 1 their sum
+static uint8_t EchoRpc(const RpcArgs_t& args, RpcArgs_t& result){
+	result = args;
+	return retvOk;
+}
+
+static uint8_t SumRpc(const RpcArgs_t& args, RpcArgs_t& result){
+	result.Count = 1;
+	result.Arg[0] = 0;
+	for(uint32_t i = 0; i < args.Count; i++)
+		result.Arg[0] += args.Arg[i];
+	return retvOk;
+}
+
+static const RpcOp_t TestOps[] = {EchoRpc, SumRpc};
+
+// Encoded frame of request with one call, without delimiters
+static Bytes_t Request(uint8_t id, uint8_t opcode, const std::vector<uint32_t>& args){
+	Bytes_t packet = {id, (uint8_t)((args.size() << 5) | opcode)};
+	for(uint32_t arg: args){
+		uint8_t varint[5];
+		uint32_t length = rpc::PutVarint(varint, sizeof(varint), arg);
+		packet.insert(packet.end(), varint, varint + length);
+	}
+	uint16_t crc = rpc::Crc16(packet.data(), packet.size());
+	packet.push_back(crc & 0xFF);
+	packet.push_back(crc >> 8);
+	return Encode(packet);
+}
+
+static void Append(Bytes_t& data, const Bytes_t& part) {data.insert(data.end(), part.begin(), part.end());}
+static void Append(Bytes_t& data, const char* text) {data.insert(data.end(), text, text + strlen(text));}
+
+// Ids of answered requests, first result of each is checked against id
+static std::vector<uint8_t> Answers(const Bytes_t& sent){
+	std::vector<uint8_t> ids;
+	Bytes_t frame;
+	for(uint8_t byte: sent){
+		if(byte != 0){
+			frame.push_back(byte);
+			continue;
+		}
+		if(frame.empty())
+			continue;
+		Bytes_t packet = Decode(frame, RPC_PACKET_SIZE);
+		frame.clear();
+		uint32_t value = 0;
+		uint32_t end = packet.size() - 2;
+		if((packet.size() < 5) or (rpc::Crc16(packet.data(), end) != (packet[end] | (packet[end + 1] << 8))) or
+				(packet[2] != retvOk) or (rpc::GetVarint(&packet[3], packet.size() - 5, &value) == 0) or
+				(value != packet[0])){
+			ids.push_back(0xFF); // Broken answer
+			continue;
+		}
+		ids.push_back(packet[0]);
+	}
+	return ids;
+}
+
+typedef struct{
+	const char* Name;
+	Bytes_t Input;
+	std::string Text; // Expected text out of link
+	std::vector<uint8_t> Answered;
+} LinkCase_t;
+
+static void Link(){
+	std::vector<LinkCase_t> cases;
+	Bytes_t input;
+	// Packets between text, back to back and in the middle of line
+	Append(input, "status\r\n");
+	input.push_back(0);
+	Append(input, Request(1, 0, {1}));
+	input.push_back(0);
+	Append(input, "npx");
+	input.push_back(0);
+	Append(input, Request(2, 1, {1, 1}));
+	input.push_back(0);
+	input.push_back(0);
+	Append(input, Request(3, 1, {3}));
+	input.push_back(0);
+	Append(input, "on\r\n");
+	cases.push_back({"text and packets", input, "status\r\nnpxon\r\n", {1, 2, 3}});
+
+	// Opening delimiter lost, frame is text until its closing zero
+	input.clear();
+	Append(input, "a");
+	Append(input, Request(1, 0, {1}));
+	input.push_back(0);
+	input.push_back(0);
+	Append(input, Request(2, 0, {2}));
+	input.push_back(0);
+	Bytes_t lost = {'a'};
+	Append(lost, Request(1, 0, {1}));
+	cases.push_back({"lost opening delimiter", input, std::string(lost.begin(), lost.end()), {2}});
+
+	// Closing delimiter lost, opening of next packet closes frame, so next
+	// frame is text and its closing zero opens the one after it
+	input.clear();
+	input.push_back(0);
+	Append(input, Request(1, 0, {1}));
+	input.push_back(0);
+	Append(input, Request(2, 0, {2}));
+	input.push_back(0);
+	input.push_back(0);
+	Append(input, Request(3, 0, {3}));
+	input.push_back(0);
+	Bytes_t leaked = Request(2, 0, {2});
+	cases.push_back({"lost closing delimiter", input, std::string(leaked.begin(), leaked.end()), {1, 3}});
+
+	// Closing delimiter lost before text, frame failed by COBS stays open
+	// until zero of next packet, so only that text is lost with it
+	input.clear();
+	input.push_back(0);
+	Append(input, Request(1, 0, {1}));
+	Append(input, "led 1\r\n");
+	input.push_back(0);
+	Append(input, Request(2, 0, {2}));
+	input.push_back(0);
+	Append(input, "ok\r\n");
+	cases.push_back({"lost closing delimiter before text", input, "ok\r\n", {2}});
+
+	// Both delimiters between packets lost, merged frame fails CRC
+	input.clear();
+	input.push_back(0);
+	Append(input, Request(1, 0, {1}));
+	Append(input, Request(2, 0, {2}));
+	input.push_back(0);
+	input.push_back(0);
+	Append(input, Request(3, 0, {3}));
+	input.push_back(0);
+	Append(input, "ok\r\n");
+	cases.push_back({"merged frames", input, "ok\r\n", {3}});
+
+	// Corrupted byte and lost closing delimiter, zero that closes frame
+	// failed by CRC opens next packet
+	input.clear();
+	input.push_back(0);
+	Bytes_t corrupted = Request(1, 0, {0x55});
+	corrupted[3] ^= 0x10;
+	Append(input, corrupted);
+	input.push_back(0);
+	Append(input, Request(2, 0, {2}));
+	input.push_back(0);
+	cases.push_back({"corrupted frame", input, "", {2}});
+
+	// Frame longer than packet, rest of it is text
+	input.clear();
+	input.push_back(0);
+	input.insert(input.end(), RPC_PACKET_SIZE + RPC_PACKET_SIZE/254 + 1 + 1, 'g'); // Last one dropped
+	Append(input, "gg\r\n");
+	input.push_back(0);
+	Append(input, Request(1, 0, {1}));
+	input.push_back(0);
+	cases.push_back({"overlong frame", input, "gg\r\n", {1}});
+
+	static const uint32_t chunks[] = {1, 3, 16, 100};
+	static const uint32_t readSizes[] = {1, 5, 64};
+	for(const LinkCase_t& test: cases)
+		for(uint32_t chunk: chunks)
+			for(uint32_t readSize: readSizes){
+				Script_t script;
+				script.Data = test.Input;
+				script.Chunk = chunk;
+				Sent_t sent;
+				RpcLink_t link(&script, &sent, TestOps, sizeof(TestOps)/sizeof(TestOps[0]));
+				std::string text;
+				uint8_t buffer[64];
+				uint32_t length;
+				while((length = link.Read(buffer, readSize)) != 0)
+					text.append((const char*)buffer, length);
+				std::vector<uint8_t> answered = Answers(sent.Data);
+				if((text != test.Text) or (answered != test.Answered) or (script.GetNumberOfBytesReady() != 0)){
+					printf("FAIL %s, input chunk %u, read %u: text \"%s\", %zu answers\n", test.Name, chunk, readSize,
+							text.c_str(), answered.size());
+					Failures++;
+				}
+			}
+}
+
+int main(){
+	std::mt19937 random(1);
+	Crc();
+	CobsVectors();
+	CobsRoundTrip(random);
+	Varint(random);
+	Link();
+	if(Failures != 0)
+		return 1;
+	printf("rpc: ok\n");
+	return 0;
+}
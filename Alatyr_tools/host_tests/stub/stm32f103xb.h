@@ -0,0 +1,111 @@
+/*
+ * stm32f103xb.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#ifndef HOST_STM32F103XB_H_
+#define HOST_STM32F103XB_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+
+//Host build of firmware sources
+/////////////////////////////////////////////////////////////////////
+/*
+* Shadows device header found by <stm32f103xb.h>, so firmware headers and
+* sources compile unchanged for PC. Register layout and bit definitions
+* come from real CMSIS headers, only compiler specific part (cmsis_gcc.h
+* with Cortex-M assembly) is replaced here.
+*
+* Exclusive access maps to std::atomic compare-exchange. __LDREXW
+* remembers loaded value, __STREXW stores only if word still holds it,
+* which fails in the same cases as STREX losing reservation to another
+* writer. ExclusiveHook is called around exclusive accesses, test may
+* switch threads there to widen race windows even on single CPU.
+* Interrupt masking is one global lock, so code under PRIMASK
+* and simulated interrupt handlers run as on single core.
+*
+* Peripherals stay at hardware addresses, tests never touch them, except
+* DMA1 flags and DWT cycle counter which are host variables. Build without PIE, firmware keeps
+* buffer addresses in 32 bit DMA registers.
+*/
+
+#define __CMSIS_COMPILER_H // Skipped when core_cm3.h includes it
+
+#define __ASM 					__asm
+#define __INLINE 				inline
+#define __STATIC_INLINE 		static inline
+#define __STATIC_FORCEINLINE 	static inline
+#define __NO_RETURN 			__attribute__((__noreturn__))
+#define __USED 					__attribute__((used))
+#define __WEAK 					__attribute__((weak))
+#define __PACKED 				__attribute__((packed, aligned(1)))
+#define __ALIGNED(x) 			__attribute__((aligned(x)))
+
+namespace host {
+	inline std::recursive_mutex IrqLock;
+	inline thread_local uint32_t Primask = 0;
+	inline thread_local uint32_t IpsrValue = 0; // Set by simulated handlers
+	inline thread_local uint32_t ExclusiveValue = 0;
+	inline void (*ExclusiveHook)() = nullptr;
+}
+
+__STATIC_FORCEINLINE void __NOP() {}
+__STATIC_FORCEINLINE void __WFI() {}
+__STATIC_FORCEINLINE void __DSB() {std::atomic_thread_fence(std::memory_order_seq_cst);}
+__STATIC_FORCEINLINE void __ISB() {std::atomic_thread_fence(std::memory_order_seq_cst);}
+__STATIC_FORCEINLINE void __DMB() {std::atomic_thread_fence(std::memory_order_seq_cst);}
+
+__STATIC_FORCEINLINE uint32_t __get_PRIMASK() {return host::Primask;}
+__STATIC_FORCEINLINE void __disable_irq(){
+	if(host::Primask == 0)
+		host::IrqLock.lock();
+	host::Primask = 1;
+}
+__STATIC_FORCEINLINE void __enable_irq(){
+	if(host::Primask != 0)
+		host::IrqLock.unlock();
+	host::Primask = 0;
+}
+__STATIC_FORCEINLINE void __set_PRIMASK(uint32_t primask){
+	if(primask)
+		__disable_irq();
+	else
+		__enable_irq();
+}
+__STATIC_FORCEINLINE uint32_t __get_IPSR() {return host::IpsrValue;}
+
+__STATIC_FORCEINLINE uint32_t __LDREXW(volatile uint32_t* addr){
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "atomic must overlay word");
+	if(host::ExclusiveHook != nullptr)
+		host::ExclusiveHook();
+	host::ExclusiveValue = reinterpret_cast<volatile std::atomic<uint32_t>*>(addr)->load();
+	if(host::ExclusiveHook != nullptr)
+		host::ExclusiveHook();
+	return host::ExclusiveValue;
+}
+// 0 - stored, 1 - word changed since __LDREXW
+__STATIC_FORCEINLINE uint32_t __STREXW(uint32_t value, volatile uint32_t* addr){
+	uint32_t expected = host::ExclusiveValue;
+	uint32_t failed = reinterpret_cast<volatile std::atomic<uint32_t>*>(addr)->compare_exchange_strong(expected, value) ? 0 : 1;
+	if(host::ExclusiveHook != nullptr)
+		host::ExclusiveHook();
+	return failed;
+}
+__STATIC_FORCEINLINE void __CLREX() {}
+
+#include "../../../Alatyr_fw/CMSIS/stm32f103xb.h"
+
+namespace host {
+	inline DMA_TypeDef Dma1;
+	inline DWT_Type Dwt = {}; // Has read only members
+}
+#undef DMA1
+#define DMA1 (&host::Dma1)
+#undef DWT
+#define DWT (&host::Dwt)
+
+#endif /* HOST_STM32F103XB_H_ */
@@ -0,0 +1,233 @@
+/*
+ * tokenizer_test.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: KONSTANTIN
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+//
+#include <tokenizer.h>
+
+//LineTokenizer_t fuzz test and benchmark
+/////////////////////////////////////////////////////////////////////
+/*
+* fuzz - random input is fed in random chunks to tokenizer with random
+* buffer size, lines and tokens are compared with simple model working on
+* whole input. Input has CR, LF, CR LF and LF CR line ends, empty lines,
+* tabs and lines around buffer size and longer. Chunks are appended by
+* both Append() variants, so line end and CR LF pairs fall on chunk edge.
+* NUL is not generated, command text never has it.
+*
+* bench - throughput of typical command text with different chunk sizes,
+* as UART DMA idle events deliver it.
+*
+* tokenizer_test fuzz [iterations] [seed]
+* tokenizer_test bench
+*/
+
+typedef struct{
+	std::vector<std::string> Lines;
+	std::vector<std::vector<std::string>> Tokens; // Empty for rejected line
+	uint32_t Overflows;
+	uint32_t TooManyArgs;
+} Result_t;
+
+static uint8_t IsLineEnd(char c) {return (c == '\r') or (c == '\n');}
+static uint8_t IsSpace(char c) {return (c == ' ') or (c == '\t');}
+
+// What tokenizer with buffer of given size should return for whole input
+static void Model(const std::string& input, uint32_t size, Result_t* result){
+	std::string line;
+	uint8_t discarding = 0;
+	for(char c: input){
+		if(IsLineEnd(c)){
+			if(!discarding and !line.empty()){
+				result->Lines.push_back(line);
+				std::vector<std::string> tokens;
+				std::string token;
+				for(char t: line + " "){
+					if(!IsSpace(t))
+						token += t;
+					else if(!token.empty()){
+						tokens.push_back(token);
+						token.clear();
+					}
+				}
+				if(tokens.size() > TOKENIZER_MAX_ARGS){
+					result->TooManyArgs++;
+					tokens.clear();
+				}
+				result->Tokens.push_back(tokens);
+			}
+			discarding = 0;
+			line.clear();
+		} else if(!discarding){
+			line += c;
+			if(line.size() == size - 1){
+				// Buffer full without line end, one byte is kept free
+				result->Overflows++;
+				discarding = 1;
+				line.clear();
+			}
+		}
+	}
+}
+
+static void TakeLines(LineTokenizer_t& tokenizer, Result_t* result){
+	uint8_t retv;
+	while((retv = tokenizer.NextLine()) != retvEmpty){
+		if(retv != retvOk)
+			continue; // Overlong line dropped, next may be ready
+		result->Lines.push_back(tokenizer.GetLine());
+		std::vector<std::string> tokens;
+		if(tokenizer.Tokenize() == retvOk)
+			for(uint32_t i = 0; i < tokenizer.GetArgc(); i++)
+				tokens.push_back(tokenizer.GetArgv()[i]);
+		result->Tokens.push_back(tokens);
+	}
+}
+
+static void Feed(const std::string& input, uint32_t size, std::mt19937& random, Result_t* result){
+	std::vector<char> buffer(size);
+	LineTokenizer_t tokenizer(buffer.data(), size);
+	uint32_t maxChunk = 1 + random()%(2*size);
+	uint32_t pos = 0;
+	while(pos < input.size()){
+		uint32_t chunk = 1 + random()%maxChunk;
+		if(chunk > input.size() - pos)
+			chunk = input.size() - pos;
+		if(random()%2){
+			// Copy into free space directly, as DMA reader does
+			uint32_t free;
+			char* space = tokenizer.GetFreeSpace(&free);
+			if(chunk > free)
+				chunk = free;
+			memcpy(space, &input[pos], chunk);
+			tokenizer.Append(chunk);
+		} else
+			chunk = tokenizer.Append(&input[pos], chunk);
+		if(chunk == 0){
+			// NextLine() must leave free space once it returns retvEmpty
+			result->Lines.push_back("<buffer stuck>");
+			break;
+		}
+		pos += chunk;
+		TakeLines(tokenizer, result);
+	}
+	result->Overflows = tokenizer.GetStats()->Overflows;
+	result->TooManyArgs = tokenizer.GetStats()->TooManyArgs;
+	if(tokenizer.GetStats()->Lines != result->Lines.size())
+		result->Lines.push_back("<stats mismatch>");
+}
+
+static std::string RandomInput(std::mt19937& random, uint32_t size){
+	static const char text[] = "abcxyz0189-_.:=\t  \x80\xFF";
+	static const char* ends[] = {"\r", "\n", "\r\n", "\n\r", "\r\n\r\n"};
+	std::string input;
+	uint32_t lines = 1 + random()%40;
+	for(uint32_t i = 0; i < lines; i++){
+		uint32_t length;
+		if(random()%8 == 0)
+			length = size - 3 + random()%(2*size + 4); // Around buffer size and longer
+		else
+			length = random()%24;
+		for(uint32_t j = 0; j < length; j++)
+			input += text[random()%(sizeof(text) - 1)];
+		input += ends[random()%5];
+	}
+	return input;
+}
+
+static std::string Quote(const std::string& text){
+	std::string out;
+	char hex[8];
+	for(unsigned char c: text){
+		if((c >= ' ') and (c < 0x7F))
+			out += c;
+		else{
+			snprintf(hex, sizeof(hex), "\\x%02X", c);
+			out += hex;
+		}
+	}
+	return out;
+}
+
+static int Fuzz(uint32_t iterations, uint32_t seed){
+	static const uint32_t sizes[] = {4, 8, 16, 33, 128};
+	std::mt19937 random(seed);
+	for(uint32_t i = 0; i < iterations; i++){
+		uint32_t size = sizes[random()%5];
+		std::string input = RandomInput(random, size);
+		Result_t expected = {}, actual = {};
+		Model(input, size, &expected);
+		Feed(input, size, random, &actual);
+		if((actual.Lines != expected.Lines) or (actual.Tokens != expected.Tokens) or
+				(actual.Overflows != expected.Overflows) or (actual.TooManyArgs != expected.TooManyArgs)){
+			printf("FAIL iteration %u seed %u buffer %u\ninput \"%s\"\n", i, seed, size, Quote(input).c_str());
+			printf("lines %zu/%zu, overflows %u/%u, too many args %u/%u (got/expected)\n",
+					actual.Lines.size(), expected.Lines.size(), actual.Overflows, expected.Overflows,
+					actual.TooManyArgs, expected.TooManyArgs);
+			for(uint32_t j = 0; j < std::max(actual.Lines.size(), expected.Lines.size()); j++){
+				std::string got = j < actual.Lines.size() ? actual.Lines[j] : "<none>";
+				std::string want = j < expected.Lines.size() ? expected.Lines[j] : "<none>";
+				if(got != want)
+					printf("line %u \"%s\" != \"%s\"\n", j, Quote(got).c_str(), Quote(want).c_str());
+			}
+			return 1;
+		}
+	}
+	printf("tokenizer fuzz: %u inputs ok, seed %u\n", iterations, seed);
+	return 0;
+}
+
+static int Bench(){
+	static const char* commands[] = {
+		"status\r\n", "npxbudget 1500\r\n", "npxmatrix 3 -120\r\n", "npxwb 256 240 230\r\n",
+		"clip play 2 loop\r\n", "linkbench 0 echo 64 1000\n",
+	};
+	std::string input;
+	uint32_t lines = 0;
+	while(input.size() < (1UL << 20)){
+		input += commands[lines%6];
+		lines++;
+	}
+	static const uint32_t chunks[] = {1, 8, 64, 127};
+	char buffer[128];
+	printf("tokenizer bench: %zu bytes, %u lines, buffer %zu\n", input.size(), lines, sizeof(buffer));
+	for(uint32_t chunk: chunks){
+		LineTokenizer_t tokenizer(buffer, sizeof(buffer));
+		uint32_t tokens = 0;
+		auto start = std::chrono::steady_clock::now();
+		for(uint32_t pos = 0; pos < input.size(); ){
+			uint32_t length = std::min<uint32_t>(chunk, input.size() - pos);
+			pos += tokenizer.Append(&input[pos], length);
+			while(tokenizer.NextLine() != retvEmpty)
+				if(tokenizer.Tokenize() == retvOk)
+					tokens += tokenizer.GetArgc();
+		}
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		if(tokenizer.GetStats()->Lines != lines){
+			printf("FAIL chunk %u: %u of %u lines\n", chunk, tokenizer.GetStats()->Lines, lines);
+			return 1;
+		}
+		printf("chunk %3u: %7.1f MB/s, %5.2f ns/byte, %6.1f ns/line, %u tokens\n", chunk,
+				input.size()*1000.0/ns, ns/input.size(), ns/lines, tokens);
+	}
+	return 0;
+}
+
+int main(int argc, char* argv[]){
+	std::string mode = argc > 1 ? argv[1] : "";
+	if(mode == "fuzz")
+		return Fuzz(argc > 2 ? atoi(argv[2]) : 20000, argc > 3 ? atoi(argv[3]) : 1);
+	if(mode == "bench")
+		return Bench();
+	fprintf(stderr, "usage: %s fuzz [iterations] [seed] | bench\n", argv[0]);
+	return 2;
+}
@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""
+Binary log decoder - restores text of LOG_BIN records
+(see Alatyr_fw/Inc/binlog.h for record format).
+
+Format strings are read from ".logstr" section of firmware ELF file.
+Bytes outside of records are printed as they are, so text and binary
+log may share one UART. Serial port input needs pyserial.
+
+Example:
+    log_decoder.py Alatyr_fw.elf -p /dev/ttyUSB0 -b 115200
+    log_decoder.py Alatyr_fw.elf -i capture.bin
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+BINLOG_SYNC = 0xFE
+HEADER_SIZE = 8
+SPEC = re.compile(rb"%(-?)(0?)(\d*)(?:\.(\d+))?(.)")
+
+
+def read_log_strings(path):
+    with open(path, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF" or elf[4] != 1 or elf[5] != 1:
+        sys.exit("%s: only 32-bit little-endian ELF supported" % path)
+    shoff, = struct.unpack_from("<I", elf, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+    sections = [struct.unpack_from("<IIIIII", elf, shoff + i * shentsize) for i in range(shnum)]
+    names_offset = sections[shstrndx][4]
+    for name, _type, _flags, addr, offset, size in sections:
+        end = elf.index(b"\0", names_offset + name)
+        if elf[names_offset + name:end] == b".logstr":
+            return addr, elf[offset:offset + size]
+    sys.exit("%s: no .logstr section, firmware built without binary log" % path)
+
+
+class Decoder:
+    def __init__(self, base, strings):
+        self.base = base
+        self.strings = strings
+        self.buffer = bytearray()
+
+    def format_string(self, string_id):
+        offset = string_id - (self.base & 0xFFFF)
+        if offset < 0 or offset >= len(self.strings):
+            return None
+        end = self.strings.index(b"\0", offset)
+        return self.strings[offset:end]
+
+    @staticmethod
+    def pad(text, left, zero, width, prefix=""):
+        sign = ""
+        if text.startswith("-"):
+            sign, text = "-", text[1:]
+        fill = max(0, width - len(sign) - len(prefix) - len(text))
+        if left:
+            return sign + prefix + text + " " * fill
+        if zero:
+            return sign + prefix + "0" * fill + text
+        return " " * fill + sign + prefix + text
+
+    def format_record(self, fmt, args):
+        out = []
+        pos = 0
+        for match in SPEC.finditer(fmt):
+            out.append(fmt[pos:match.start()].decode(errors="replace"))
+            pos = match.end()
+            left, zero, width, precision, kind = match.groups()
+            left, zero = bool(left), bool(zero)
+            width = int(width or 0)
+            precision = int(precision or 0)
+            kind = kind.decode()
+            if kind == "%":
+                out.append("%")
+                continue
+            if kind in "sh":
+                if len(args) < 1 or len(args) < 1 + args[0]:
+                    out.append("<cut>")
+                    break
+                data, args = args[1:1 + args[0]], args[1 + args[0]:]
+                if kind == "s":
+                    out.append(self.pad(data.decode(errors="replace"), left, False, width))
+                else:
+                    out.append(" ".join("%02X" % b for b in data))
+                continue
+            if len(args) < 4:
+                out.append("<cut>")
+                break
+            word, = struct.unpack_from("<I", args)
+            signed, = struct.unpack_from("<i", args)
+            args = args[4:]
+            if kind == "d":
+                out.append(self.pad(str(signed), left, zero, width))
+            elif kind == "u":
+                out.append(self.pad(str(word), left, zero, width))
+            elif kind == "x":
+                out.append(self.pad("%X" % word, left, zero, width, "0x"))
+            elif kind == "b":
+                out.append(self.pad(bin(word)[2:], left, zero, width, "0b"))
+            elif kind == "c":
+                out.append(chr(word & 0xFF))
+            elif kind == "f":
+                digits = str(abs(signed)).rjust(precision + 1, "0")
+                text = digits[:len(digits) - precision] + ("." + digits[-precision:] if precision else "")
+                out.append(self.pad(("-" if signed < 0 else "") + text, left, zero, width))
+            else:
+                out.append("<%%%s?>" % kind)
+        else:
+            out.append(fmt[pos:].decode(errors="replace"))
+        return "".join(out)
+
+    def feed(self, data):
+        """Returns decoded text for received bytes, incomplete record is kept"""
+        self.buffer += data
+        out = []
+        while self.buffer:
+            sync = self.buffer.find(BINLOG_SYNC)
+            if sync != 0:
+                text = self.buffer if sync < 0 else self.buffer[:sync]
+                out.append(text.decode(errors="replace"))
+                del self.buffer[:len(text)]
+                continue
+            if len(self.buffer) < 2 or len(self.buffer) < 2 + self.buffer[1]:
+                break
+            length = self.buffer[1]
+            record = bytes(self.buffer[:2 + length])
+            del self.buffer[:2 + length]
+            if length + 2 < HEADER_SIZE:
+                continue
+            string_id, time = struct.unpack_from("<HI", record, 2)
+            fmt = self.format_string(string_id)
+            if fmt is None:
+                out.append("[%6d.%03d] <unknown log id 0x%04X>\n" % (time // 1000, time % 1000, string_id))
+                continue
+            out.append("[%6d.%03d] %s" % (time // 1000, time % 1000,
+                                          self.format_record(fmt, record[HEADER_SIZE:])))
+        return "".join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", help="firmware ELF file with .logstr section")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("-i", "--input", help="captured raw log file")
+    source.add_argument("-p", "--port", help="serial port")
+    parser.add_argument("-b", "--baud", type=int, default=115200, help="serial baud rate")
+    args = parser.parse_args()
+
+    base, strings = read_log_strings(args.elf)
+    decoder = Decoder(base, strings)
+    if args.input:
+        with open(args.input, "rb") as f:
+            sys.stdout.write(decoder.feed(f.read()))
+        return
+
+    try:
+        import serial
+    except ImportError:
+        sys.exit("pyserial is required for serial port input")
+    with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+        try:
+            while True:
+                data = port.read(256)
+                if data:
+                    sys.stdout.write(decoder.feed(data))
+                    sys.stdout.flush()
+        except KeyboardInterrupt:
+            pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,394 @@
+#!/usr/bin/env python3
+"""
+Binary RPC client - calls firmware operations over BLE/UART link
+(see Alatyr_fw/Inc/rpc.h for packet format).
+
+Benchmark compares text commands with binary calls, single, pipelined
+and batched. Loopback mode runs against device model in this script with
+simulated link speed, so numbers show protocol cost only. Serial port
+mode needs pyserial.
+
+Example:
+    rpc_client.py --loopback -b 9600
+    rpc_client.py -p /dev/rfcomm0 -b 9600 bench
+    rpc_client.py -p /dev/rfcomm0 call brightness 20
+"""
+
+import argparse
+import collections
+import struct
+import sys
+import time
+
+# Index in RpcOps of main.cpp
+OPCODES = {"ping": 0, "status": 1, "brightness": 2, "color": 3, "npxpower": 4, "clip": 5, "save": 6}
+STATUS_OK = 0
+STATUS_UNKNOWN = 6  # retvCmdUnknown
+STATUS_BAD_VALUE = 7  # retvBadValue
+PACKET_SIZE = 64
+FRAME_SIZE = PACKET_SIZE + PACKET_SIZE // 254 + 1  # Encoded, RpcLink_t::Frame
+MAX_ARGS = 7
+
+
+def crc16(data, crc=0xFFFF):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+        crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_ptr = 0
+    code = 1
+    for byte in data:
+        if byte:
+            out.append(byte)
+            code += 1
+        if byte == 0 or code == 0xFF:
+            out[code_ptr] = code
+            code_ptr = len(out)
+            out.append(0)
+            code = 1
+    out[code_ptr] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(data):
+            raise ValueError("bad COBS block")
+        out += data[i:i + code - 1]
+        i += code - 1
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def put_varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        out.append(byte | (0x80 if value else 0))
+        if not value:
+            return bytes(out)
+
+
+def get_varint(data, pos):
+    value = 0
+    for n in range(5):
+        if pos + n >= len(data):
+            break
+        value |= (data[pos + n] & 0x7F) << 7 * n
+        if not data[pos + n] & 0x80:
+            return value, pos + n + 1
+    raise ValueError("bad varint")
+
+
+def zigzag(value):
+    return ((value << 1) ^ (value >> 31)) & 0xFFFFFFFF
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def frame(payload):
+    payload += struct.pack("<H", crc16(payload))
+    return b"\0" + cobs_encode(payload) + b"\0"
+
+
+def encode_request(request_id, calls):
+    payload = bytearray([request_id & 0xFF])
+    for opcode, args in calls:
+        if len(args) > MAX_ARGS:
+            raise ValueError("too many arguments")
+        payload.append(len(args) << 5 | opcode)
+        for arg in args:
+            payload += put_varint(arg & 0xFFFFFFFF)
+    if len(payload) + 2 > PACKET_SIZE:
+        raise ValueError("packet too long")
+    return frame(bytes(payload))
+
+
+def parse_packet(payload):
+    """Returns (id, [(opcode, status, results)]) or None for broken packet"""
+    if len(payload) < 3 or crc16(payload[:-2]) != struct.unpack_from("<H", payload, len(payload) - 2)[0]:
+        return None
+    end = len(payload) - 2
+    pos = 1
+    items = []
+    while pos < end:
+        count, opcode = payload[pos] >> 5, payload[pos] & 0x1F
+        status = payload[pos + 1]
+        pos += 2
+        values = []
+        for _ in range(count):
+            value, pos = get_varint(payload, pos)
+            values.append(value)
+        items.append((opcode, status, values))
+    return payload[0], items
+
+
+class Deframer:
+    """Splits received stream into text and packets, same rules as RpcLink_t:
+    zero closing a broken frame opens next one, too long frame is text"""
+
+    def __init__(self):
+        self.in_packet = False
+        self.frame = bytearray()
+        self.text = bytearray()
+
+    def feed(self, data):
+        packets = []
+        for byte in data:
+            if byte and not self.in_packet:
+                self.text.append(byte)
+            elif byte:
+                if len(self.frame) < FRAME_SIZE:
+                    self.frame.append(byte)
+                else:
+                    self.in_packet = False
+                    self.frame.clear()
+            elif not self.in_packet or not self.frame:
+                self.in_packet = True
+                self.frame.clear()
+            else:
+                try:
+                    payload = cobs_decode(bytes(self.frame))
+                except ValueError:
+                    payload = b""
+                self.frame.clear()
+                if len(payload) >= 3 and crc16(payload[:-2]) == struct.unpack_from("<H", payload, len(payload) - 2)[0]:
+                    packets.append(payload)
+                    self.in_packet = False
+        return packets
+
+
+class RpcClient:
+    def __init__(self, port, timeout=2.0):
+        self.port = port
+        self.timeout = timeout
+        self.deframer = Deframer()
+        self.next_id = 0
+        self.responses = {}
+
+    def send(self, calls):
+        """Sends packet without waiting, returns request id"""
+        request_id = self.next_id
+        self.next_id = (self.next_id + 1) & 0xFF
+        self.port.write(encode_request(request_id, calls))
+        return request_id
+
+    def receive(self, request_id):
+        deadline = self.port.clock() + self.timeout
+        while request_id not in self.responses:
+            if self.port.clock() > deadline:
+                raise TimeoutError("no answer to request %d" % request_id)
+            for payload in self.deframer.feed(self.port.read(256)):
+                packet = parse_packet(payload)
+                if packet is not None:
+                    self.responses[packet[0]] = packet[1]
+        return self.responses.pop(request_id)
+
+    def call(self, name, *args):
+        opcode, status, values = self.receive(self.send([(OPCODES[name], args)]))[0]
+        return status, values
+
+    def text(self, line):
+        """Text command, returns first answer line"""
+        self.port.write(line.encode() + b"\r\n")
+        deadline = self.port.clock() + self.timeout
+        while b"\n" not in self.deframer.text:
+            if self.port.clock() > deadline:
+                raise TimeoutError("no answer to %s" % line)
+            self.deframer.feed(self.port.read(256))
+        answer, _, rest = bytes(self.deframer.text).partition(b"\n")
+        self.deframer.text = bytearray(rest)
+        return answer.decode(errors="replace").strip()
+
+
+class SerialPort:
+    def __init__(self, name, baud):
+        try:
+            import serial
+        except ImportError:
+            sys.exit("pyserial is required for serial port")
+        self.serial = serial.Serial(name, baud, timeout=0.01)
+
+    def write(self, data):
+        self.serial.write(data)
+
+    def read(self, size):
+        return self.serial.read(max(1, min(size, self.serial.in_waiting)))
+
+    @staticmethod
+    def clock():
+        return time.monotonic()
+
+
+class DeviceModel:
+    """Firmware side of protocol: text commands and RPC handlers of main.cpp"""
+
+    def __init__(self):
+        self.brightness = 15
+        self.solid = 0
+        self.color = 0
+        self.deframer = Deframer()
+
+    def handle(self, opcode, args):
+        if opcode == OPCODES["ping"]:
+            return STATUS_OK, list(args)
+        if opcode == OPCODES["status"]:
+            return STATUS_OK, [self.brightness, self.solid, self.color, 0, 256, 0, 0]
+        if opcode == OPCODES["brightness"]:
+            if args and args[0] > 255:
+                return STATUS_BAD_VALUE, []
+            if args:
+                self.brightness = args[0]
+            return STATUS_OK, [self.brightness]
+        if opcode == OPCODES["color"]:
+            self.solid = 1 if args else 0
+            self.color = args[0] if args else self.color
+            return STATUS_OK, []
+        if opcode < len(OPCODES):
+            return STATUS_OK, []
+        return STATUS_UNKNOWN, []
+
+    def feed(self, data):
+        answer = bytearray()
+        for payload in self.deframer.feed(data):
+            if len(payload) < 3 or crc16(payload[:-2]) != struct.unpack_from("<H", payload, len(payload) - 2)[0]:
+                continue
+            response = bytearray(payload[:1])
+            pos, end = 1, len(payload) - 2
+            while pos < end:
+                count, opcode = payload[pos] >> 5, payload[pos] & 0x1F
+                pos += 1
+                args = []
+                for _ in range(count):
+                    value, pos = get_varint(payload, pos)
+                    args.append(value)
+                status, values = self.handle(opcode, args)
+                response += bytes([len(values) << 5 | opcode, status])
+                for value in values:
+                    response += put_varint(value)
+            answer += frame(bytes(response))
+        while b"\n" in self.deframer.text:
+            line, _, rest = bytes(self.deframer.text).partition(b"\n")
+            self.deframer.text = bytearray(rest)
+            words = line.decode(errors="replace").split()
+            if words[:1] == ["brightness"] and len(words) == 2:
+                self.brightness = int(words[1])
+                answer += b"Neopixel brihtness: %d\r\n" % self.brightness
+            elif words:
+                answer += b"Unknown command: %s\r\n" % words[0].encode()
+        return bytes(answer)
+
+
+class LoopbackPort:
+    """Device model behind simulated full duplex link, time is virtual"""
+
+    def __init__(self, baud, latency):
+        self.device = DeviceModel()
+        self.byte_time = 10.0 / baud
+        self.latency = latency  # Device reaction time, s
+        self.now = 0.0
+        self.tx_free = 0.0
+        self.rx_free = 0.0
+        self.rx = collections.deque()  # (time available, bytes)
+
+    def write(self, data):
+        start = max(self.now, self.tx_free)
+        self.tx_free = start + len(data) * self.byte_time
+        answer = self.device.feed(data)
+        if answer:
+            start = max(self.tx_free + self.latency, self.rx_free)
+            self.rx_free = start + len(answer) * self.byte_time
+            self.rx.append((self.rx_free, answer))
+
+    def read(self, size):
+        if not self.rx:
+            self.now += self.byte_time
+            return b""
+        available, data = self.rx.popleft()
+        self.now = max(self.now, available)
+        return data
+
+    def clock(self):
+        return self.now
+
+
+def benchmark(client, count, window, batch):
+    clock = client.port.clock
+    results = []
+
+    start = clock()
+    for i in range(count):
+        client.text("brightness %d" % (i & 0x7F))
+    results.append(("text, one per round trip", clock() - start))
+
+    start = clock()
+    for i in range(count):
+        client.call("brightness", i & 0x7F)
+    results.append(("binary, one per round trip", clock() - start))
+
+    start = clock()
+    pending = collections.deque()
+    for i in range(count):
+        pending.append(client.send([(OPCODES["brightness"], [i & 0x7F])]))
+        if len(pending) >= window:
+            client.receive(pending.popleft())
+    while pending:
+        client.receive(pending.popleft())
+    results.append(("binary, %d packets pipelined" % window, clock() - start))
+
+    start = clock()
+    for i in range(0, count, batch):
+        calls = [(OPCODES["brightness"], [(i + k) & 0x7F]) for k in range(min(batch, count - i))]
+        client.receive(client.send(calls))
+    results.append(("binary, %d calls per packet" % batch, clock() - start))
+
+    for name, seconds in results:
+        print("%-32s %8.1f commands/s" % (name, count / seconds if seconds else float("inf")))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("-p", "--port", help="serial port")
+    source.add_argument("--loopback", action="store_true", help="device model with simulated link")
+    parser.add_argument("-b", "--baud", type=int, default=9600, help="link baud rate")
+    parser.add_argument("--latency", type=float, default=1.0, help="loopback device reaction time, ms")
+    parser.add_argument("-n", "--count", type=int, default=200, help="commands per benchmark")
+    parser.add_argument("-w", "--window", type=int, default=4, help="packets in flight when pipelined")
+    parser.add_argument("--batch", type=int, default=8, help="calls per packet when batched")
+    parser.add_argument("action", nargs="?", default="bench", choices=["bench", "call"])
+    parser.add_argument("op", nargs="?", choices=list(OPCODES), help="operation for call")
+    parser.add_argument("args", nargs="*", type=lambda text: int(text, 0), help="call arguments")
+    args = parser.parse_args()
+
+    if args.loopback:
+        port = LoopbackPort(args.baud, args.latency / 1000)
+    else:
+        port = SerialPort(args.port, args.baud)
+    client = RpcClient(port)
+    if args.action == "call":
+        if args.op is None:
+            parser.error("operation required")
+        status, values = client.call(args.op, *args.args)
+        print("status %d: %s" % (status, " ".join(str(v) for v in values)))
+        return
+    benchmark(client, args.count, args.window, args.batch)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,208 @@
+#!/usr/bin/env python3
+"""
+Serial link benchmark - host side of "linkbench" command
+(see Alatyr_fw/Inc/linkbench.h for test modes).
+
+Command is sent on control port, link under test is device port 0 (debug
+UART) or 1 (BLE UART). Host plays counterpart on test port: checks counter
+stream (tx), sends it (rx) or echoes it back (echo). With TX-RX jumper on
+device UART host does nothing and only echo mode makes sense. Baud rate of
+test port is switched together with device for the run, BLE serial has no
+baud rate, so leave -r empty for it. Rates the device can't set with its
+clock are refused before the run.
+
+With --autobaud control port must be wired to debug UART. Device is moved
+to new rate by sync character, runs follow at this rate. Needs pyserial.
+
+Example:
+    serial_bench.py -p /dev/ttyUSB0 --device-port 0 -r 115200 230400 -s 16 64 128
+    serial_bench.py -p /dev/ttyUSB0 --device-port 1 -t /dev/rfcomm0 -m echo
+    serial_bench.py -p /dev/rfcomm0 --device-port 0 --jumper -m echo tx
+    serial_bench.py -p /dev/ttyUSB0 --autobaud 921600 -m tx rx
+"""
+
+import argparse
+import re
+import sys
+import time
+
+QUIET = 0.05  # s, device waits twice as long before answer
+RESULT = re.compile(r"LB ((?:\w+=\S+ ?)+)")
+AUTOBAUD = re.compile(r"Autobaud (\d+) \(measured (\d+)\), error (-?\d+) ppm")
+
+
+class Counterpart:
+    """Host side of one run, counter stream byte n is n & 0xFF"""
+
+    def __init__(self, port):
+        self.port = port
+        self.bytes = 0
+        self.errors = 0
+        self.counter = 0
+
+    def check(self, data):
+        for byte in data:
+            if byte == self.counter:
+                self.bytes += 1
+            else:
+                self.errors += 1
+            self.counter = (byte + 1) & 0xFF
+
+    def read_until_quiet(self, deadline, handle):
+        last = time.monotonic()
+        while True:
+            now = time.monotonic()
+            if now > deadline and now - last > QUIET:
+                return
+            data = self.port.read(max(1, self.port.in_waiting))
+            if data:
+                handle(data)
+                last = time.monotonic()
+
+    def tx(self, seconds, baud, size):
+        self.read_until_quiet(time.monotonic() + seconds, self.check)
+
+    def rx(self, seconds, baud, size):
+        time.sleep(3*QUIET)  # Device switches baud rate LINKBENCH_SETTLE_MS after ready line
+        start = time.monotonic()
+        while time.monotonic() - start < seconds:
+            # Paced close to line rate, so little is left in OS buffer at the end
+            allowed = (time.monotonic() - start)*(baud or 115200)/10 + size
+            if self.bytes < allowed:
+                chunk = bytes((self.counter + i) & 0xFF for i in range(size))
+                self.port.write(chunk)
+                self.counter = (self.counter + size) & 0xFF
+                self.bytes += size
+            else:
+                time.sleep(0.001)
+        self.port.flush()
+
+    def echo(self, seconds, baud, size):
+        def reply(data):
+            self.port.write(data)
+            self.bytes += len(data)
+        self.read_until_quiet(time.monotonic() + seconds, reply)
+
+
+class LineReader:
+    def __init__(self, port):
+        self.port = port
+        self.buffer = b""
+
+    def read(self, prefix, timeout):
+        """Skips other lines, e.g. log of tasks on debug UART"""
+        deadline = time.monotonic() + timeout
+        while True:
+            while b"\n" in self.buffer:
+                line, _, self.buffer = self.buffer.partition(b"\n")
+                text = line.decode(errors="replace").strip()
+                if text.startswith(prefix):
+                    return text
+            if time.monotonic() > deadline:
+                raise TimeoutError("no '%s' line from device" % prefix)
+            self.buffer += self.port.read(max(1, self.port.in_waiting))
+
+
+def parse(line):
+    return dict(item.split("=", 1) for item in RESULT.match(line).group(1).split())
+
+
+def autobaud(control, baud):
+    """Returns (baud, measured, error ppm), control port stays at old rate if refused"""
+    lines = LineReader(control)
+    control.reset_input_buffer()
+    control.write(b"autobaud\r\n")
+    lines.read("Autobaud armed", 2.0)
+    old_baud = control.baudrate
+    control.baudrate = baud
+    time.sleep(QUIET)
+    control.write(b"U")
+    try:
+        # Device drops its input until line is quiet, then answers at new rate
+        answer = lines.read("Autobaud", 2.0)
+    except TimeoutError:
+        answer = ""
+    match = AUTOBAUD.match(answer)
+    if match is None:
+        control.baudrate = old_baud
+        raise TimeoutError("autobaud to %d failed: %s" % (baud, answer or "no answer"))
+    return tuple(int(value) for value in match.groups())
+
+
+def run(control, test, args, mode, size, baud):
+    command = "linkbench %d %s %d" % (args.device_port, mode, size)
+    if baud:
+        command += " %d" % baud
+    control.reset_input_buffer()
+    lines = LineReader(control)
+    control.write(command.encode() + b"\r\n")
+    ready = lines.read("LB ", 2.0)
+    if ready.startswith("LB fail"):
+        raise ValueError("baud rate refused by device: %s" % ready)
+    ready = parse(ready)
+    seconds = int(ready["ms"])/1000
+
+    host = None
+    if not args.jumper:
+        control_baud = test.baudrate
+        if baud:
+            test.baudrate = baud
+        host = Counterpart(test)
+        getattr(host, mode)(seconds, baud or test.baudrate, size)
+        test.baudrate = control_baud
+    else:
+        time.sleep(seconds)
+
+    result = parse(lines.read("LB port", seconds + 5.0))
+    result.update(parse(lines.read("LB errors", 1.0)))
+    if host is not None:
+        result["host"] = host.bytes
+        result["host_errors"] = host.errors
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-p", "--port", required=True, help="control serial port with device shell")
+    parser.add_argument("-b", "--baud", type=int, default=115200, help="control port baud rate")
+    parser.add_argument("-t", "--test-port", help="host end of tested link, control port by default")
+    parser.add_argument("--device-port", type=int, default=0, choices=[0, 1], help="0 - debug UART, 1 - BLE UART")
+    parser.add_argument("--jumper", action="store_true", help="TX-RX jumper on device UART, no host counterpart")
+    parser.add_argument("-m", "--modes", nargs="+", default=["tx", "rx", "echo"], choices=["tx", "rx", "echo"])
+    parser.add_argument("-s", "--sizes", nargs="+", type=int, default=[16, 64, 128], help="chunk sizes, bytes")
+    parser.add_argument("-r", "--rates", nargs="*", type=int, default=[0], help="baud rates, 0 - current")
+    parser.add_argument("--autobaud", type=int, help="move debug UART to this rate first")
+    args = parser.parse_args()
+
+    try:
+        import serial
+    except ImportError:
+        sys.exit("pyserial is required")
+    control = serial.Serial(args.port, args.baud, timeout=0.01)
+    test = control if args.test_port is None else serial.Serial(args.test_port, args.baud, timeout=0.01)
+    if args.autobaud:
+        try:
+            baud, measured, ppm = autobaud(control, args.autobaud)
+        except TimeoutError as error:
+            sys.exit(str(error))
+        print("autobaud %d, measured %d, BRR error %d ppm" % (baud, measured, ppm))
+
+    print("%-5s %5s %7s %6s %8s %8s %6s %6s %8s %8s %4s" % (
+        "mode", "size", "baud", "ppm", "dev B/s", "host B", "errors", "uart", "p50 us", "p99 us", "cpu%"))
+    for baud in args.rates or [0]:
+        for mode in args.modes:
+            for size in args.sizes:
+                try:
+                    r = run(control, test, args, mode, size, baud)
+                except (TimeoutError, ValueError) as error:
+                    print("%-5s %5d %7d %s" % (mode, size, baud, error))
+                    continue
+                errors = int(r["errors"]) + int(r["timeouts"]) + int(r.get("host_errors", 0))
+                print("%-5s %5d %7s %6s %8s %8s %6d %6s %8s %8s %4s" % (
+                    mode, size, r["baud"], r["ppm"], r["rate"], r.get("host", "-"), errors,
+                    int(r["uart"]) + int(r["overruns"]), r["p50"], r["p99"], r["cpu"]))
+
+
+if __name__ == "__main__":
+    main()
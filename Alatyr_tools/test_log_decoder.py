@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""
+Test of log_decoder.py against records built by firmware binlog code
+(host_tests/binlog_records.cpp, built by make in host_tests).
+
+Example:
+    python3 -m unittest -v test_log_decoder
+"""
+
+import os
+import random
+import shutil
+import subprocess
+import tempfile
+import unittest
+
+from log_decoder import Decoder
+
+HOST_TESTS = os.path.join(os.path.dirname(os.path.abspath(__file__)), "host_tests")
+
+
+class BinlogRecordsTest(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        if shutil.which("make") is None or shutil.which(os.environ.get("CXX", "g++")) is None:
+            raise unittest.SkipTest("host compiler not found")
+        subprocess.run(["make", "-s", "-C", HOST_TESTS, "binlog_records"], check=True)
+        with tempfile.TemporaryDirectory() as out:
+            subprocess.run([os.path.join(HOST_TESTS, "binlog_records"), out], check=True)
+            cls.strings = cls.read(out, "logstr.bin")
+            cls.capture = cls.read(out, "capture.bin")
+            cls.expected = cls.read(out, "expected.txt").decode()
+
+    @staticmethod
+    def read(directory, name):
+        with open(os.path.join(directory, name), "rb") as f:
+            return f.read()
+
+    def assertText(self, decoded):
+        # Line by line first, so failure shows the record
+        self.assertEqual(decoded.splitlines(), self.expected.splitlines())
+        self.assertEqual(decoded, self.expected)
+
+    def test_whole_capture(self):
+        self.assertText(Decoder(0, self.strings).feed(self.capture))
+
+    def test_byte_by_byte(self):
+        decoder = Decoder(0, self.strings)
+        self.assertText("".join(decoder.feed(self.capture[i:i + 1]) for i in range(len(self.capture))))
+
+    def test_random_chunks(self):
+        rand = random.Random(1)
+        for _ in range(50):
+            decoder = Decoder(0, self.strings)
+            out = []
+            pos = 0
+            while pos < len(self.capture):
+                size = rand.randint(1, 40)
+                out.append(decoder.feed(self.capture[pos:pos + size]))
+                pos += size
+            self.assertText("".join(out))
+
+    def test_unknown_id(self):
+        # String table without last format, its record has ID beyond table end
+        last = self.strings.rindex(b"\0", 0, len(self.strings) - 1) + 1
+        decoded = Decoder(0, self.strings[:last]).feed(self.capture)
+        self.assertIn("<unknown log id 0x%04X>" % last, decoded)
+        self.assertTrue(decoded.endswith("\r\nDone\r\n"))
+
+
+if __name__ == "__main__":
+    unittest.main()